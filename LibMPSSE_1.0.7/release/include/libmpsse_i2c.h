@@ -24,6 +24,13 @@
  * 0.2 - 20110708 - added macro I2C_DISABLE_3PHASE_CLOCKING
  * 0.3 - 20200428 - removed unnecessary files and directory structure
  *                  type of bool changed to unsigned int match WinTypes.h
+ * 0.4 - 20261018 - added I2C_WriteGPIOLow and FT_ReadGPIOLow
+ *                  added I2C_Scan and I2C_DeviceWriteRead
+ *                  added I2C_Poll
+ *                  added I2C_DISABLE_TRANSFER_PURGE
+ *                  added I2C_DeviceWriteReadSend and I2C_DeviceWriteReadReceive
+ *                  added I2C_DeviceWritePoll
+ *                  added I2C_PollSend and I2C_PollReceive
  */
 
 #ifndef FTDI_I2C_H
@@ -127,6 +134,10 @@ such I2C slaves. */
 /* option to enable pinstate configuration */
 #define I2C_ENABLE_PIN_STATE_CONFIG 0x0010
 
+/* The device buffers are purged before every write, scan & write/read by default.
+Setting this bit leaves it to the caller, e.g. only after a transfer has failed */
+#define I2C_DISABLE_TRANSFER_PURGE	0x0020
+
 /******************************************************************************/
 /*								Type defines								  */
 /******************************************************************************/
@@ -413,6 +424,211 @@ FTDIMPSSE_API FT_STATUS FT_WriteGPIO(FT_HANDLE handle, UCHAR dir, UCHAR value);
  */
 FTDIMPSSE_API FT_STATUS FT_ReadGPIO(FT_HANDLE handle, UCHAR *value);
 
+/*!
+ * \brief Writes to the ADBUS4-7 GPIO lines of the low byte
+ *
+ * Sets the state of the low byte lines that are not used by I2C. The state is
+ * merged into every following SCL/SDA command, so it persists across transfers.
+ *
+ * \param[in] handle Handle of the channel
+ * \param[in] dir The direction of the lines. 0 for in and 1 for out. Bits 0-3 are ignored
+ * \param[in] value Output state of the lines. Bits 0-3 are ignored
+ * \param[in] deferred If TRUE, nothing is written now and the lines change with the
+ *			first command of the next transfer
+ * \return status
+ * \sa
+ * \note The channel must have been initialized with I2C_InitChannel
+ * \warning
+ */
+FTDIMPSSE_API FT_STATUS I2C_WriteGPIOLow(FT_HANDLE handle, UCHAR dir, UCHAR value,
+	BOOL deferred);
+
+/*!
+ * \brief Finds the devices that respond on the I2C bus
+ *
+ * This function addresses each device in a range for write, and checks for an ACK.
+ * The START, address, ACK and STOP of every address are sent in a single write, and
+ * the ACK bits are read back with a single read.
+ *
+ * \param[in] handle Handle of the channel
+ * \param[in] firstAddress First 7bit address to check
+ * \param[in] lastAddress Last 7bit address to check, at most 127
+ * \param[out] *present Addresses that ACKed, up to (lastAddress - firstAddress + 1)
+ * \param[out] *noOfPresent Number of addresses written to present
+ * \return status
+ * \sa
+ * \note The channel must have been initialized with I2C_InitChannel
+ * \warning
+ */
+FTDIMPSSE_API FT_STATUS I2C_Scan(FT_HANDLE handle, UCHAR firstAddress,
+	UCHAR lastAddress, UCHAR *present, LPDWORD noOfPresent);
+
+/*!
+ * \brief Writes to, then reads from an I2C slave in one transaction
+ *
+ * This function generates START, the address for write and the bytes written, a
+ * repeated START, the address for read and the bytes read (nAcking the last), then
+ * STOP. Typically used to read registers: write the register address, then read.
+ * All the phases are sent in a single write, and the ACK bits & data are read back
+ * with a single read.
+ *
+ * \param[in] handle Handle of the channel
+ * \param[in] deviceAddress 7bit address of the I2C slave
+ * \param[in] writeSize Number of bytes to write, or 0 for a read only
+ * \param[in] *writeBuffer Bytes to write
+ * \param[in] readSize Number of bytes to read, or 0 for a write only
+ * \param[out] *readBuffer Buffer for the bytes read, of readSize bytes
+ * \param[out] *sizeTransferred Number of bytes read
+ * \return Returns FT_DEVICE_NOT_FOUND if the slave didn't ack its address, or
+ *		FT_FAILED_TO_WRITE_DEVICE if it nAcked a byte written
+ * \sa
+ * \note The channel must have been initialized with I2C_InitChannel
+ * \warning
+ */
+FTDIMPSSE_API FT_STATUS I2C_DeviceWriteRead(FT_HANDLE handle, UCHAR deviceAddress,
+	DWORD writeSize, UCHAR *writeBuffer, DWORD readSize, UCHAR *readBuffer,
+	LPDWORD sizeTransferred);
+
+/*!
+ * \brief Sends the commands of an I2C_DeviceWriteRead, without reading back
+ *
+ * This function sends the same commands as I2C_DeviceWriteRead and returns at once.
+ * When sizeToRead bytes are in the receive queue, I2C_DeviceWriteReadReceive reads
+ * them without blocking.
+ *
+ * \param[in] handle Handle of the channel
+ * \param[in] deviceAddress 7bit address of the I2C slave
+ * \param[in] writeSize Number of bytes to write, or 0 for a read only
+ * \param[in] *writeBuffer Bytes to write
+ * \param[in] readSize Number of bytes to read, or 0 for a write only
+ * \param[out] *sizeToRead Number of bytes the device will send back
+ * \return status
+ * \sa I2C_DeviceWriteReadReceive
+ * \note The channel must have been initialized with I2C_InitChannel
+ * \warning
+ */
+FTDIMPSSE_API FT_STATUS I2C_DeviceWriteReadSend(FT_HANDLE handle, UCHAR deviceAddress,
+	DWORD writeSize, UCHAR *writeBuffer, DWORD readSize, LPDWORD sizeToRead);
+
+/*!
+ * \brief Reads back the result of an I2C_DeviceWriteReadSend
+ *
+ * \param[in] handle Handle of the channel
+ * \param[in] writeSize Number of bytes written, as given to I2C_DeviceWriteReadSend
+ * \param[in] readSize Number of bytes read, as given to I2C_DeviceWriteReadSend
+ * \param[out] *readBuffer Buffer for the bytes read, of readSize bytes
+ * \param[out] *sizeTransferred Number of bytes read
+ * \return Returns FT_DEVICE_NOT_FOUND if the slave didn't ack its address, or
+ *		FT_FAILED_TO_WRITE_DEVICE if it nAcked a byte written
+ * \sa I2C_DeviceWriteReadSend
+ * \note
+ * \warning
+ */
+FTDIMPSSE_API FT_STATUS I2C_DeviceWriteReadReceive(FT_HANDLE handle, DWORD writeSize,
+	DWORD readSize, UCHAR *readBuffer, LPDWORD sizeTransferred);
+
+/*!
+ * \brief Reads registers from a list of I2C slaves in one transaction
+ *
+ * For each entry, this function generates START, the address for write, the
+ * register address, a repeated START, the address for read and the bytes read
+ * (nAcking the last), then STOP, as I2C_DeviceWriteRead does. The commands for all
+ * the entries are sent in a single write, and every ACK bit & byte is read back with
+ * a single read.
+ *
+ * \param[in] handle Handle of the channel
+ * \param[in] noOfEntries Number of entries
+ * \param[in] *deviceAddresses 7bit address of the I2C slave, per entry
+ * \param[in] *registers Register address written, per entry
+ * \param[in] *readSizes Number of bytes read, per entry (at least 1)
+ * \param[out] *readBuffer Buffer for the bytes read by every entry, one after another
+ * \param[out] *nAcked Set to 1 for each entry nAcked by its slave, else 0
+ * \return Returns FT_OK even if entries were nAcked; their bytes read are undefined
+ * \sa
+ * \note The channel must have been initialized with I2C_InitChannel
+ * \warning
+ */
+FTDIMPSSE_API FT_STATUS I2C_Poll(FT_HANDLE handle, DWORD noOfEntries,
+	UCHAR *deviceAddresses, UCHAR *registers, DWORD *readSizes,
+	UCHAR *readBuffer, UCHAR *nAcked);
+
+/*!
+ * \brief Sends the commands of an I2C_Poll, without reading back
+ *
+ * This function sends the same commands as I2C_Poll, in a single write, and returns
+ * at once. When sizeToRead bytes are in the receive queue, I2C_PollReceive reads
+ * them with a single read, without blocking.
+ *
+ * \param[in] handle Handle of the channel
+ * \param[in] noOfEntries Number of entries
+ * \param[in] *deviceAddresses 7bit address of the I2C slave, per entry
+ * \param[in] *registers Register address written, per entry
+ * \param[in] *readSizes Number of bytes read, per entry (at least 1)
+ * \param[out] *sizeToRead Number of bytes the device will send back
+ * \return status
+ * \sa I2C_PollReceive
+ * \note The channel must have been initialized with I2C_InitChannel
+ * \warning
+ */
+FTDIMPSSE_API FT_STATUS I2C_PollSend(FT_HANDLE handle, DWORD noOfEntries,
+	UCHAR *deviceAddresses, UCHAR *registers, DWORD *readSizes,
+	LPDWORD sizeToRead);
+
+/*!
+ * \brief Reads back the result of an I2C_PollSend
+ *
+ * \param[in] handle Handle of the channel
+ * \param[in] noOfEntries Number of entries, as given to I2C_PollSend
+ * \param[in] *readSizes Number of bytes read per entry, as given to I2C_PollSend
+ * \param[out] *readBuffer Buffer for the bytes read by every entry, one after another
+ * \param[out] *nAcked Set to 1 for each entry nAcked by its slave, else 0
+ * \return Returns FT_OK even if entries were nAcked; their bytes read are undefined
+ * \sa I2C_PollSend
+ * \note
+ * \warning
+ */
+FTDIMPSSE_API FT_STATUS I2C_PollReceive(FT_HANDLE handle, DWORD noOfEntries,
+	DWORD *readSizes, UCHAR *readBuffer, UCHAR *nAcked);
+
+/*!
+ * \brief Writes to an I2C slave, then polls it for an ACK in the same transaction
+ *
+ * For a device that nAcks its address while busy, such as an EEPROM during its
+ * internal write cycle. This function generates START, the address for write and
+ * writeSize bytes, then STOP, followed by noOfProbes probes of the address (START,
+ * the address for write, STOP). The commands are sent in a single write, and every
+ * ACK bit is read back with a single read.
+ *
+ * \param[in] handle Handle of the channel
+ * \param[in] deviceAddress 7bit address of the I2C slave
+ * \param[in] writeSize Number of bytes to write, or 0 to only probe
+ * \param[in] *writeBuffer Bytes to write
+ * \param[in] noOfProbes Number of address probes after the write
+ * \param[out] *probesToAck Number of the first probe the slave Acked, from 1,
+ *		or 0 if it Acked none
+ * \return Returns FT_DEVICE_NOT_FOUND if the slave didn't ack its address for the
+ *		write, or FT_FAILED_TO_WRITE_DEVICE if it nAcked a byte written
+ * \sa
+ * \note The channel must have been initialized with I2C_InitChannel
+ * \warning
+ */
+FTDIMPSSE_API FT_STATUS I2C_DeviceWritePoll(FT_HANDLE handle, UCHAR deviceAddress,
+	DWORD writeSize, UCHAR *writeBuffer, DWORD noOfProbes, LPDWORD probesToAck);
+
+/*!
+ * \brief Reads from the 8 GPIO lines of the low byte
+ *
+ * This function reads the lines associated with the low byte of the MPSSE channel
+ *
+ * \param[in] handle Handle of the channel
+ * \param[out] *value Input state of the 8 lines(1 = high)
+ * \return status
+ * \sa
+ * \note
+ * \warning
+ */
+FTDIMPSSE_API FT_STATUS FT_ReadGPIOLow(FT_HANDLE handle, UCHAR *value);
+
 /******************************************************************************/
 
 /*!
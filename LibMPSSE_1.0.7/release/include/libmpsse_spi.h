@@ -25,6 +25,8 @@
  * 0.3 - 20111103 - added SPI_ReadWrite
  * 0.4 - 20200428 - removed unnecessary files and directory structure
  *                  type of bool changed to unsigned int match WinTypes.h
+ * 0.5 - 20261018 - added SPI_WriteGPIOLow and FT_ReadGPIOLow
+ *                  added SPI_GetPinState and SPI_SetPinState
  */
 
 #ifndef FTDI_SPI_H
@@ -390,6 +392,36 @@ FTDIMPSSE_API FT_STATUS SPI_ChangeCS(FT_HANDLE handle, DWORD configOptions);
  */
 FTDIMPSSE_API FT_STATUS SPI_ToggleCS(FT_HANDLE handle, BOOL state);
 
+/*!
+ * \brief Gets the tracked state of the low byte lines
+ *
+ * This function returns the direction and value of the low byte lines, as last
+ * written by the library (or recorded with SPI_SetPinState)
+ *
+ * \param[in] handle Handle of the channel
+ * \param[out] state BIT7-BIT0: direction of the lines, BIT15-BIT8: values of the lines
+ * \return Returns status code of type FT_STATUS(see D2XX Programmer's Guide)
+ * \sa
+ * \note This function should only be called after SPI_Init has been called
+ * \warning
+ */
+FTDIMPSSE_API FT_STATUS SPI_GetPinState(FT_HANDLE handle, USHORT *state);
+
+/*!
+ * \brief Records the state of the low byte lines
+ *
+ * This function records the direction and value of the low byte lines after the
+ * caller has written them through its own MPSSE commands. Nothing is written.
+ *
+ * \param[in] handle Handle of the channel
+ * \param[in] state BIT7-BIT0: direction of the lines, BIT15-BIT8: values of the lines
+ * \return Returns status code of type FT_STATUS(see D2XX Programmer's Guide)
+ * \sa
+ * \note This function should only be called after SPI_Init has been called
+ * \warning
+ */
+FTDIMPSSE_API FT_STATUS SPI_SetPinState(FT_HANDLE handle, USHORT state);
+
 /*!
  * \brief Writes to the 8 GPIO lines
  *
@@ -419,6 +451,40 @@ FTDIMPSSE_API FT_STATUS FT_WriteGPIO(FT_HANDLE handle, UCHAR dir, UCHAR value);
  */
 FTDIMPSSE_API FT_STATUS FT_ReadGPIO(FT_HANDLE handle, UCHAR *value);
 
+/*!
+ * \brief Writes to the GPIO lines of the low byte
+ *
+ * Sets the state of the low byte lines that are not used by SPI, which are
+ * ADBUS4-7 except the chip select line. The state is kept with the CS state, so
+ * it persists across transfers.
+ *
+ * \param[in] handle Handle of the channel
+ * \param[in] dir The direction of the lines. 0 for in and 1 for out. SPI lines are ignored
+ * \param[in] value Output state of the lines. SPI lines are ignored
+ * \param[in] deferred If TRUE, nothing is written now and the lines change with the
+ *			next chip select toggle
+ * \return status
+ * \sa
+ * \note This function should only be called after SPI_Init has been called
+ * \warning
+ */
+FTDIMPSSE_API FT_STATUS SPI_WriteGPIOLow(FT_HANDLE handle, UCHAR dir, UCHAR value,
+	BOOL deferred);
+
+/*!
+ * \brief Reads from the 8 GPIO lines of the low byte
+ *
+ * This function reads the lines associated with the low byte of the MPSSE channel
+ *
+ * \param[in] handle Handle of the channel
+ * \param[out] *value Input state of the 8 lines(1 = high)
+ * \return status
+ * \sa
+ * \note
+ * \warning
+ */
+FTDIMPSSE_API FT_STATUS FT_ReadGPIOLow(FT_HANDLE handle, UCHAR *value);
+
 /******************************************************************************/
 
 /*!
@@ -27,6 +27,14 @@
  * 				  Returns FT_DEVICE_NOT_FOUND if addressed slave doesn't respond
  *				  Adjustment to clock rate if 3-phase-clocking is enabled
   * 0.4 - 20200428 - removed unnecessary files and directory structure
+ * 0.5 - 20261018 - ADBUS4-7 state kept in currentPinState and merged into the
+ *				  SCL/SDA commands, added function I2C_WriteGPIOLow
+ *				  Added functions I2C_Scan & I2C_DeviceWriteRead
+ *				  Added function I2C_Poll
+ *				  Purge before transfers skipped with I2C_DISABLE_TRANSFER_PURGE
+ *				  Added functions I2C_DeviceWriteReadSend & I2C_DeviceWriteReadReceive
+ *				  Added function I2C_DeviceWritePoll
+ *				  Added functions I2C_PollSend & I2C_PollReceive
 */
 
 /******************************************************************************/
@@ -68,6 +76,22 @@
 #define I2C_ADDRESS_READ_MASK	0x01	/*LSB 1 = Read*/
 #define I2C_ADDRESS_WRITE_MASK	0xFE	/*LSB 0 = Write*/
 
+/* ADBUS4-7 are not used by I2C. Their state is kept in currentPinState and is
+merged into every low byte command so that they can be used as GPIO */
+#define I2C_GPIO_LOW_MASK		0xF0
+#define I2C_GPIO_LOW_DEFAULT	0x0010	/*ADBUS4 out/low, as the DIRECTION_* values*/
+
+/* Sizes of the command frames appended by I2C_AddStart, I2C_AddStop,
+I2C_AddWriteByte & I2C_AddReadByte */
+#define I2C_START_CMD_SIZE	((START_DURATION_1 + START_DURATION_2 + 1)*3)
+#define I2C_STOP_CMD_SIZE	((STOP_DURATION_1 + STOP_DURATION_2 + STOP_DURATION_3 + 1)*3)
+#define I2C_BYTE_CMD_SIZE	11
+/* Upper bound of the commands appended by I2C_AddWriteRead */
+#define I2C_WRITE_READ_CMD_SIZE(w, r)	((2*I2C_START_CMD_SIZE) + 3 + \
+	(((w) + (r) + 2)*I2C_BYTE_CMD_SIZE) + I2C_STOP_CMD_SIZE)
+/* Bytes read back for a write/read transaction: ACK bits, then the data */
+#define I2C_WRITE_READ_ACKS(w, r)	(((w) > 0 ? (w) + 1 : 0) + ((r) > 0 ? 1 : 0))
+
 #ifdef I2C_CMD_GETDEVICEID_SUPPORTED
 
 /* This enum lists the supported I2C modes*/
@@ -244,6 +268,120 @@ static FT_STATUS I2C_Start(FT_HANDLE handle);
  */
 static FT_STATUS I2C_Stop(FT_HANDLE handle);
 
+/*!
+ * \brief Appends a set-low-byte command for the SCL/SDA lines to a buffer
+ *
+ * The SCL/SDA value and direction are merged with the ADBUS4-7 GPIO state of
+ * the channel, and the resulting pin state is saved back to the channel.
+ *
+ * \param[in] config Channel configuration, may be NULL
+ * \param[in] *buffer Command buffer
+ * \param[in] i Index in the buffer to write the command at
+ * \param[in] value One of the VALUE_SCLxxx_SDAxxx values
+ * \param[in] direction One of the DIRECTION_SCLxxx_SDAxxx values
+ * \return Returns the index following the command
+ * \sa
+ * \note
+ * \warning
+ */
+static uint32 I2C_SetLowByte(ChannelConfig *config, uint8 *buffer, uint32 i,
+	uint8 value, uint8 direction);
+
+/*!
+ * \brief Appends the commands of an I2C START condition to a buffer
+ *
+ * \param[in] config Channel configuration, may be NULL
+ * \param[in] *buffer Command buffer, with at least I2C_START_CMD_SIZE bytes free
+ * \param[in] i Index in the buffer to write the commands at
+ * \return Returns the index following the commands
+ * \sa I2C_Start
+ * \note
+ * \warning
+ */
+static uint32 I2C_AddStart(ChannelConfig *config, uint8 *buffer, uint32 i);
+
+/*!
+ * \brief Appends the commands of an I2C STOP condition to a buffer
+ *
+ * The SCL & SDA lines are tristated at the end of the condition.
+ *
+ * \param[in] config Channel configuration, may be NULL
+ * \param[in] *buffer Command buffer, with at least I2C_STOP_CMD_SIZE bytes free
+ * \param[in] i Index in the buffer to write the commands at
+ * \return Returns the index following the commands
+ * \sa I2C_Stop
+ * \note
+ * \warning
+ */
+static uint32 I2C_AddStop(ChannelConfig *config, uint8 *buffer, uint32 i);
+
+/*!
+ * \brief Appends the commands to write a byte and read its ACK bit to a buffer
+ *
+ * \param[in] config Channel configuration, may be NULL
+ * \param[in] *buffer Command buffer, with at least I2C_BYTE_CMD_SIZE bytes free
+ * \param[in] i Index in the buffer to write the commands at
+ * \param[in] data Byte to write
+ * \return Returns the index following the commands
+ * \sa
+ * \note The commands return one byte, with the ACK bit in bit 0 (1 = nAck)
+ * \warning
+ */
+static uint32 I2C_AddWriteByte(ChannelConfig *config, uint8 *buffer, uint32 i,
+	uint8 data);
+
+/*!
+ * \brief Appends the commands to read a byte and write its ACK bit to a buffer
+ *
+ * \param[in] config Channel configuration, may be NULL
+ * \param[in] *buffer Command buffer, with at least I2C_BYTE_CMD_SIZE bytes free
+ * \param[in] i Index in the buffer to write the commands at
+ * \param[in] ack SEND_ACK or SEND_NACK
+ * \return Returns the index following the commands
+ * \sa
+ * \note The commands return the byte read
+ * \warning
+ */
+static uint32 I2C_AddReadByte(ChannelConfig *config, uint8 *buffer, uint32 i,
+	uint8 ack);
+
+/*!
+ * \brief Appends a complete write, repeated START & read transaction to a buffer
+ *
+ * START, the address for write and writeSize bytes, then a repeated START, the
+ * address for read and readSize bytes (nAcking the last), then STOP. The write
+ * phase is left out if writeSize is 0, and the read phase if readSize is 0.
+ *
+ * \param[in] config Channel configuration, may be NULL
+ * \param[in] *buffer Command buffer, with I2C_WRITE_READ_CMD_SIZE bytes free
+ * \param[in] i Index in the buffer to write the commands at
+ * \param[in] deviceAddress Address of the I2C slave
+ * \param[in] writeSize Number of bytes to write
+ * \param[in] *writeBuffer Bytes to write
+ * \param[in] readSize Number of bytes to read
+ * \return Returns the index following the commands
+ * \sa I2C_CheckWriteReadAcks
+ * \note The commands return I2C_WRITE_READ_ACKS ACK bytes, then readSize bytes of data
+ * \warning
+ */
+static uint32 I2C_AddWriteRead(ChannelConfig *config, uint8 *buffer, uint32 i,
+	UCHAR deviceAddress, DWORD writeSize, UCHAR *writeBuffer, DWORD readSize);
+
+/*!
+ * \brief Checks the ACK bytes read back for a transaction of I2C_AddWriteRead
+ *
+ * \param[in] *inBuffer Bytes read back, starting with the ACK bytes
+ * \param[in] writeSize Number of bytes written
+ * \param[in] readSize Number of bytes read
+ * \return FT_OK if all were Acked, FT_DEVICE_NOT_FOUND if the slave didn't ack its
+ *		address, or FT_FAILED_TO_WRITE_DEVICE if it nAcked a byte written
+ * \sa
+ * \note
+ * \warning
+ */
+static FT_STATUS I2C_CheckWriteReadAcks(uint8 *inBuffer, DWORD writeSize,
+	DWORD readSize);
+
 /*!
  * \brief This function generates the START, ADDRESS, DATA(write) & STOP phases in the I2C
  *		bus without having delays between these phases
@@ -439,6 +577,12 @@ FTDIMPSSE_API FT_STATUS I2C_InitChannel(FT_HANDLE handle, ChannelConfig *config)
 	if(config->Options & I2C_ENABLE_PIN_STATE_CONFIG)
 	{
 		Pin = config->Pin;
+		config->currentPinState = (uint16)(Pin & 0xFFFF);
+	}
+	else
+	{/* Lines as left by FT_InitChannel, with ADBUS4-7 as the DIRECTION_* values */
+		config->currentPinState = (VALUE_SCLHIGH_SDAHIGH<<8) |
+			(DIRECTION_SCLOUT_SDAOUT & ~I2C_GPIO_LOW_MASK) | I2C_GPIO_LOW_DEFAULT;
 	}
 	DBG(MSG_DEBUG,"handle = 0x%x ClockRate=%u LatencyTimer=%u Options = 0x%x\n",
 		(unsigned)handle, (unsigned)config->ClockRate,
@@ -619,6 +763,7 @@ FTDIMPSSE_API FT_STATUS I2C_DeviceWrite(FT_HANDLE handle, UCHAR deviceAddress,
 	DWORD sizeToTransfer, UCHAR *buffer, LPDWORD sizeTransferred, DWORD options)
 {
 	FT_STATUS status = FT_OK;
+	ChannelConfig *config = NULL;
 	bool ack = FALSE;
 	uint32 i;
 	FN_ENTER;
@@ -636,8 +781,14 @@ FTDIMPSSE_API FT_STATUS I2C_DeviceWrite(FT_HANDLE handle, UCHAR deviceAddress,
 		(unsigned)handle, (unsigned)deviceAddress, 
 		(unsigned)sizeToTransfer, (unsigned)options);
 
+	status = I2C_GetChannelConfig(handle, &config);
+	CHECK_STATUS(status);
+
 	LOCK_CHANNEL(handle);
-	Mid_PurgeDevice(handle);
+	if (!(config->Options & I2C_DISABLE_TRANSFER_PURGE))
+	{
+		Mid_PurgeDevice(handle);
+	}
 
 	if (options & I2C_TRANSFER_OPTIONS_FAST_TRANSFER)
 	{
@@ -791,12 +942,518 @@ FTDIMPSSE_API FT_STATUS I2C_GetDeviceID(FT_HANDLE handle, uint8 deviceAddress,
 	return status;
 }
 
+FTDIMPSSE_API FT_STATUS I2C_WriteGPIOLow(FT_HANDLE handle, UCHAR dir, UCHAR value,
+	BOOL deferred)
+{
+	FT_STATUS status;
+	ChannelConfig *config = NULL;
+	uint8 buffer[3];
+	DWORD noOfBytesTransferred;
+
+	FN_ENTER;
+#ifdef ENABLE_PARAMETER_CHECKING
+	CHECK_NULL_RET(handle);
+#endif // ENABLE_PARAMETER_CHECKING
+	status = I2C_GetChannelConfig(handle, &config);
+	CHECK_STATUS(status);
+
+	config->currentPinState = (config->currentPinState & 0x0F0F) |
+		((uint16)(value & I2C_GPIO_LOW_MASK)<<8) | (dir & I2C_GPIO_LOW_MASK);
+	DBG(MSG_DEBUG,"config->currentPinState = 0x%x\n",
+		(unsigned)config->currentPinState);
+
+	if (!deferred)
+	{/* SCL/SDA are written back with the state they were last left in */
+		buffer[0] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;/* MPSSE command */
+		buffer[1] = (uint8)((config->currentPinState & 0xFF00)>>8); /*Value*/
+		buffer[2] = (uint8)(config->currentPinState & 0x00FF); /*Direction*/
+		status = FT_Channel_Write(I2C, handle, 3, buffer, &noOfBytesTransferred);
+		CHECK_STATUS(status);
+	}
+	FN_EXIT;
+	return status;
+}
+
+FTDIMPSSE_API FT_STATUS I2C_Scan(FT_HANDLE handle, UCHAR firstAddress,
+	UCHAR lastAddress, UCHAR *present, LPDWORD noOfPresent)
+{
+	ChannelConfig *config = NULL;
+	FT_STATUS status;
+	uint8 *outBuffer;
+	uint8 inBuffer[128];
+	uint32 i = 0, j;
+	uint32 address, count;
+	uint32 sizeTotal;
+	DWORD noOfBytesTransferred = 0;
+
+	FN_ENTER;
+#ifdef ENABLE_PARAMETER_CHECKING
+	CHECK_NULL_RET(handle);
+	CHECK_NULL_RET(present);
+	CHECK_NULL_RET(noOfPresent);
+	if ((firstAddress > lastAddress) || (lastAddress > 127))
+	{
+		DBG(MSG_ERR,"invalid address range 0x%x to 0x%x\n",
+			(unsigned)firstAddress, (unsigned)lastAddress);
+		return FT_INVALID_PARAMETER;
+	}
+#endif // ENABLE_PARAMETER_CHECKING
+	*noOfPresent = 0;
+	status = I2C_GetChannelConfig(handle, &config);
+	CHECK_STATUS(status);
+
+	count = lastAddress - firstAddress + 1;
+	/* START, address & ACK bit, STOP for each address, then SEND_IMMEDIATE */
+	sizeTotal = count * (I2C_START_CMD_SIZE + I2C_BYTE_CMD_SIZE + I2C_STOP_CMD_SIZE) + 1;
+	outBuffer = (uint8*) INFRA_MALLOC(sizeTotal);
+	if (NULL == outBuffer)
+	{
+		return FT_INSUFFICIENT_RESOURCES;
+	}
+
+	for (address = firstAddress; address <= lastAddress; address++)
+	{/* address for write, LSB = 0 */
+		i = I2C_AddStart(config, outBuffer, i);
+		i = I2C_AddWriteByte(config, outBuffer, i,
+			(uint8)((address << 1) & I2C_ADDRESS_WRITE_MASK));
+		i = I2C_AddStop(config, outBuffer, i);
+	}
+	/*Command MPSSE to send data to PC immediately */
+	outBuffer[i++] = MPSSE_CMD_SEND_IMMEDIATE;
+	assert(i <= sizeTotal);
+
+	LOCK_CHANNEL(handle);
+	if (!(config->Options & I2C_DISABLE_TRANSFER_PURGE))
+	{
+		Mid_PurgeDevice(handle);
+	}
+	status = FT_Channel_Write(I2C, handle, i, outBuffer, &noOfBytesTransferred);
+	if ((FT_OK == status) && (i != noOfBytesTransferred))
+	{
+		DBG(MSG_ERR, "Requested to send %u bytes, no. of bytes sent is %u bytes",
+			(unsigned)i, (unsigned)noOfBytesTransferred);
+		status = FT_IO_ERROR;
+	}
+	if (FT_OK == status)
+	{/* one byte per address, with the ACK bit in bit 0 */
+		noOfBytesTransferred = 0;
+		status = FT_Channel_Read(I2C, handle, count, inBuffer,
+			&noOfBytesTransferred);
+		if ((FT_OK == status) && (count != noOfBytesTransferred))
+		{
+			DBG(MSG_ERR, "Requested to read %u bytes, no. of bytes read is %u bytes",
+				(unsigned)count, (unsigned)noOfBytesTransferred);
+			status = FT_IO_ERROR;
+		}
+	}
+	UNLOCK_CHANNEL(handle);
+	INFRA_FREE(outBuffer);
+
+	if (FT_OK == status)
+	{
+		for (j = 0; j < count; j++)
+		{
+			if (!(inBuffer[j] & 0x01))/*ack bit clear means the device Acked*/
+			{
+				present[(*noOfPresent)++] = (UCHAR)(firstAddress + j);
+			}
+		}
+	}
+	FN_EXIT;
+	return status;
+}
+
+FTDIMPSSE_API FT_STATUS I2C_DeviceWriteRead(FT_HANDLE handle, UCHAR deviceAddress,
+	DWORD writeSize, UCHAR *writeBuffer, DWORD readSize, UCHAR *readBuffer,
+	LPDWORD sizeTransferred)
+{
+	FT_STATUS status;
+	DWORD sizeToRead = 0;
+
+	FN_ENTER;
+#ifdef ENABLE_PARAMETER_CHECKING
+	CHECK_NULL_RET(sizeTransferred);
+#endif // ENABLE_PARAMETER_CHECKING
+	*sizeTransferred = 0;
+	LOCK_CHANNEL(handle);
+	status = I2C_DeviceWriteReadSend(handle, deviceAddress, writeSize,
+		writeBuffer, readSize, &sizeToRead);
+	if (FT_OK == status)
+	{
+		status = I2C_DeviceWriteReadReceive(handle, writeSize, readSize,
+			readBuffer, sizeTransferred);
+	}
+	UNLOCK_CHANNEL(handle);
+	FN_EXIT;
+	return status;
+}
+
+FTDIMPSSE_API FT_STATUS I2C_DeviceWriteReadSend(FT_HANDLE handle, UCHAR deviceAddress,
+	DWORD writeSize, UCHAR *writeBuffer, DWORD readSize, LPDWORD sizeToRead)
+{
+	ChannelConfig *config = NULL;
+	FT_STATUS status;
+	uint8 *outBuffer;
+	uint32 i = 0;
+	uint32 sizeTotal;
+	DWORD noOfBytesTransferred = 0;
+
+	FN_ENTER;
+#ifdef ENABLE_PARAMETER_CHECKING
+	CHECK_NULL_RET(handle);
+	CHECK_NULL_RET(sizeToRead);
+	if ((writeSize > 0) && (NULL == writeBuffer))
+		return FT_INVALID_PARAMETER;
+	if (deviceAddress > 127)
+	{
+		DBG(MSG_WARN,"deviceAddress(0x%x) is greater than 127\n",
+			(unsigned)deviceAddress);
+	}
+#endif // ENABLE_PARAMETER_CHECKING
+	*sizeToRead = 0;
+	status = I2C_GetChannelConfig(handle, &config);
+	CHECK_STATUS(status);
+
+	sizeTotal = I2C_WRITE_READ_CMD_SIZE(writeSize, readSize) + 1;
+	outBuffer = (uint8*) INFRA_MALLOC(sizeTotal);
+	if (NULL == outBuffer)
+	{
+		return FT_INSUFFICIENT_RESOURCES;
+	}
+
+	i = I2C_AddWriteRead(config, outBuffer, i, deviceAddress, writeSize,
+		writeBuffer, readSize);
+	/*Command MPSSE to send data to PC immediately */
+	outBuffer[i++] = MPSSE_CMD_SEND_IMMEDIATE;
+	assert(i <= sizeTotal);
+
+	LOCK_CHANNEL(handle);
+	if (!(config->Options & I2C_DISABLE_TRANSFER_PURGE))
+	{
+		Mid_PurgeDevice(handle);
+	}
+	status = FT_Channel_Write(I2C, handle, i, outBuffer, &noOfBytesTransferred);
+	if ((FT_OK == status) && (i != noOfBytesTransferred))
+	{
+		DBG(MSG_ERR, "Requested to send %u bytes, no. of bytes sent is %u bytes",
+			(unsigned)i, (unsigned)noOfBytesTransferred);
+		status = FT_IO_ERROR;
+	}
+	UNLOCK_CHANNEL(handle);
+	INFRA_FREE(outBuffer);
+
+	if (FT_OK == status)
+	{/* the ACK bits, then the data */
+		*sizeToRead = I2C_WRITE_READ_ACKS(writeSize, readSize) + readSize;
+	}
+	FN_EXIT;
+	return status;
+}
+
+FTDIMPSSE_API FT_STATUS I2C_DeviceWriteReadReceive(FT_HANDLE handle, DWORD writeSize,
+	DWORD readSize, UCHAR *readBuffer, LPDWORD sizeTransferred)
+{
+	FT_STATUS status;
+	uint8 *inBuffer;
+	uint32 noOfAcks;
+	DWORD noOfBytesTransferred = 0;
+
+	FN_ENTER;
+#ifdef ENABLE_PARAMETER_CHECKING
+	CHECK_NULL_RET(handle);
+	CHECK_NULL_RET(sizeTransferred);
+	if ((readSize > 0) && (NULL == readBuffer))
+		return FT_INVALID_PARAMETER;
+#endif // ENABLE_PARAMETER_CHECKING
+	*sizeTransferred = 0;
+
+	noOfAcks = I2C_WRITE_READ_ACKS(writeSize, readSize);
+	inBuffer = (uint8*) INFRA_MALLOC(noOfAcks + readSize);
+	if (NULL == inBuffer)
+	{
+		return FT_INSUFFICIENT_RESOURCES;
+	}
+
+	LOCK_CHANNEL(handle);
+	/* the ACK bits and the data come back in one read */
+	status = FT_Channel_Read(I2C, handle, noOfAcks + readSize, inBuffer,
+		&noOfBytesTransferred);
+	if ((FT_OK == status) && ((noOfAcks + readSize) != noOfBytesTransferred))
+	{
+		DBG(MSG_ERR, "Requested to read %u bytes, no. of bytes read is %u bytes",
+			(unsigned)(noOfAcks + readSize), (unsigned)noOfBytesTransferred);
+		status = FT_IO_ERROR;
+	}
+	UNLOCK_CHANNEL(handle);
+
+	if (FT_OK == status)
+	{
+		status = I2C_CheckWriteReadAcks(inBuffer, writeSize, readSize);
+	}
+	if (FT_OK == status)
+	{
+		INFRA_MEMCPY(readBuffer, inBuffer + noOfAcks, readSize);
+		*sizeTransferred = readSize;
+	}
+	INFRA_FREE(inBuffer);
+	FN_EXIT;
+	return status;
+}
+
+FTDIMPSSE_API FT_STATUS I2C_Poll(FT_HANDLE handle, DWORD noOfEntries,
+	UCHAR *deviceAddresses, UCHAR *registers, DWORD *readSizes,
+	UCHAR *readBuffer, UCHAR *nAcked)
+{
+	FT_STATUS status;
+	DWORD sizeToRead = 0;
+
+	FN_ENTER;
+	LOCK_CHANNEL(handle);
+	status = I2C_PollSend(handle, noOfEntries, deviceAddresses, registers,
+		readSizes, &sizeToRead);
+	if (FT_OK == status)
+	{
+		status = I2C_PollReceive(handle, noOfEntries, readSizes, readBuffer,
+			nAcked);
+	}
+	UNLOCK_CHANNEL(handle);
+	FN_EXIT;
+	return status;
+}
+
+FTDIMPSSE_API FT_STATUS I2C_PollSend(FT_HANDLE handle, DWORD noOfEntries,
+	UCHAR *deviceAddresses, UCHAR *registers, DWORD *readSizes,
+	LPDWORD sizeToRead)
+{
+	ChannelConfig *config = NULL;
+	FT_STATUS status;
+	uint8 *outBuffer;
+	uint32 i = 0, j;
+	uint32 sizeTotal = 1;
+	uint32 sizeRead = 0;
+	DWORD noOfBytesTransferred = 0;
+
+	FN_ENTER;
+#ifdef ENABLE_PARAMETER_CHECKING
+	CHECK_NULL_RET(handle);
+	CHECK_NULL_RET(deviceAddresses);
+	CHECK_NULL_RET(registers);
+	CHECK_NULL_RET(readSizes);
+	CHECK_NULL_RET(sizeToRead);
+#endif // ENABLE_PARAMETER_CHECKING
+	*sizeToRead = 0;
+	status = I2C_GetChannelConfig(handle, &config);
+	CHECK_STATUS(status);
+
+	for (j = 0; j < noOfEntries; j++)
+	{
+		if (0 == readSizes[j])
+		{
+			return FT_INVALID_PARAMETER;
+		}
+		sizeTotal += I2C_WRITE_READ_CMD_SIZE(1, readSizes[j]);
+		sizeRead += I2C_WRITE_READ_ACKS(1, readSizes[j]) + readSizes[j];
+	}
+	outBuffer = (uint8*) INFRA_MALLOC(sizeTotal);
+	if (NULL == outBuffer)
+	{
+		return FT_INSUFFICIENT_RESOURCES;
+	}
+
+	for (j = 0; j < noOfEntries; j++)
+	{
+		i = I2C_AddWriteRead(config, outBuffer, i, deviceAddresses[j], 1,
+			&registers[j], readSizes[j]);
+	}
+	/*Command MPSSE to send data to PC immediately */
+	outBuffer[i++] = MPSSE_CMD_SEND_IMMEDIATE;
+	assert(i <= sizeTotal);
+
+	LOCK_CHANNEL(handle);
+	if (!(config->Options & I2C_DISABLE_TRANSFER_PURGE))
+	{
+		Mid_PurgeDevice(handle);
+	}
+	status = FT_Channel_Write(I2C, handle, i, outBuffer, &noOfBytesTransferred);
+	if ((FT_OK == status) && (i != noOfBytesTransferred))
+	{
+		DBG(MSG_ERR, "Requested to send %u bytes, no. of bytes sent is %u bytes",
+			(unsigned)i, (unsigned)noOfBytesTransferred);
+		status = FT_IO_ERROR;
+	}
+	UNLOCK_CHANNEL(handle);
+	INFRA_FREE(outBuffer);
+
+	if (FT_OK == status)
+	{/* the ACK bits and the data of every entry */
+		*sizeToRead = sizeRead;
+	}
+	FN_EXIT;
+	return status;
+}
+
+FTDIMPSSE_API FT_STATUS I2C_PollReceive(FT_HANDLE handle, DWORD noOfEntries,
+	DWORD *readSizes, UCHAR *readBuffer, UCHAR *nAcked)
+{
+	FT_STATUS status;
+	uint8 *inBuffer;
+	uint8 *in;
+	uint32 j;
+	uint32 sizeRead = 0;
+	uint32 noOfAcks;
+	DWORD noOfBytesTransferred = 0;
+
+	FN_ENTER;
+#ifdef ENABLE_PARAMETER_CHECKING
+	CHECK_NULL_RET(handle);
+	CHECK_NULL_RET(readSizes);
+	CHECK_NULL_RET(readBuffer);
+	CHECK_NULL_RET(nAcked);
+#endif // ENABLE_PARAMETER_CHECKING
+	for (j = 0; j < noOfEntries; j++)
+	{
+		sizeRead += I2C_WRITE_READ_ACKS(1, readSizes[j]) + readSizes[j];
+	}
+	inBuffer = (uint8*) INFRA_MALLOC(sizeRead);
+	if (NULL == inBuffer)
+	{
+		return FT_INSUFFICIENT_RESOURCES;
+	}
+
+	LOCK_CHANNEL(handle);
+	/* the ACK bits and the data of every entry come back in one read */
+	status = FT_Channel_Read(I2C, handle, sizeRead, inBuffer,
+		&noOfBytesTransferred);
+	if ((FT_OK == status) && (sizeRead != noOfBytesTransferred))
+	{
+		DBG(MSG_ERR, "Requested to read %u bytes, no. of bytes read is %u bytes",
+			(unsigned)sizeRead, (unsigned)noOfBytesTransferred);
+		status = FT_IO_ERROR;
+	}
+	UNLOCK_CHANNEL(handle);
+
+	if (FT_OK == status)
+	{
+		in = inBuffer;
+		for (j = 0; j < noOfEntries; j++)
+		{
+			noOfAcks = I2C_WRITE_READ_ACKS(1, readSizes[j]);
+			nAcked[j] = (FT_OK != I2C_CheckWriteReadAcks(in, 1, readSizes[j]));
+			INFRA_MEMCPY(readBuffer, in + noOfAcks, readSizes[j]);
+			readBuffer += readSizes[j];
+			in += noOfAcks + readSizes[j];
+		}
+	}
+	INFRA_FREE(inBuffer);
+	FN_EXIT;
+	return status;
+}
+
+FTDIMPSSE_API FT_STATUS I2C_DeviceWritePoll(FT_HANDLE handle, UCHAR deviceAddress,
+	DWORD writeSize, UCHAR *writeBuffer, DWORD noOfProbes, LPDWORD probesToAck)
+{
+	ChannelConfig *config = NULL;
+	FT_STATUS status;
+	uint8 *outBuffer;
+	uint8 *inBuffer;
+	uint32 i = 0, j;
+	uint32 sizeTotal;
+	uint32 noOfAcks;
+	DWORD noOfBytesTransferred = 0;
+
+	FN_ENTER;
+#ifdef ENABLE_PARAMETER_CHECKING
+	CHECK_NULL_RET(handle);
+	CHECK_NULL_RET(probesToAck);
+	if (((writeSize > 0) && (NULL == writeBuffer)) || ((0 == writeSize) && (0 == noOfProbes)))
+		return FT_INVALID_PARAMETER;
+#endif // ENABLE_PARAMETER_CHECKING
+	*probesToAck = 0;
+	status = I2C_GetChannelConfig(handle, &config);
+	CHECK_STATUS(status);
+
+	noOfAcks = I2C_WRITE_READ_ACKS(writeSize, 0) + noOfProbes;
+	sizeTotal = I2C_WRITE_READ_CMD_SIZE(writeSize, 0) +
+		noOfProbes * (I2C_START_CMD_SIZE + I2C_BYTE_CMD_SIZE + I2C_STOP_CMD_SIZE) + 1;
+	outBuffer = (uint8*) INFRA_MALLOC(sizeTotal);
+	inBuffer = (uint8*) INFRA_MALLOC(noOfAcks);
+	if ((NULL == outBuffer) || (NULL == inBuffer))
+	{
+		INFRA_FREE(outBuffer);
+		INFRA_FREE(inBuffer);
+		return FT_INSUFFICIENT_RESOURCES;
+	}
+
+	if (writeSize > 0)
+	{
+		i = I2C_AddWriteRead(config, outBuffer, i, deviceAddress, writeSize,
+			writeBuffer, 0);
+	}
+	for (j = 0; j < noOfProbes; j++)
+	{/* address for write, LSB = 0 */
+		i = I2C_AddStart(config, outBuffer, i);
+		i = I2C_AddWriteByte(config, outBuffer, i,
+			(uint8)((deviceAddress << 1) & I2C_ADDRESS_WRITE_MASK));
+		i = I2C_AddStop(config, outBuffer, i);
+	}
+	/*Command MPSSE to send data to PC immediately */
+	outBuffer[i++] = MPSSE_CMD_SEND_IMMEDIATE;
+	assert(i <= sizeTotal);
+
+	LOCK_CHANNEL(handle);
+	if (!(config->Options & I2C_DISABLE_TRANSFER_PURGE))
+	{
+		Mid_PurgeDevice(handle);
+	}
+	status = FT_Channel_Write(I2C, handle, i, outBuffer, &noOfBytesTransferred);
+	if ((FT_OK == status) && (i != noOfBytesTransferred))
+	{
+		DBG(MSG_ERR, "Requested to send %u bytes, no. of bytes sent is %u bytes",
+			(unsigned)i, (unsigned)noOfBytesTransferred);
+		status = FT_IO_ERROR;
+	}
+	if (FT_OK == status)
+	{/* the ACK bits of the write, then one per probe */
+		noOfBytesTransferred = 0;
+		status = FT_Channel_Read(I2C, handle, noOfAcks, inBuffer,
+			&noOfBytesTransferred);
+		if ((FT_OK == status) && (noOfAcks != noOfBytesTransferred))
+		{
+			DBG(MSG_ERR, "Requested to read %u bytes, no. of bytes read is %u bytes",
+				(unsigned)noOfAcks, (unsigned)noOfBytesTransferred);
+			status = FT_IO_ERROR;
+		}
+	}
+	UNLOCK_CHANNEL(handle);
+
+	if ((FT_OK == status) && (writeSize > 0))
+	{
+		status = I2C_CheckWriteReadAcks(inBuffer, writeSize, 0);
+	}
+	if (FT_OK == status)
+	{
+		for (j = 0; j < noOfProbes; j++)
+		{
+			if (!(inBuffer[I2C_WRITE_READ_ACKS(writeSize, 0) + j] & 0x01))
+			{/*ack bit clear means the device Acked*/
+				*probesToAck = j + 1;
+				break;
+			}
+		}
+	}
+	INFRA_FREE(outBuffer);
+	INFRA_FREE(inBuffer);
+	FN_EXIT;
+	return status;
+}
+
 /******************************************************************************/
 /*						Local function definitions						  */
 /******************************************************************************/
 #ifdef I2C_CMD_GETDEVICEID_SUPPORTED
 static FT_STATUS I2C_Restart(FT_HANDLE handle)
 {
+	ChannelConfig *config = NULL;
 	FT_STATUS status;
 	uint8 buffer[3];
 	uint32 noOfBytesToTransfer;
@@ -804,6 +1461,8 @@ static FT_STATUS I2C_Restart(FT_HANDLE handle)
 	I2C_Modes mode;
 
 	FN_ENTER;
+	/* A missing config only means the ADBUS4-7 state is not merged in */
+	I2C_GetChannelConfig(handle, &config);
 
 #if 0 /* Not necessary */
 	status = I2C_GetChannelConfig(handle, config);
@@ -839,9 +1498,7 @@ static FT_STATUS I2C_Restart(FT_HANDLE handle)
 	/*I2C_CONDITION_RESTART_1*/
 	noOfBytesToTransfer = 3;
 	noOfBytesTransferred = 0;
-	buffer[0] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;/* MPSSE command */
-	buffer[1] = VALUE_SCLHIGH_SDALOW; /* Value */
-	buffer[2] = DIRECTION_SCLOUT_SDAOUT; /* Direction */
+	I2C_SetLowByte(config, buffer, 0, VALUE_SCLHIGH_SDALOW, DIRECTION_SCLOUT_SDAOUT);
 	status = FT_Channel_Write(I2C, handle, noOfBytesToTransfer,
 		buffer,&noOfBytesTransferred);
 	if ( (FT_OK != status) && (noOfBytesToTransfer != noOfBytesTransferred) )
@@ -855,9 +1512,7 @@ static FT_STATUS I2C_Restart(FT_HANDLE handle)
 	/*I2C_CONDITION_RESTART_2*/
 	noOfBytesToTransfer = 3;
 	noOfBytesTransferred = 0;
-	buffer[0] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;/* MPSSE command */
-	buffer[1] = VALUE_SCLHIGH_SDAHIGH; /* Value */
-	buffer[2] = DIRECTION_SCLOUT_SDAOUT; /* Direction */
+	I2C_SetLowByte(config, buffer, 0, VALUE_SCLHIGH_SDAHIGH, DIRECTION_SCLOUT_SDAOUT);
 	status = FT_Channel_Write(I2C, handle, noOfBytesToTransfer,
 		buffer,&noOfBytesTransferred);
 	if ( (FT_OK != status) && (noOfBytesToTransfer != noOfBytesTransferred) )
@@ -871,9 +1526,7 @@ static FT_STATUS I2C_Restart(FT_HANDLE handle)
 	/*I2C_CONDITION_RESTART_3*/
 	noOfBytesToTransfer = 3;
 	noOfBytesTransferred = 0;
-	buffer[0] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;/* MPSSE command */
-	buffer[1] = VALUE_SCLLOW_SDAHIGH; /* Value */
-	buffer[2] = DIRECTION_SCLOUT_SDAOUT; /* Direction */
+	I2C_SetLowByte(config, buffer, 0, VALUE_SCLLOW_SDAHIGH, DIRECTION_SCLOUT_SDAOUT);
 	status = FT_Channel_Write(I2C, handle, noOfBytesToTransfer,
 		buffer,&noOfBytesTransferred);
 	if ( (FT_OK != status) && (noOfBytesToTransfer != noOfBytesTransferred) )
@@ -887,9 +1540,7 @@ static FT_STATUS I2C_Restart(FT_HANDLE handle)
 	/*I2C_CONDITION_RESTART_4*/
 	noOfBytesToTransfer = 3;
 	noOfBytesTransferred = 0;
-	buffer[0] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;/* MPSSE command */
-	buffer[1] = VALUE_SCLHIGH_SDAHIGH; /* Value */
-	buffer[2] = DIRECTION_SCLOUT_SDAOUT; /* Direction */
+	I2C_SetLowByte(config, buffer, 0, VALUE_SCLHIGH_SDAHIGH, DIRECTION_SCLOUT_SDAOUT);
 	status = FT_Channel_Write(I2C, handle, noOfBytesToTransfer,
 		buffer,&noOfBytesTransferred);
 	if ( (FT_OK != status) && (noOfBytesToTransfer != noOfBytesTransferred) )
@@ -903,9 +1554,7 @@ static FT_STATUS I2C_Restart(FT_HANDLE handle)
 	/*I2C_CONDITION_RESTART_5*/
 	noOfBytesToTransfer = 3;
 	noOfBytesTransferred = 0;
-	buffer[0] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;/* MPSSE command */
-	buffer[1] = VALUE_SCLLOW_SDAHIGH; /* Value */
-	buffer[2] = DIRECTION_SCLOUT_SDAOUT; /* Direction */
+	I2C_SetLowByte(config, buffer, 0, VALUE_SCLLOW_SDAHIGH, DIRECTION_SCLOUT_SDAOUT);
 	status = FT_Channel_Write(I2C, handle, noOfBytesToTransfer,
 		buffer,&noOfBytesTransferred);
 	if ( (FT_OK != status) && (noOfBytesToTransfer != noOfBytesTransferred) )
@@ -919,9 +1568,7 @@ static FT_STATUS I2C_Restart(FT_HANDLE handle)
 	/*I2C_CONDITION_RESTART -tristate SCL & SDA */
 	noOfBytesToTransfer = 3;
 	noOfBytesTransferred = 0;
-	buffer[0] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;/* MPSSE command */
-	buffer[1] = VALUE_SCLLOW_SDALOW; /* Value(0x00 = SCL low, SDA low) */
-	buffer[2] = DIRECTION_SCLIN_SDAIN; /* Direction */
+	I2C_SetLowByte(config, buffer, 0, VALUE_SCLLOW_SDALOW, DIRECTION_SCLIN_SDAIN);
 	status = FT_Channel_Write(I2C, handle, noOfBytesToTransfer,
 		buffer,&noOfBytesTransferred);
 	if ( (FT_OK != status) && (noOfBytesToTransfer != noOfBytesTransferred) )
@@ -939,6 +1586,7 @@ static FT_STATUS I2C_Restart(FT_HANDLE handle)
 
 static FT_STATUS I2C_Write8bitsAndGetAck(FT_HANDLE handle, uint8 data, bool *ack)
 {
+	ChannelConfig *config = NULL;
 	FT_STATUS status = FT_OTHER_ERROR;
 	uint8 buffer[20]={0};
 	uint8 inBuffer[3]={0};
@@ -946,11 +1594,11 @@ static FT_STATUS I2C_Write8bitsAndGetAck(FT_HANDLE handle, uint8 data, bool *ack
 	DWORD noOfBytesTransferred;
 
 	FN_ENTER;
+	/* A missing config only means the ADBUS4-7 state is not merged in */
+	I2C_GetChannelConfig(handle, &config);
 
 	/*set direction*/
-	buffer[noOfBytes++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;/* MPSSE command */
-	buffer[noOfBytes++] = VALUE_SCLLOW_SDAHIGH; /*Value*/
-	buffer[noOfBytes++] = DIRECTION_SCLOUT_SDAOUT; /*Direction*/
+	noOfBytes = I2C_SetLowByte(config, buffer, noOfBytes, VALUE_SCLLOW_SDAHIGH, DIRECTION_SCLOUT_SDAOUT);
 
 	/* Command to write 8bits */
 	buffer[noOfBytes++]= MPSSE_CMD_DATA_OUT_BITS_NEG_EDGE;/* MPSSE command */
@@ -958,9 +1606,7 @@ static FT_STATUS I2C_Write8bitsAndGetAck(FT_HANDLE handle, uint8 data, bool *ack
 	buffer[noOfBytes++] = data;
 
 	/* Set SDA to input mode before reading ACK bit */
-	buffer[noOfBytes++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;/* MPSSE command */
-	buffer[noOfBytes++] = VALUE_SCLLOW_SDALOW; /*Value*/
-	buffer[noOfBytes++] = DIRECTION_SCLOUT_SDAIN; /*Direction*/
+	noOfBytes = I2C_SetLowByte(config, buffer, noOfBytes, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAIN);
 
 	/* Command to get ACK bit */
 	buffer[noOfBytes++] = MPSSE_CMD_DATA_IN_BITS_POS_EDGE;/* MPSSE command */
@@ -1014,17 +1660,18 @@ static FT_STATUS I2C_Write8bitsAndGetAck(FT_HANDLE handle, uint8 data, bool *ack
 
 static FT_STATUS I2C_Read8bitsAndGiveAck(FT_HANDLE handle, uint8 *data, bool ack)
 {
+	ChannelConfig *config = NULL;
 	FT_STATUS status = FT_OTHER_ERROR;
 	uint8 buffer[20], inBuffer[5];
 	uint32 noOfBytes = 0;
 	DWORD noOfBytesTransferred;
 
 	FN_ENTER;
+	/* A missing config only means the ADBUS4-7 state is not merged in */
+	I2C_GetChannelConfig(handle, &config);
 	
 	/*set direction*/
-	buffer[noOfBytes++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;/* MPSSE command */
-	buffer[noOfBytes++] = VALUE_SCLLOW_SDALOW; /*Value*/
-	buffer[noOfBytes++] = DIRECTION_SCLOUT_SDAIN; /*Direction*/
+	noOfBytes = I2C_SetLowByte(config, buffer, noOfBytes, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAIN);
 
 	/*Command to read 8 bits*/
 	buffer[noOfBytes++] = MPSSE_CMD_DATA_IN_BITS_POS_EDGE;
@@ -1033,9 +1680,7 @@ static FT_STATUS I2C_Read8bitsAndGiveAck(FT_HANDLE handle, uint8 *data, bool ack
 	if (ack)
 	{
 		/* We will drive the ACK bit to a '0' so pre-set pin to a '0' */
-		buffer[noOfBytes++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-		buffer[noOfBytes++] = VALUE_SCLLOW_SDALOW;
-		buffer[noOfBytes++] = DIRECTION_SCLOUT_SDAOUT;
+		noOfBytes = I2C_SetLowByte(config, buffer, noOfBytes, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAOUT);
 
 		/* Clock out the ack bit as a '0' on negative edge */
 		buffer[noOfBytes++] = MPSSE_CMD_DATA_OUT_BITS_NEG_EDGE;
@@ -1045,9 +1690,7 @@ static FT_STATUS I2C_Read8bitsAndGiveAck(FT_HANDLE handle, uint8 *data, bool ack
 	else
 	{
 		/* We will release the ACK bit to a '1' so pre-set pin to a '1' by making it an input */
-		buffer[noOfBytes++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-		buffer[noOfBytes++] = VALUE_SCLLOW_SDALOW;
-		buffer[noOfBytes++] = DIRECTION_SCLOUT_SDAIN;
+		noOfBytes = I2C_SetLowByte(config, buffer, noOfBytes, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAIN);
 
 		/* Clock out the ack bit as a '1' on negative edge - never actually seen on line since SDA is input but burns off one bit time */
 		buffer[noOfBytes++] = MPSSE_CMD_DATA_OUT_BITS_NEG_EDGE;
@@ -1056,9 +1699,7 @@ static FT_STATUS I2C_Read8bitsAndGiveAck(FT_HANDLE handle, uint8 *data, bool ack
 	}
 
 	/* Back to Idle */
-	buffer[noOfBytes++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-	buffer[noOfBytes++] = VALUE_SCLLOW_SDALOW;
-	buffer[noOfBytes++] = DIRECTION_SCLOUT_SDAIN;
+	noOfBytes = I2C_SetLowByte(config, buffer, noOfBytes, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAIN);
 
 	/* Command MPSSE to send data to PC immediately */
 	buffer[noOfBytes++] = MPSSE_CMD_SEND_IMMEDIATE;
@@ -1101,6 +1742,7 @@ static FT_STATUS I2C_FastWrite(FT_HANDLE handle, UCHAR deviceAddress,
 	DWORD sizeToTransfer, UCHAR *buffer, UCHAR *ack, LPDWORD sizeTransferred,
 	uint32 options)
 {
+	ChannelConfig *config = NULL;
 	FT_STATUS status = FT_OK;
 	uint32 i = 0; /* index of cmdBuffer that is filled */
 	uint32 j = 0; /* scratch register */
@@ -1116,6 +1758,8 @@ static FT_STATUS I2C_FastWrite(FT_HANDLE handle, UCHAR deviceAddress,
 	uint32 bitsToRead = 0;
 
 	FN_ENTER;
+	/* A missing config only means the ADBUS4-7 state is not merged in */
+	I2C_GetChannelConfig(handle, &config);
 
 	if (options & I2C_TRANSFER_OPTIONS_FAST_TRANSFER_BITS)
 	{/* size is in bits */
@@ -1156,21 +1800,15 @@ static FT_STATUS I2C_FastWrite(FT_HANDLE handle, UCHAR deviceAddress,
 		/* SCL high, SDA high */
 		for (j = 0; j < START_DURATION_1; j++)
 		{
-			outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-			outBuffer[i++] = VALUE_SCLHIGH_SDAHIGH;
-			outBuffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+			i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLHIGH_SDAHIGH, DIRECTION_SCLOUT_SDAOUT);
 		}
 		/* SCL high, SDA low */
 		for (j = 0; j < START_DURATION_2; j++)
 		{
-			outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-			outBuffer[i++] = VALUE_SCLHIGH_SDALOW;
-			outBuffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+			i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLHIGH_SDALOW, DIRECTION_SCLOUT_SDAOUT);
 		}
 		/*SCL low, SDA low */
-		outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-		outBuffer[i++] = VALUE_SCLLOW_SDALOW;
-		outBuffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+		i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAOUT);
 	}
 
 	if (!(options & I2C_TRANSFER_OPTIONS_NO_ADDRESS))
@@ -1181,9 +1819,7 @@ static FT_STATUS I2C_FastWrite(FT_HANDLE handle, UCHAR deviceAddress,
 		DBG(MSG_DEBUG,"7bit I2C address plus direction bit = 0x%x\n", tempAddress);
 
 		/*set direction*/
-		outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;/* MPSSE command */
-		outBuffer[i++] = VALUE_SCLLOW_SDAHIGH; /*Value*/
-		outBuffer[i++] = DIRECTION_SCLOUT_SDAOUT; /*Direction*/
+		i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLLOW_SDAHIGH, DIRECTION_SCLOUT_SDAOUT);
 
 		/* write address + direction bit */
 		outBuffer[i++]= MPSSE_CMD_DATA_OUT_BITS_NEG_EDGE;/* MPSSE command */
@@ -1192,9 +1828,7 @@ static FT_STATUS I2C_FastWrite(FT_HANDLE handle, UCHAR deviceAddress,
 
 #ifdef FASTWRITE_READ_ACK
 		/* Set SDA to input mode before reading ACK bit */
-		outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;/* MPSSE command */
-		outBuffer[i++] = VALUE_SCLLOW_SDALOW; /*Value*/
-		outBuffer[i++] = DIRECTION_SCLOUT_SDAIN; /*Direction*/
+		i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAIN);
 
 		/* Command to get ACK bit */
 		outBuffer[i++] = MPSSE_CMD_DATA_IN_BITS_POS_EDGE;/* MPSSE command */
@@ -1209,9 +1843,7 @@ static FT_STATUS I2C_FastWrite(FT_HANDLE handle, UCHAR deviceAddress,
 	{
 		bitsInThisTransfer = ((bitsToTransfer-j)>8)?8:(bitsToTransfer-j);
 		/*set direction*/
-		outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;/* MPSSE command */
-		outBuffer[i++] = VALUE_SCLLOW_SDAHIGH; /*Value*/
-		outBuffer[i++] = DIRECTION_SCLOUT_SDAOUT; /*Direction*/
+		i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLLOW_SDAHIGH, DIRECTION_SCLOUT_SDAOUT);
 
 		/* Command to write 8bits */
 		bitsInThisTransfer = ((bitsToTransfer-j)>8)?8:(bitsToTransfer-j);
@@ -1224,9 +1856,7 @@ static FT_STATUS I2C_FastWrite(FT_HANDLE handle, UCHAR deviceAddress,
 		if (options & I2C_TRANSFER_OPTIONS_FAST_TRANSFER_BYTES)
 		{
 			/* Set SDA to input mode before reading ACK bit */
-			outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;/* MPSSE command */
-			outBuffer[i++] = VALUE_SCLLOW_SDALOW; /*Value*/
-			outBuffer[i++] = DIRECTION_SCLOUT_SDAIN; /*Direction*/
+			i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAIN);
 
 			/* Command to get ACK bit */
 			outBuffer[i++] = MPSSE_CMD_DATA_IN_BITS_POS_EDGE;/* MPSSE command */
@@ -1245,27 +1875,19 @@ static FT_STATUS I2C_FastWrite(FT_HANDLE handle, UCHAR deviceAddress,
 		/* SCL low, SDA low */
 		for (j = 0; j < STOP_DURATION_1; j++)
 		{
-			outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-			outBuffer[i++] = VALUE_SCLLOW_SDALOW;
-			outBuffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+			i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAOUT);
 		}
 		/* SCL high, SDA low */
 		for (j = 0; j < STOP_DURATION_2; j++)
 		{
-			outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-			outBuffer[i++] = VALUE_SCLHIGH_SDALOW;
-			outBuffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+			i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLHIGH_SDALOW, DIRECTION_SCLOUT_SDAOUT);
 		}
 		/* SCL high, SDA high */
 		for (j = 0; j < STOP_DURATION_3; j++)
 		{
-			outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-			outBuffer[i++] = VALUE_SCLHIGH_SDAHIGH;
-			outBuffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+			i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLHIGH_SDAHIGH, DIRECTION_SCLOUT_SDAOUT);
 		}
-		outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-		outBuffer[i++] = VALUE_SCLHIGH_SDAHIGH;
-		outBuffer[i++] = DIRECTION_SCLIN_SDAIN; /* Tristate the SCL & SDA pins */
+		i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLHIGH_SDAHIGH, DIRECTION_SCLIN_SDAIN); /* Tristate the SCL & SDA pins */
 	}
 
 	assert(i <= sizeTotal); 
@@ -1313,6 +1935,7 @@ static FT_STATUS I2C_FastRead(FT_HANDLE handle, UCHAR deviceAddress,
 	DWORD sizeToTransfer, UCHAR *buffer, UCHAR *ack, DWORD *sizeTransferred,
 	uint32 options)
 {
+	ChannelConfig *config = NULL;
 	FT_STATUS status = FT_OK;
 	uint32 i = 0; /* index of cmdBuffer that is filled */
 	uint32 j = 0; /* scratch register */
@@ -1327,6 +1950,8 @@ static FT_STATUS I2C_FastRead(FT_HANDLE handle, UCHAR deviceAddress,
 	uint32 bitsToTransfer;
 
 	FN_ENTER;
+	/* A missing config only means the ADBUS4-7 state is not merged in */
+	I2C_GetChannelConfig(handle, &config);
 
 	if (options & I2C_TRANSFER_OPTIONS_FAST_TRANSFER_BITS)
 	{/* size is in bits */
@@ -1362,21 +1987,15 @@ static FT_STATUS I2C_FastRead(FT_HANDLE handle, UCHAR deviceAddress,
 		/* SCL high, SDA high */
 		for (j = 0; j < START_DURATION_1; j++)
 		{
-			outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-			outBuffer[i++] = VALUE_SCLHIGH_SDAHIGH;
-			outBuffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+			i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLHIGH_SDAHIGH, DIRECTION_SCLOUT_SDAOUT);
 		}
 		/* SCL high, SDA low */
 		for (j = 0; j < START_DURATION_2; j++)
 		{
-			outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-			outBuffer[i++] = VALUE_SCLHIGH_SDALOW;
-			outBuffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+			i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLHIGH_SDALOW, DIRECTION_SCLOUT_SDAOUT);
 		}
 		/*SCL low, SDA low */
-		outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-		outBuffer[i++] = VALUE_SCLLOW_SDALOW;
-		outBuffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+		i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAOUT);
 	}
 
 	if (!(options & I2C_TRANSFER_OPTIONS_NO_ADDRESS))
@@ -1387,9 +2006,7 @@ static FT_STATUS I2C_FastRead(FT_HANDLE handle, UCHAR deviceAddress,
 		DBG(MSG_DEBUG,"7bit I2C address plus direction bit = 0x%x\n", tempAddress);
 
 		/*set direction*/
-		outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;/* MPSSE command */
-		outBuffer[i++] = VALUE_SCLLOW_SDAHIGH; /*Value*/
-		outBuffer[i++] = DIRECTION_SCLOUT_SDAOUT; /*Direction*/
+		i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLLOW_SDAHIGH, DIRECTION_SCLOUT_SDAOUT);
 
 		/* write address + direction bit */
 		outBuffer[i++]= MPSSE_CMD_DATA_OUT_BITS_NEG_EDGE;/* MPSSE command */
@@ -1398,9 +2015,7 @@ static FT_STATUS I2C_FastRead(FT_HANDLE handle, UCHAR deviceAddress,
 
 #ifdef FASTWRITE_READ_ACK
 		/* Set SDA to input mode before reading ACK bit */
-		outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;/* MPSSE command */
-		outBuffer[i++] = VALUE_SCLLOW_SDALOW; /*Value*/
-		outBuffer[i++] = DIRECTION_SCLOUT_SDAIN; /*Direction*/
+		i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAIN);
 
 		/* Command to get ACK bit */
 		outBuffer[i++] = MPSSE_CMD_DATA_IN_BITS_POS_EDGE;/* MPSSE command */
@@ -1415,9 +2030,7 @@ static FT_STATUS I2C_FastRead(FT_HANDLE handle, UCHAR deviceAddress,
 		bitsInThisTransfer = ((bitsToTransfer-j)>8)?8:(bitsToTransfer-j);
 
 		/*set direction*/
-		outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;/* MPSSE command */
-		outBuffer[i++] = VALUE_SCLLOW_SDALOW; /*Value*/
-		outBuffer[i++] = DIRECTION_SCLOUT_SDAIN; /*Direction*/
+		i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAIN);
 
 		/*Command to read 8 bits*/
 		outBuffer[i++] = MPSSE_CMD_DATA_IN_BITS_POS_EDGE;
@@ -1429,9 +2042,7 @@ static FT_STATUS I2C_FastRead(FT_HANDLE handle, UCHAR deviceAddress,
 		/* Write 1bit ack after each 8bits read - only in byte mode */
 		if (options & I2C_TRANSFER_OPTIONS_FAST_TRANSFER_BYTES)
 		{
-			outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-			outBuffer[i++] = VALUE_SCLLOW_SDALOW ;  
-			outBuffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+			i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAOUT);
 
 			// Burn off one I2C bit time
 			outBuffer[i++] = MPSSE_CMD_DATA_OUT_BITS_NEG_EDGE;
@@ -1449,27 +2060,19 @@ static FT_STATUS I2C_FastRead(FT_HANDLE handle, UCHAR deviceAddress,
 		/* SCL low, SDA low */
 		for (j = 0; j < STOP_DURATION_1; j++)
 		{
-			outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-			outBuffer[i++] = VALUE_SCLLOW_SDALOW;
-			outBuffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+			i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAOUT);
 		}
 		/* SCL high, SDA low */
 		for (j = 0; j < STOP_DURATION_2; j++)
 		{
-			outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-			outBuffer[i++] = VALUE_SCLHIGH_SDALOW;
-			outBuffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+			i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLHIGH_SDALOW, DIRECTION_SCLOUT_SDAOUT);
 		}
 		/* SCL high, SDA high */
 		for (j = 0; j < STOP_DURATION_3; j++)
 		{
-			outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-			outBuffer[i++] = VALUE_SCLHIGH_SDAHIGH;
-			outBuffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+			i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLHIGH_SDAHIGH, DIRECTION_SCLOUT_SDAOUT);
 		}
-		outBuffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-		outBuffer[i++] = VALUE_SCLHIGH_SDAHIGH;
-		outBuffer[i++] = DIRECTION_SCLIN_SDAIN; /* Tristate the SCL & SDA pins */
+		i = I2C_SetLowByte(config, outBuffer, i, VALUE_SCLHIGH_SDAHIGH, DIRECTION_SCLIN_SDAIN); /* Tristate the SCL & SDA pins */
 	}
 
 	/* write buffer */
@@ -1556,6 +2159,8 @@ static FT_STATUS I2C_AddChannelConfig(FT_HANDLE handle)
 		{
 			gListHead ->handle = handle;
 			gListHead ->next = NULL;
+			/* No stale pin state before I2C_InitChannel saves the config */
+			memset(&gListHead ->config, 0, sizeof(ChannelConfig));
 			status = FT_OK;
 		}
 	}
@@ -1577,6 +2182,7 @@ static FT_STATUS I2C_AddChannelConfig(FT_HANDLE handle)
 			tempNode->handle = handle;
 			tempNode->next = NULL;
 			lastNode->next = tempNode;
+			memset(&tempNode->config, 0, sizeof(ChannelConfig));
 			status = FT_OK;
 		}
 	}
@@ -1742,31 +2348,28 @@ static FT_STATUS I2C_DisplayList(void)
 
 static FT_STATUS I2C_Start(FT_HANDLE handle)
 {
+	ChannelConfig *config = NULL;
 	FT_STATUS status;
 	uint8 buffer[(START_DURATION_1+START_DURATION_2+1)*3];
 	uint32 i = 0, j = 0;
 	DWORD noOfBytesTransferred;
 	
 	FN_ENTER;
+	/* A missing config only means the ADBUS4-7 state is not merged in */
+	I2C_GetChannelConfig(handle, &config);
 
 	/* SCL high, SDA high */
 	for (j = 0; j < START_DURATION_1; j++)
 	{
-		buffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-		buffer[i++] = VALUE_SCLHIGH_SDAHIGH;
-		buffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+		i = I2C_SetLowByte(config, buffer, i, VALUE_SCLHIGH_SDAHIGH, DIRECTION_SCLOUT_SDAOUT);
 	}
 	/* SCL high, SDA low */
 	for (j = 0; j < START_DURATION_2; j++)
 	{
-		buffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-		buffer[i++] = VALUE_SCLHIGH_SDALOW;
-		buffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+		i = I2C_SetLowByte(config, buffer, i, VALUE_SCLHIGH_SDALOW, DIRECTION_SCLOUT_SDAOUT);
 	}
 	/*SCL low, SDA low */
-	buffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-	buffer[i++] = VALUE_SCLLOW_SDALOW;
-	buffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+	i = I2C_SetLowByte(config, buffer, i, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAOUT);
 
 	status = FT_Channel_Write(I2C, handle, i,buffer,&noOfBytesTransferred);
 
@@ -1776,37 +2379,32 @@ static FT_STATUS I2C_Start(FT_HANDLE handle)
 
 static FT_STATUS I2C_Stop(FT_HANDLE handle)
 {
+	ChannelConfig *config = NULL;
 	FT_STATUS status;
 	uint8 buffer[(STOP_DURATION_1+STOP_DURATION_2+STOP_DURATION_3+1)*3];
 	uint32 i = 0, j = 0;
 	DWORD noOfBytesTransferred;
 
 	FN_ENTER;
+	/* A missing config only means the ADBUS4-7 state is not merged in */
+	I2C_GetChannelConfig(handle, &config);
 	
 	/* SCL low, SDA low */
 	for (j = 0; j < STOP_DURATION_1; j++)
 	{
-		buffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-		buffer[i++] = VALUE_SCLLOW_SDALOW;
-		buffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+		i = I2C_SetLowByte(config, buffer, i, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAOUT);
 	}
 	/* SCL high, SDA low */
 	for (j = 0; j < STOP_DURATION_2; j++)
 	{
-		buffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-		buffer[i++] = VALUE_SCLHIGH_SDALOW;
-		buffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+		i = I2C_SetLowByte(config, buffer, i, VALUE_SCLHIGH_SDALOW, DIRECTION_SCLOUT_SDAOUT);
 	}
 	/* SCL high, SDA high */
 	for (j = 0; j < STOP_DURATION_3; j++)
 	{
-		buffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-		buffer[i++] = VALUE_SCLHIGH_SDAHIGH;
-		buffer[i++] = DIRECTION_SCLOUT_SDAOUT;
+		i = I2C_SetLowByte(config, buffer, i, VALUE_SCLHIGH_SDAHIGH, DIRECTION_SCLOUT_SDAOUT);
 	}
-	buffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
-	buffer[i++] = VALUE_SCLHIGH_SDAHIGH;
-	buffer[i++] = DIRECTION_SCLIN_SDAIN; /* Tristate the SCL & SDA pins */
+	i = I2C_SetLowByte(config, buffer, i, VALUE_SCLHIGH_SDAHIGH, DIRECTION_SCLIN_SDAIN); /* Tristate the SCL & SDA pins */
 
 	status = FT_Channel_Write(I2C, handle, i,buffer,&noOfBytesTransferred);
 
@@ -1814,4 +2412,151 @@ static FT_STATUS I2C_Stop(FT_HANDLE handle)
 	return status;
 }
 
+static uint32 I2C_SetLowByte(ChannelConfig *config, uint8 *buffer, uint32 i,
+	uint8 value, uint8 direction)
+{
+	if (NULL != config)
+	{
+		value = (value & ~I2C_GPIO_LOW_MASK) |
+			((uint8)(config->currentPinState>>8) & I2C_GPIO_LOW_MASK);
+		direction = (direction & ~I2C_GPIO_LOW_MASK) |
+			((uint8)config->currentPinState & I2C_GPIO_LOW_MASK);
+		config->currentPinState = ((uint16)value<<8) | direction;
+	}
+	buffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;/* MPSSE command */
+	buffer[i++] = value; /*Value*/
+	buffer[i++] = direction; /*Direction*/
+	return i;
+}
+
+static uint32 I2C_AddStart(ChannelConfig *config, uint8 *buffer, uint32 i)
+{
+	uint32 j;
+
+	/* SCL high, SDA high */
+	for (j = 0; j < START_DURATION_1; j++)
+	{
+		i = I2C_SetLowByte(config, buffer, i, VALUE_SCLHIGH_SDAHIGH, DIRECTION_SCLOUT_SDAOUT);
+	}
+	/* SCL high, SDA low */
+	for (j = 0; j < START_DURATION_2; j++)
+	{
+		i = I2C_SetLowByte(config, buffer, i, VALUE_SCLHIGH_SDALOW, DIRECTION_SCLOUT_SDAOUT);
+	}
+	/*SCL low, SDA low */
+	return I2C_SetLowByte(config, buffer, i, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAOUT);
+}
+
+static uint32 I2C_AddStop(ChannelConfig *config, uint8 *buffer, uint32 i)
+{
+	uint32 j;
+
+	/* SCL low, SDA low */
+	for (j = 0; j < STOP_DURATION_1; j++)
+	{
+		i = I2C_SetLowByte(config, buffer, i, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAOUT);
+	}
+	/* SCL high, SDA low */
+	for (j = 0; j < STOP_DURATION_2; j++)
+	{
+		i = I2C_SetLowByte(config, buffer, i, VALUE_SCLHIGH_SDALOW, DIRECTION_SCLOUT_SDAOUT);
+	}
+	/* SCL high, SDA high */
+	for (j = 0; j < STOP_DURATION_3; j++)
+	{
+		i = I2C_SetLowByte(config, buffer, i, VALUE_SCLHIGH_SDAHIGH, DIRECTION_SCLOUT_SDAOUT);
+	}
+	return I2C_SetLowByte(config, buffer, i, VALUE_SCLHIGH_SDAHIGH, DIRECTION_SCLIN_SDAIN); /* Tristate the SCL & SDA pins */
+}
+
+static uint32 I2C_AddWriteByte(ChannelConfig *config, uint8 *buffer, uint32 i,
+	uint8 data)
+{
+	/*set direction*/
+	i = I2C_SetLowByte(config, buffer, i, VALUE_SCLLOW_SDAHIGH, DIRECTION_SCLOUT_SDAOUT);
+
+	/* Command to write 8bits */
+	buffer[i++] = MPSSE_CMD_DATA_OUT_BITS_NEG_EDGE;/* MPSSE command */
+	buffer[i++] = DATA_SIZE_8BITS;
+	buffer[i++] = data;
+
+	/* Set SDA to input mode before reading ACK bit */
+	i = I2C_SetLowByte(config, buffer, i, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAIN);
+
+	/* Command to get ACK bit */
+	buffer[i++] = MPSSE_CMD_DATA_IN_BITS_POS_EDGE;/* MPSSE command */
+	buffer[i++] = DATA_SIZE_1BIT; /* Read only one bit */
+	return i;
+}
+
+static uint32 I2C_AddReadByte(ChannelConfig *config, uint8 *buffer, uint32 i,
+	uint8 ack)
+{
+	/*set direction*/
+	i = I2C_SetLowByte(config, buffer, i, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAIN);
+
+	/*Command to read 8 bits*/
+	buffer[i++] = MPSSE_CMD_DATA_IN_BITS_POS_EDGE;
+	buffer[i++] = DATA_SIZE_8BITS;
+
+	/* Write 1bit ack after the 8bits read */
+	i = I2C_SetLowByte(config, buffer, i, VALUE_SCLLOW_SDALOW, DIRECTION_SCLOUT_SDAOUT);
+	buffer[i++] = MPSSE_CMD_DATA_OUT_BITS_NEG_EDGE;
+	buffer[i++] = 0; /*0x00 = 1bit; 0x07 = 8bits*/
+	buffer[i++] = ack;
+	return i;
+}
+
+static uint32 I2C_AddWriteRead(ChannelConfig *config, uint8 *buffer, uint32 i,
+	UCHAR deviceAddress, DWORD writeSize, UCHAR *writeBuffer, DWORD readSize)
+{
+	uint32 j;
+
+	i = I2C_AddStart(config, buffer, i);
+	if (writeSize > 0)
+	{
+		i = I2C_AddWriteByte(config, buffer, i,
+			(uint8)((deviceAddress << 1) & I2C_ADDRESS_WRITE_MASK));
+		for (j = 0; j < writeSize; j++)
+		{
+			i = I2C_AddWriteByte(config, buffer, i, writeBuffer[j]);
+		}
+		if (readSize > 0)
+		{/* release SDA while SCL is low, before the repeated START */
+			i = I2C_SetLowByte(config, buffer, i, VALUE_SCLLOW_SDAHIGH, DIRECTION_SCLOUT_SDAOUT);
+			i = I2C_AddStart(config, buffer, i);
+		}
+	}
+	if (readSize > 0)
+	{
+		i = I2C_AddWriteByte(config, buffer, i,
+			(uint8)((deviceAddress << 1) | I2C_ADDRESS_READ_MASK));
+		for (j = 0; j < readSize; j++)
+		{
+			i = I2C_AddReadByte(config, buffer, i,
+				((j + 1) < readSize) ? SEND_ACK : SEND_NACK);
+		}
+	}
+	return I2C_AddStop(config, buffer, i);
+}
+
+static FT_STATUS I2C_CheckWriteReadAcks(uint8 *inBuffer, DWORD writeSize,
+	DWORD readSize)
+{
+	uint32 j;
+	uint32 noOfAcks = I2C_WRITE_READ_ACKS(writeSize, readSize);
+
+	if (inBuffer[0] & 0x01)/*ack bit set actually means device nAcked*/
+	{
+		return FT_DEVICE_NOT_FOUND;
+	}
+	for (j = 1; j < noOfAcks; j++)
+	{
+		if (inBuffer[j] & 0x01)
+		{
+			return FT_FAILED_TO_WRITE_DEVICE;
+		}
+	}
+	return FT_OK;
+}
 
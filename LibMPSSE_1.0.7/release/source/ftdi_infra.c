@@ -23,6 +23,7 @@
  * 0.1 - initial version
  * 0.2 - 20110708 - exported Init_libMPSSE & Cleanup_libMPSSE for Microsoft toolchain support
  * 0.3 - 20111103 - commented & cleaned up
+ * 0.4 - 20261018 - load FT_SetEventNotification
  */
 
 /******************************************************************************/
@@ -303,6 +304,9 @@ FTDIMPSSE_API void Init_libMPSSE(void)
 	/*FT_GetDeviceInfo*/
 	varFunctionPtrLst.p_FT_GetDeviceInfo = (pfunc_FT_GetDeviceInfo)GET_FUNC(hdll_d2xx,"FT_GetDeviceInfo");
 	CHECK_SYMBOL(varFunctionPtrLst.p_FT_GetDeviceInfo);
+	/*FT_SetEventNotification*/
+	varFunctionPtrLst.p_FT_SetEventNotification = (pfunc_FT_SetEventNotification)GET_FUNC(hdll_d2xx,"FT_SetEventNotification");
+	CHECK_SYMBOL(varFunctionPtrLst.p_FT_SetEventNotification);
 
 	/*Call module specific initialization functions from here(if at all they are required)
 		Example:
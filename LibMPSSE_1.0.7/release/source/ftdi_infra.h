@@ -26,6 +26,7 @@
  * 0.1 - initial version
  * 0.2 - 20110708 - added memory related macros
  * 0.3 - 20111103 - added 64bit linux support, cleaned up
+ * 0.4 - 20261018 - added FT_SetEventNotification to the function pointer list
  *
  */
 
@@ -213,6 +214,7 @@ typedef FT_STATUS (CAL_CONV *pfunc_FT_GetQueueStatus) (FT_HANDLE ftHandle, LPDWO
 typedef FT_STATUS (CAL_CONV *pfunc_FT_Read) (FT_HANDLE ftHandle, LPVOID lpBuffer, DWORD dwBytesToRead, LPDWORD lpdwBytesReturned);
 typedef FT_STATUS (CAL_CONV *pfunc_FT_Write) (FT_HANDLE ftHandle, LPVOID lpBuffer, DWORD dwBytesToWrite, LPDWORD lpdwBytesWritten);
 typedef FT_STATUS (CAL_CONV *pfunc_FT_GetDeviceInfo)(FT_HANDLE ftHandle, FT_DEVICE *lpftDevice, LPDWORD lpdwID, PCHAR SerialNumber, PCHAR Description, LPVOID Dummy);
+typedef FT_STATUS (CAL_CONV *pfunc_FT_SetEventNotification)(FT_HANDLE ftHandle, DWORD dwEventMask, PVOID pvArg);
 
 typedef struct InfraFunctionPtrLst_t
 {
@@ -233,6 +235,7 @@ typedef struct InfraFunctionPtrLst_t
 	pfunc_FT_Read p_FT_Read;
 	pfunc_FT_Write p_FT_Write;
 	pfunc_FT_GetDeviceInfo p_FT_GetDeviceInfo;
+	pfunc_FT_SetEventNotification p_FT_SetEventNotification;
 } InfraFunctionPtrLst;
 
 /******************************************************************************/
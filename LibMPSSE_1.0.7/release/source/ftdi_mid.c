@@ -24,6 +24,8 @@
  * 0.2 -  20110524 - updated for SPI and cleaned up
  * 0.21- 20110708 - Added functions FT_ReadGPIO & FT_WriteGPIO
  * 0.3 -  20111103 - Added MPSSE_CMD_ENABLE_DRIVE_ONLY_ZERO
+ * 0.4 -  20261018 - Added function FT_ReadGPIOLow
+ *			Added functions Mid_GetQueueStatus & Mid_SetEventNotification
  */
 
 
@@ -620,6 +622,49 @@ FT_STATUS Mid_ResetDevice(FT_HANDLE handle)
 
 }
 
+/*!
+ * \brief Gets the number of bytes in the receive queue
+ *
+ * This function returns at once with the number of bytes that can be read
+ * without blocking.
+ * \param[in] handle Handle of the channel
+ * \param[out] *noOfBytes Number of bytes in the receive queue
+ * \return status
+ * \sa Mid_SetEventNotification
+ * \note
+ * \warning
+ */
+FT_STATUS Mid_GetQueueStatus(FT_HANDLE handle, LPDWORD noOfBytes)
+{
+	FT_STATUS status;
+	FN_ENTER;
+	status = varFunctionPtrLst.p_FT_GetQueueStatus(handle, noOfBytes);
+	FN_EXIT;
+	return status;
+}
+
+/*!
+ * \brief Sets the event signalled by the device
+ *
+ * This function sets the events (e.g. FT_EVENT_RXCHAR) that signal the event
+ * object, so a thread can wait for data instead of blocking in a read.
+ * \param[in] handle Handle of the channel
+ * \param[in] eventMask Events that signal the event object, or 0 for none
+ * \param[in] event A HANDLE from CreateEvent on Windows, else an EVENT_HANDLE*
+ * \return status
+ * \sa Mid_GetQueueStatus
+ * \note One event object may be set on many channels
+ * \warning
+ */
+FT_STATUS Mid_SetEventNotification(FT_HANDLE handle, DWORD eventMask, PVOID event)
+{
+	FT_STATUS status;
+	FN_ENTER;
+	status = varFunctionPtrLst.p_FT_SetEventNotification(handle, eventMask, event);
+	FN_EXIT;
+	return status;
+}
+
 /*!
  * \brief Purge the device
  *
@@ -1254,3 +1299,42 @@ FTDIMPSSE_API FT_STATUS FT_ReadGPIO(FT_HANDLE handle, uint8 *value)
 	return status;
 }
 
+/*!
+ * \brief Reads from the 8 GPIO lines of the low byte
+ *
+ * This function reads the lines associated with the low byte of the MPSSE channel,
+ * including the ones used by the protocol
+ *
+ * \param[in] handle Handle of the channel
+ * \param[out] *value Input state of the 8 lines(1 = high)
+ * \return status
+ * \sa
+ * \note
+ * \warning
+ */
+FTDIMPSSE_API FT_STATUS FT_ReadGPIOLow(FT_HANDLE handle, uint8 *value)
+{
+	FT_STATUS status;
+	uint8 buffer[2];
+	DWORD bytesTransfered = 0;
+	DWORD bytesToTransfer = 0;
+	UCHAR readBuffer[10];
+
+	FN_ENTER;
+
+	buffer[bytesToTransfer++] = MPSSE_CMD_GET_DATA_BITS_LOWBYTE;
+	buffer[bytesToTransfer++] = MPSSE_CMD_SEND_IMMEDIATE;
+	status = varFunctionPtrLst.p_FT_Write(handle, buffer, bytesToTransfer, &bytesTransfered);
+	CHECK_STATUS(status);
+	bytesToTransfer = 1;
+	bytesTransfered = 0;
+	status = varFunctionPtrLst.p_FT_Read(handle, readBuffer, bytesToTransfer, &bytesTransfered);
+	CHECK_STATUS(status);
+	if (bytesToTransfer != bytesTransfered)
+		status = FT_IO_ERROR;
+	*value = readBuffer[0];
+
+	FN_EXIT;
+	return status;
+}
+
@@ -24,6 +24,7 @@
  * 0.2 - 20110708	Added functions FT_ReadGPIO & FT_WriteGPIO
  * 0.3 - 20111102	Added function Mid_GetFtDeviceType
  *				Modified function Mid_SetClock
+ * 0.4 - 20261018	Added functions Mid_GetQueueStatus & Mid_SetEventNotification
  */
 
 #ifndef FTDI_MID_H
@@ -121,6 +122,9 @@ extern FT_STATUS Mid_SetClock(FT_HANDLE handle, FT_DEVICE ftDevice, uint32 clock
 extern FT_STATUS Mid_GetFtDeviceType(FT_HANDLE handle, FT_DEVICE *ftDevice);
 extern FT_STATUS Mid_SetDeviceLoopbackState(FT_HANDLE handle, uint8 loopBackFlag);
 extern FT_STATUS Mid_EmptyDeviceInputBuff(FT_HANDLE handle);
+extern FT_STATUS Mid_GetQueueStatus(FT_HANDLE handle, LPDWORD noOfBytes);
+extern FT_STATUS Mid_SetEventNotification(FT_HANDLE handle, DWORD eventMask,
+			PVOID event);
 
 #ifdef __cplusplus
 }
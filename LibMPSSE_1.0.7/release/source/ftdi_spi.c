@@ -25,6 +25,8 @@
  * 0.3 - 20111103 - bugfix: sizeTransferred 0 when SPI_TRANSFER_OPTIONS_SIZE_IN_BYTE
  *				  ENABLE_MULTI_BYTE_TRANSFER - transfer multiple bytes per USB frame
  *				  added function SPI_ReadWrite
+ * 0.4 - 20261018 - added function SPI_WriteGPIOLow
+ *				  added functions SPI_GetPinState & SPI_SetPinState
  */
 
 /******************************************************************************/
@@ -57,6 +59,9 @@ SPI_TRANSFER_OPTIONS_SIZE_IN_BYTES bit is set in the transferOptions parameter w
 calling SPI_Read or SPI_Write */
 #define ENABLE_MULTI_BYTE_TRANSFER	1
 
+/* Low byte lines that may be used as GPIO, unless one of them is the chip select */
+#define SPI_GPIO_LOW_MASK			0xF8
+
 
 /******************************************************************************/
 /*								Local function declarations					  */
@@ -1005,6 +1010,78 @@ FT_STATUS SPI_ToggleCS(FT_HANDLE handle, BOOL state)
 	return status;
 }
 
+FTDIMPSSE_API FT_STATUS SPI_WriteGPIOLow(FT_HANDLE handle, UCHAR dir, UCHAR value,
+	BOOL deferred)
+{
+	ChannelConfig *config = NULL;
+	FT_STATUS status = FT_OTHER_ERROR;
+	uint8 buffer[5];
+	uint32 i = 0;
+	DWORD noOfBytesTransferred;
+	uint8 mask;
+
+	FN_ENTER;
+#ifdef ENABLE_PARAMETER_CHECKING
+	CHECK_NULL_RET(handle);
+#endif
+	status = SPI_GetChannelConfig(handle, &config);
+	CHECK_STATUS(status);
+
+	/* The CS line stays owned by SPI_ToggleCS */
+	mask = SPI_GPIO_LOW_MASK & \
+		~((1<<((config->configOptions & SPI_CONFIG_OPTION_CS_MASK)>>2))<<3);
+	config->currentPinState &= ~(((uint16)mask<<8) | mask);
+	config->currentPinState |= ((uint16)(value & mask)<<8) | (dir & mask);
+	DBG(MSG_DEBUG,"config->currentPinState = 0x%x\n",
+		(unsigned)config->currentPinState);
+
+	if (!deferred)
+	{
+		buffer[i++] = MPSSE_CMD_SET_DATA_BITS_LOWBYTE;
+		buffer[i++] = (uint8)((config->currentPinState & 0xFF00)>>8);/*Val*/
+		buffer[i++] = (uint8)(config->currentPinState & 0x00FF); /*Dir*/
+		status = FT_Channel_Write(SPI, handle, i, buffer, &noOfBytesTransferred);
+		CHECK_STATUS(status);
+	}
+	FN_EXIT;
+	return status;
+}
+
+FTDIMPSSE_API FT_STATUS SPI_GetPinState(FT_HANDLE handle, USHORT *state)
+{
+	ChannelConfig *config = NULL;
+	FT_STATUS status = FT_OTHER_ERROR;
+
+	FN_ENTER;
+#ifdef ENABLE_PARAMETER_CHECKING
+	CHECK_NULL_RET(handle);
+	CHECK_NULL_RET(state);
+#endif
+	status = SPI_GetChannelConfig(handle, &config);
+	CHECK_STATUS(status);
+	*state = config->currentPinState;
+	FN_EXIT;
+	return status;
+}
+
+FTDIMPSSE_API FT_STATUS SPI_SetPinState(FT_HANDLE handle, USHORT state)
+{
+	ChannelConfig *config = NULL;
+	FT_STATUS status = FT_OTHER_ERROR;
+
+	FN_ENTER;
+#ifdef ENABLE_PARAMETER_CHECKING
+	CHECK_NULL_RET(handle);
+#endif
+	status = SPI_GetChannelConfig(handle, &config);
+	CHECK_STATUS(status);
+	config->currentPinState = state;
+	DBG(MSG_DEBUG,"config->currentPinState = 0x%x\n",
+		(unsigned)config->currentPinState);
+	FN_EXIT;
+	return status;
+}
+
 /******************************************************************************/
 /*						Local function definitions						  */
 /******************************************************************************/
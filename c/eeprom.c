@@ -0,0 +1,338 @@
+// 24Cxx-class I2C EEPROMs on an <i2c/channel>: page writes with ACK polling, sequential reads
+
+#include "i2c.h"
+
+#define EEPROM_READ_CHUNK       4096    // bytes per sequential read transfer
+#define EEPROM_PROBES_MIN       4       // address probes sent after each page write
+#define EEPROM_PROBES_MAX       256
+#define EEPROM_PROBES_DEFAULT   32
+#define EEPROM_PAGE_MAX         256
+
+typedef struct {
+    uint32_t        count;          // transfers
+    uint64_t        bytes;
+    int64_t         time;           // ns, in total
+    int64_t         max;            // ns, of the longest transfer
+} eeprom_stats_t;
+
+typedef struct {
+    Janet           channel;        // <i2c/channel> the EEPROM is on
+    uint32_t        address;        // 7-bit device address, memory address bits above addr_bytes are OR'd in
+    uint32_t        size;           // bytes
+    uint32_t        page_size;
+    uint32_t        addr_bytes;     // memory address bytes sent after the device address, 1 or 2
+    uint32_t        probes;         // probes sent with each page write, adapted to the write cycle
+    eeprom_stats_t  read;
+    eeprom_stats_t  write;          // a page write, including its write cycle
+    uint64_t        probes_sent;
+    uint32_t        polls;          // extra transfers to wait out a write cycle
+} eeprom_t;
+
+static int  eeprom_get(void *p, Janet key, Janet *out);
+static int  eeprom_gcmark(void *p, size_t s);
+static void eeprom_string(void *p, JanetBuffer *buffer);
+
+static const JanetAbstractType eeprom_type = {
+    "eeprom/chip",
+    NULL,                   // gc
+    eeprom_gcmark,          // gcmark
+    eeprom_get,             // get
+    NULL,                   // put
+    NULL,                   // marshal
+    NULL,                   // unmarshal
+    eeprom_string,          // to-string
+    JANET_ATEND_TOSTRING
+};
+
+static channel_t *eeprom_channel(eeprom_t *e) {
+    return (channel_t *)janet_unwrap_abstract(e->channel);
+}
+
+// Report the status as set by the err-mode of the EEPROM's channel
+static Janet eeprom_status(eeprom_t *e, FT_STATUS status, Janet value) {
+    return ft_status(eeprom_channel(e)->err_mode, status, value);
+}
+
+static void eeprom_stats_add(eeprom_stats_t *s, uint32_t bytes, int64_t start) {
+    int64_t ns = ft_monotonic_ns() - start;
+    s->count++;
+    s->bytes += bytes;
+    s->time += ns;
+    if (ns > s->max)
+        s->max = ns;
+}
+
+// Device address of the block 'addr' is in, and its memory address, MSB first. Returns the bytes used.
+static uint32_t eeprom_address(eeprom_t *e, uint32_t addr, uint8_t *device, uint8_t *out) {
+    *device = (uint8_t)(e->address | (addr >> (8 * e->addr_bytes)));
+    if (e->addr_bytes == 2) {
+        out[0] = (uint8_t)(addr >> 8);
+        out[1] = (uint8_t)addr;
+        return 2;
+    }
+    out[0] = (uint8_t)addr;
+    return 1;
+}
+
+// Check a range is on the EEPROM
+static uint32_t eeprom_range(eeprom_t *e, const Janet *argv, int32_t n, uint32_t size) {
+    uint32_t addr = janet_getuinteger(argv, n);
+    if ((uint64_t)addr + size > e->size)
+        janet_panicf("range 0x%X + %d is past the end of the eeprom, %d bytes", addr, size, e->size);
+    return addr;
+}
+
+JANET_FN(cfun_eeprom_open,
+    "(eeprom/open channel address size page &opt addr-bytes)",
+    "An EEPROM of `size` bytes, written in pages of `page` bytes, at 7-bit device `address` on an "
+    "initialized `channel`. Memory addresses are sent as `addr-bytes` bytes, by default 1 up to "
+    "2KB (24C01-24C16) and 2 above. Address bits above them go in the low bits of the device address.\n\n"
+    "Returns an `<eeprom/chip>`, or `nil` on error. Sets `:err` to return status, "
+    "`:device-not-found` if it doesn't ACK its address.") {
+    janet_arity(argc, 4, 5);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
+    uint32_t address = janet_getuinteger(argv, 1);
+    if (address > 127)
+        janet_panicf("i2c address %d is out of range. Expected 7-bit address <= 127.", address);
+    uint32_t size = janet_getuinteger(argv, 2);
+    uint32_t page = janet_getuinteger(argv, 3);
+    if (page < 1 || page > EEPROM_PAGE_MAX || (page & (page - 1)))
+        janet_panicf("page size %d is invalid. Expected a power of 2 up to %d", page, EEPROM_PAGE_MAX);
+    uint32_t addr_bytes = (uint32_t)janet_optnat(argv, argc, 4, size > 2048 ? 2 : 1);
+    if (addr_bytes < 1 || addr_bytes > 2)
+        janet_panicf("expected 1 or 2 address bytes, got %d", addr_bytes);
+    if (size < 1 || (size - 1) >> (8 * addr_bytes) > 7 || (address & ((size - 1) >> (8 * addr_bytes))))
+        janet_panicf("size %d doesn't fit device address 0x%X with %d address bytes", size, address, addr_bytes);
+
+    if (NULL == c->handle)
+        return ft_status(c->err_mode, FT_DEVICE_NOT_OPENED, janet_wrap_nil());
+
+    DWORD acked = 0;
+    uint32_t ms = i2c_channel_deadline(c, 0);
+    uint32_t tries = c->retries;
+    FT_STATUS status;
+    do {
+        int64_t attempt = ft_monotonic_ns();
+        i2c_channel_prepare(c);
+        status = I2C_DeviceWritePoll(c->handle, (UCHAR)address, 0, NULL, 1, &acked);
+        status = ft_deadline_status(status, attempt, ms);
+    } while (i2c_channel_recover(c, status, &tries));
+    if (status == FT_OK && 0 == acked)
+        status = FT_DEVICE_NOT_FOUND;
+    if (status != FT_OK)
+        return ft_status(c->err_mode, status, janet_wrap_nil());
+
+    eeprom_t *e = (eeprom_t *)janet_abstract(&eeprom_type, sizeof(eeprom_t));
+    memset(e, 0, sizeof(eeprom_t));
+    e->channel = argv[0];
+    e->address = address;
+    e->size = size;
+    e->page_size = page;
+    e->addr_bytes = addr_bytes;
+    e->probes = EEPROM_PROBES_DEFAULT;
+    return ft_status(c->err_mode, status, janet_wrap_abstract(e));
+}
+
+JANET_FN(cfun_eeprom_read,
+    "(eeprom/read chip addr size buffer &opt timeout)",
+    "Read & append `size` n-bytes from `chip` at `addr` to `buffer`, as sequential reads of up to 4KB, "
+    "each one `i2c/write-read` of the memory address. Takes a `timeout` in ms as `i2c/read`.\n\n"
+    "Returns bytes read. Sets `:err` to return status.\n\n"
+    "This is a **blocking function**.") {
+    janet_arity(argc, 4, 5);
+
+    eeprom_t *e = (eeprom_t *)janet_getabstract(argv, 0, &eeprom_type);
+    uint32_t size = janet_getuinteger(argv, 2);
+    uint32_t addr = eeprom_range(e, argv, 1, size);
+    JanetBuffer *buffer = janet_getbuffer(argv, 3);
+    janet_buffer_extra(buffer, size);
+
+    channel_t *c = eeprom_channel(e);
+    if (NULL == c->handle)
+        return eeprom_status(e, FT_DEVICE_NOT_OPENED, janet_wrap_integer(0));
+
+    uint32_t ms = i2c_channel_deadline(c, (uint32_t)janet_optnat(argv, argc, 4, 0));
+    uint32_t block = 1U << (8 * e->addr_bytes);
+    uint32_t done = 0;
+    FT_STATUS status = FT_OK;
+    while (status == FT_OK && done < size) {
+        // a sequential read wraps at the end of the block of a device address
+        uint32_t chunk = block - ((addr + done) % block);
+        if (chunk > EEPROM_READ_CHUNK)
+            chunk = EEPROM_READ_CHUNK;
+        if (chunk > size - done)
+            chunk = size - done;
+
+        uint8_t device = 0;
+        uint8_t out[2];
+        uint32_t outsz = eeprom_address(e, addr + done, &device, out);
+        uint32_t readsz = 0;
+        uint32_t tries = c->retries;
+        int64_t start = ft_monotonic_ns();
+        do {
+            int64_t attempt = ft_monotonic_ns();
+            i2c_channel_prepare(c);
+            status = I2C_DeviceWriteRead(c->handle, device, outsz, out, chunk,
+                                         buffer->data + buffer->count + done, &readsz);
+            status = ft_deadline_status(status, attempt, ms);
+        } while (i2c_channel_recover(c, status, &tries));
+        if (status == FT_OK) {
+            done += chunk;
+            eeprom_stats_add(&e->read, chunk, start);
+        }
+    }
+    buffer->count += done;
+    return eeprom_status(e, status, janet_wrap_integer(done));
+}
+
+/* Write one page, and poll for the end of its write cycle: the probes go out with the
+    page, and once more per transfer until the EEPROM ACKs one or 'ms' passes. The probes
+    sent with the next page are set from how many it took. */
+static FT_STATUS eeprom_write_page(eeprom_t *e, channel_t *c, uint32_t addr, const uint8_t *data,
+                                   uint32_t size, uint32_t ms) {
+    uint8_t frame[2 + EEPROM_PAGE_MAX];
+    uint8_t device = 0;
+    uint32_t n = eeprom_address(e, addr, &device, frame);
+    memcpy(frame + n, data, size);
+
+    // not retried, as the EEPROM may have taken the page already
+    int64_t start = ft_monotonic_ns();
+    uint32_t tries = 0;
+    DWORD acked = 0;
+    uint32_t probes = 0;
+    i2c_channel_prepare(c);
+    FT_STATUS status = I2C_DeviceWritePoll(c->handle, device, n + size, frame, e->probes, &acked);
+    status = ft_deadline_status(status, start, ms);
+    e->probes_sent += e->probes;
+    i2c_channel_recover(c, status, &tries);
+    while (status == FT_OK && 0 == acked) {
+        probes += e->probes;
+        if (ft_monotonic_ns() - start >= (int64_t)ms * 1000000) {
+            status = FT_TIMEOUT;
+            break;
+        }
+        e->polls++;
+        e->probes_sent += e->probes;
+        i2c_channel_prepare(c);
+        int64_t attempt = ft_monotonic_ns();
+        status = I2C_DeviceWritePoll(c->handle, device, 0, NULL, e->probes, &acked);
+        status = ft_deadline_status(status, attempt, ms);
+        i2c_channel_recover(c, status, &tries);
+    }
+    if (status != FT_OK)
+        return status;
+
+    probes += acked;
+    probes += probes / 4 + 1;
+    e->probes = probes < EEPROM_PROBES_MIN ? EEPROM_PROBES_MIN : (probes > EEPROM_PROBES_MAX ? EEPROM_PROBES_MAX : probes);
+    eeprom_stats_add(&e->write, size, start);
+    return status;
+}
+
+JANET_FN(cfun_eeprom_write,
+    "(eeprom/write chip addr data &opt timeout)",
+    "Write `data` to `chip` at `addr`, split at page boundaries. Each page is one transfer, "
+    "followed in the same USB write by address probes that wait out its write cycle, so a page "
+    "usually takes one USB round trip. The count of probes adapts to the write cycle, see "
+    "`eeprom/stats`. Each page must be done within `timeout` ms if given, otherwise the "
+    "channel's `i2c/timeout`.\n\n"
+    "Returns bytes written. Sets `:err` to return status.\n\n"
+    "This is a **blocking function**.") {
+    janet_arity(argc, 3, 4);
+
+    eeprom_t *e = (eeprom_t *)janet_getabstract(argv, 0, &eeprom_type);
+    JanetByteView data = janet_getbytes(argv, 2);
+    uint32_t addr = eeprom_range(e, argv, 1, (uint32_t)data.len);
+
+    channel_t *c = eeprom_channel(e);
+    if (NULL == c->handle)
+        return eeprom_status(e, FT_DEVICE_NOT_OPENED, janet_wrap_integer(0));
+
+    uint32_t ms = i2c_channel_deadline(c, (uint32_t)janet_optnat(argv, argc, 3, 0));
+    uint32_t done = 0;
+    FT_STATUS status = FT_OK;
+    while (status == FT_OK && done < (uint32_t)data.len) {
+        uint32_t page = e->page_size - ((addr + done) % e->page_size);
+        if (page > (uint32_t)data.len - done)
+            page = (uint32_t)data.len - done;
+        status = eeprom_write_page(e, c, addr + done, data.bytes + done, page, ms);
+        if (status == FT_OK)
+            done += page;
+    }
+    return eeprom_status(e, status, janet_wrap_integer(done));
+}
+
+static Janet eeprom_stats_struct(eeprom_stats_t *s) {
+    JanetKV *st = janet_struct_begin(5);
+    janet_struct_put(st, janet_ckeywordv("count"), janet_wrap_number(s->count));
+    janet_struct_put(st, janet_ckeywordv("bytes"), janet_wrap_number((double)s->bytes));
+    janet_struct_put(st, janet_ckeywordv("time"), janet_wrap_number((double)s->time / 1e9));
+    janet_struct_put(st, janet_ckeywordv("max"), janet_wrap_number((double)s->max / 1e9));
+    janet_struct_put(st, janet_ckeywordv("mean"), janet_wrap_number(s->count ? (double)s->time / s->count / 1e9 : 0.0));
+    return janet_wrap_struct(janet_struct_end(st));
+}
+
+JANET_FN(cfun_eeprom_stats,
+    "(eeprom/stats chip &opt reset)",
+    "Timing of the transfers on `chip`: a struct of `:read`, the sequential reads, and `:write`, "
+    "the page writes including their write cycle, each with their `:count`, `:bytes`, and `:time`, "
+    "`:max` and `:mean` in seconds. Also `:probes`, the address probes now sent with each page, "
+    "`:probes-sent` in total, and `:polls`, the extra transfers to wait out a write cycle. "
+    "Clears them if `reset` is true.") {
+    janet_arity(argc, 1, 2);
+
+    eeprom_t *e = (eeprom_t *)janet_getabstract(argv, 0, &eeprom_type);
+    JanetKV *st = janet_struct_begin(5);
+    janet_struct_put(st, janet_ckeywordv("read"), eeprom_stats_struct(&e->read));
+    janet_struct_put(st, janet_ckeywordv("write"), eeprom_stats_struct(&e->write));
+    janet_struct_put(st, janet_ckeywordv("probes"), janet_wrap_number(e->probes));
+    janet_struct_put(st, janet_ckeywordv("probes-sent"), janet_wrap_number((double)e->probes_sent));
+    janet_struct_put(st, janet_ckeywordv("polls"), janet_wrap_number(e->polls));
+    Janet stats = janet_wrap_struct(janet_struct_end(st));
+
+    if (janet_optboolean(argv, argc, 1, FALSE)) {
+        memset(&e->read, 0, sizeof(eeprom_stats_t));
+        memset(&e->write, 0, sizeof(eeprom_stats_t));
+        e->probes_sent = 0;
+        e->polls = 0;
+    }
+    return stats;
+}
+
+static JanetMethod eeprom_methods[] = {
+    {"read",            cfun_eeprom_read},
+    {"write",           cfun_eeprom_write},
+    {"stats",           cfun_eeprom_stats},
+    {NULL,              NULL}
+};
+
+static int eeprom_get(void *p, Janet key, Janet *out) {
+    (void) p;
+    if (!janet_checktype(key, JANET_KEYWORD))
+        janet_panicf("expected keyword, but got %t", key);
+    return janet_getmethod(janet_unwrap_keyword(key), eeprom_methods, out);
+}
+
+static int eeprom_gcmark(void *p, size_t s) {
+    (void) s;
+    eeprom_t *e = (eeprom_t *)p;
+    janet_mark(e->channel);
+    return 0;
+}
+
+static void eeprom_string(void *p, JanetBuffer *buffer) {
+    eeprom_t *e = (eeprom_t *)p;
+    janet_formatb(buffer, "0x%02X %dB", e->address, e->size);
+}
+
+void eeprom_register(JanetTable *env) {
+    JanetRegExt cfuns[] = {
+        JANET_REG("eeprom/open",        cfun_eeprom_open),
+        JANET_REG("eeprom/read",        cfun_eeprom_read),
+        JANET_REG("eeprom/write",       cfun_eeprom_write),
+        JANET_REG("eeprom/stats",       cfun_eeprom_stats),
+        JANET_REG_END
+    };
+    janet_cfuns_ext(env, "eeprom", cfuns);
+}
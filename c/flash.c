@@ -0,0 +1,520 @@
+// SPI NOR flash on an <spi/device>, with JEDEC ID and SFDP (JESD216) discovery
+
+#include "spi.h"
+
+#define FLASH_WREN              0x06
+#define FLASH_RDSR              0x05
+#define FLASH_RDID              0x9F    // JEDEC ID
+#define FLASH_RDSFDP            0x5A
+#define FLASH_FAST_READ         0x0B
+#define FLASH_FAST_READ4        0x0C    // with a 4 byte address
+#define FLASH_PP                0x02
+#define FLASH_PP4               0x12
+
+#define FLASH_SR_WIP            0x01    // status register: write in progress
+#define FLASH_SR_WEL            0x02    // write enable latch
+
+#define FLASH_SFDP_SIGNATURE    0x50444653  // "SFDP"
+#define FLASH_SFDP_DWORDS       16      // of the basic parameter table, as far as it's used
+#define FLASH_ERASE_TYPES       4
+
+#define FLASH_READ_CHUNK        65536   // bytes per fast read frame, as SPI_Read
+#define FLASH_PIPELINE_PAGES    16      // pages queued in one USB write by flash/program
+#define FLASH_TPP_DEFAULT       700     // us, typical page program time without SFDP
+#define FLASH_ERASE_TIMEOUT     10000   // ms, default deadline of each erase
+
+typedef struct {
+    Janet           device;         // <spi/device> the flash is on
+    uint8_t         jedec[3];       // manufacturer, memory type, capacity
+    BOOL            sfdp;           // parameters were read from SFDP, otherwise defaults
+    uint64_t        size;           // bytes
+    uint32_t        page_size;
+    uint32_t        addr_bytes;     // 3, or 4 above 16MB
+    uint32_t        erase_size[FLASH_ERASE_TYPES];  // largest first, 0 if unused
+    uint8_t         erase_op[FLASH_ERASE_TYPES];
+    uint32_t        tpp;            // us, typical page program time
+    uint32_t        delay;          // us, idle clocks before polling a programmed page
+    uint32_t        busy;           // pages found still programming after the delay
+} flash_t;
+
+static int  flash_get(void *p, Janet key, Janet *out);
+static int  flash_gcmark(void *p, size_t s);
+static void flash_string(void *p, JanetBuffer *buffer);
+
+static const JanetAbstractType flash_type = {
+    "flash/chip",
+    NULL,                   // gc
+    flash_gcmark,           // gcmark
+    flash_get,              // get
+    NULL,                   // put
+    NULL,                   // marshal
+    NULL,                   // unmarshal
+    flash_string,           // to-string
+    JANET_ATEND_TOSTRING
+};
+
+static device_t *flash_device(flash_t *f) {
+    return (device_t *)janet_unwrap_abstract(f->device);
+}
+
+// Report the status as set by the err-mode of the flash's channel
+static Janet flash_status(flash_t *f, FT_STATUS status, Janet value) {
+    return ft_status(spi_device_channel(flash_device(f))->err_mode, status, value);
+}
+
+// Command byte and address, MSB first. Returns the bytes used.
+static uint32_t flash_command(flash_t *f, uint8_t *out, uint8_t op, uint32_t addr) {
+    out[0] = op;
+    if (f->addr_bytes == 4) {
+        out[1] = (uint8_t)(addr >> 24);
+        out[2] = (uint8_t)(addr >> 16);
+        out[3] = (uint8_t)(addr >> 8);
+        out[4] = (uint8_t)addr;
+        return 5;
+    }
+    out[1] = (uint8_t)(addr >> 16);
+    out[2] = (uint8_t)(addr >> 8);
+    out[3] = (uint8_t)addr;
+    return 4;
+}
+
+// Queue the one byte write enable, which each program or erase needs
+static USHORT flash_queue_wren(device_t *d, channel_t *c, USHORT state) {
+    uint8_t wren = FLASH_WREN;
+    return spi_device_command(d, c, state, &wren, 1, 0);
+}
+
+// Run one frame of 'outsz' bytes out, then 'insz' in, in its own USB write
+static FT_STATUS flash_frame(device_t *d, const uint8_t *out, uint32_t outsz, uint8_t *in, uint32_t insz) {
+    USHORT state = 0;
+    FT_STATUS status = spi_device_begin(d, &state);
+    if (status != FT_OK)
+        return status;
+    state = spi_device_command(d, spi_device_channel(d), state, out, outsz, insz);
+    return spi_device_send(d, state, in, 0);
+}
+
+static uint32_t le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Read 'size' bytes of the SFDP space at 'addr' (always a 3 byte address, and a dummy byte)
+static FT_STATUS flash_sfdp_read(device_t *d, uint32_t addr, uint8_t *in, uint32_t size) {
+    uint8_t out[5] = {FLASH_RDSFDP, (uint8_t)(addr >> 16), (uint8_t)(addr >> 8), (uint8_t)addr, 0};
+    return flash_frame(d, out, 5, in, size);
+}
+
+/* Fill in the geometry from the SFDP basic parameter table, if the flash has one.
+    Returns FALSE, leaving the defaults, if it doesn't. */
+static BOOL flash_sfdp(flash_t *f, device_t *d) {
+    uint8_t header[16];
+    if (flash_sfdp_read(d, 0, header, sizeof(header)) != FT_OK || le32(header) != FLASH_SFDP_SIGNATURE)
+        return FALSE;
+
+    // the first parameter header is the basic table (ID 0xFF00): length in DWORDs, then its address
+    uint8_t *param = header + 8;
+    if (param[0] != 0x00 || param[7] != 0xFF || param[3] < 9)
+        return FALSE;
+    uint32_t dwords = param[3] < FLASH_SFDP_DWORDS ? param[3] : FLASH_SFDP_DWORDS;
+    uint32_t table = param[4] | (param[5] << 8) | (param[6] << 16);
+    uint8_t buf[4 * FLASH_SFDP_DWORDS];
+    if (flash_sfdp_read(d, table, buf, 4 * dwords) != FT_OK)
+        return FALSE;
+    uint32_t dw[FLASH_SFDP_DWORDS] = {0};
+    for (uint32_t i = 0; i < dwords; i++)
+        dw[i] = le32(buf + 4 * i);
+
+    // DWORD2: density in bits, N + 1, or 2^N if bit 31 is set; 0 (not supported) for an N
+    // that isn't a whole number of bytes, or is too large, as in corrupt or blank tables
+    uint32_t density = dw[1] & 0x7FFFFFFF;
+    if (dw[1] & 0x80000000)
+        f->size = (density >= 3 && density < 64 + 3) ? (1ULL << (density - 3)) : 0;
+    else
+        f->size = ((uint64_t)dw[1] + 1) / 8;
+
+    // DWORD1 bits 18:17: 3 byte addresses only, 3 or 4, 4 only
+    uint32_t addr_mode = (dw[0] >> 17) & 0x03;
+    f->addr_bytes = (addr_mode == 2 || (addr_mode == 1 && f->size > (1 << 24))) ? 4 : 3;
+
+    // DWORD8-9: up to 4 erase types, size as 2^N and opcode, kept largest first
+    memset(f->erase_size, 0, sizeof(f->erase_size));
+    for (int i = 0; i < FLASH_ERASE_TYPES; i++) {
+        uint32_t n = (dw[7 + i / 2] >> (16 * (i % 2))) & 0xFF;
+        uint8_t op = (uint8_t)((dw[7 + i / 2] >> (16 * (i % 2) + 8)) & 0xFF);
+        if (n == 0 || n > 31)
+            continue;
+        int j = FLASH_ERASE_TYPES - 1;
+        while (j > 0 && (f->erase_size[j - 1] == 0 || f->erase_size[j - 1] < (1U << n))) {
+            f->erase_size[j] = f->erase_size[j - 1];
+            f->erase_op[j] = f->erase_op[j - 1];
+            j--;
+        }
+        f->erase_size[j] = 1U << n;
+        f->erase_op[j] = op;
+    }
+
+    // DWORD11 (JESD216A): page size 2^N, typical page program time in 8 or 64us units
+    if (dwords >= 11) {
+        f->page_size = 1U << ((dw[10] >> 4) & 0x0F);
+        f->tpp = (((dw[10] >> 8) & 0x1F) + 1) * ((dw[10] & (1 << 13)) ? 64 : 8);
+    }
+    return TRUE;
+}
+
+// 4 byte address erase opcodes for the common erase sizes, 0 if there is none
+static uint8_t flash_erase_op4(uint32_t size) {
+    switch (size) {
+    case 4096:  return 0x21;
+    case 32768: return 0x5C;
+    case 65536: return 0xDC;
+    default:    return 0;
+    }
+}
+
+JANET_FN(cfun_flash_open,
+    "(flash/open device)",
+    "Identify the SPI NOR flash on `device`, an `<spi/device>`, by its JEDEC ID, and read its size, "
+    "page size, erase types and page program time from its SFDP table. Flash without SFDP "
+    "is taken to have the size in the JEDEC ID capacity byte, 256 byte pages, and 4KB, 32KB and 64KB "
+    "erases. Flash over 16MB is addressed with 4 byte addresses and their opcodes.\n\n"
+    "Flash whose size can't be read, or with no erase type it can be addressed with, is `:not-supported`.\n\n"
+    "Returns a `<flash/chip>`, or `nil` on error. Sets `:err` to return status.") {
+    janet_fixarity(argc, 1);
+
+    device_t *d = (device_t *)janet_getabstract(argv, 0, &spi_device_type);
+    channel_t *c = spi_device_channel(d);
+
+    uint8_t rdid = FLASH_RDID;
+    uint8_t jedec[3] = {0};
+    FT_STATUS status = flash_frame(d, &rdid, 1, jedec, 3);
+    if (status != FT_OK)
+        return ft_status(c->err_mode, status, janet_wrap_nil());
+    if ((jedec[0] == 0x00 && jedec[1] == 0x00) || (jedec[0] == 0xFF && jedec[1] == 0xFF))
+        return ft_status(c->err_mode, FT_DEVICE_NOT_FOUND, janet_wrap_nil());
+
+    flash_t *f = (flash_t *)janet_abstract(&flash_type, sizeof(flash_t));
+    f->device = argv[0];
+    memcpy(f->jedec, jedec, 3);
+    f->size = (jedec[2] >= 10 && jedec[2] < 32) ? (1ULL << jedec[2]) : 0;
+    f->page_size = 256;
+    f->addr_bytes = 3;
+    uint32_t sizes[FLASH_ERASE_TYPES] = {65536, 32768, 4096, 0};
+    uint8_t ops[FLASH_ERASE_TYPES] = {0xD8, 0x52, 0x20, 0};
+    memcpy(f->erase_size, sizes, sizeof(sizes));
+    memcpy(f->erase_op, ops, sizeof(ops));
+    f->tpp = FLASH_TPP_DEFAULT;
+    f->sfdp = flash_sfdp(f, d);
+    if (0 == f->size)
+        return ft_status(c->err_mode, FT_NOT_SUPPORTED, janet_wrap_nil());
+    if (f->size > (1 << 24))
+        f->addr_bytes = 4;
+
+    // in 4 byte mode, only the erase sizes with a 4 byte address opcode are kept
+    int erase_count = 0;
+    for (int i = 0; i < FLASH_ERASE_TYPES; i++) {
+        if (f->addr_bytes == 4) {
+            f->erase_op[i] = flash_erase_op4(f->erase_size[i]);
+            if (0 == f->erase_op[i])
+                f->erase_size[i] = 0;
+        }
+        if (f->erase_size[i] > 0)
+            erase_count++;
+    }
+    if (0 == erase_count)
+        return ft_status(c->err_mode, FT_NOT_SUPPORTED, janet_wrap_nil());
+    f->delay = f->tpp;
+    f->busy = 0;
+    return ft_status(c->err_mode, FT_OK, janet_wrap_abstract(f));
+}
+
+JANET_FN(cfun_flash_info,
+    "(flash/info chip)",
+    "The geometry of `chip`: a struct of `:jedec` ID bytes, `:sfdp` whether it was read from the "
+    "SFDP table, `:size` and `:page-size` in bytes, `:address-bytes`, `:erase` sizes in bytes, "
+    "`:tpp` the typical page program time in us, `:delay` the current wait in us before polling "
+    "a programmed page, and `:busy` the count of pages that were still programming after it.") {
+    janet_fixarity(argc, 1);
+
+    flash_t *f = (flash_t *)janet_getabstract(argv, 0, &flash_type);
+    Janet erase[FLASH_ERASE_TYPES];
+    int32_t erase_count = 0;
+    for (int i = 0; i < FLASH_ERASE_TYPES; i++)
+        if (f->erase_size[i] > 0)
+            erase[erase_count++] = janet_wrap_number(f->erase_size[i]);
+
+    JanetKV *st = janet_struct_begin(9);
+    janet_struct_put(st, janet_ckeywordv("jedec"), janet_wrap_string(janet_string(f->jedec, 3)));
+    janet_struct_put(st, janet_ckeywordv("sfdp"), janet_wrap_boolean(f->sfdp));
+    janet_struct_put(st, janet_ckeywordv("size"), janet_wrap_number((double)f->size));
+    janet_struct_put(st, janet_ckeywordv("page-size"), janet_wrap_number(f->page_size));
+    janet_struct_put(st, janet_ckeywordv("address-bytes"), janet_wrap_number(f->addr_bytes));
+    janet_struct_put(st, janet_ckeywordv("erase"), janet_wrap_tuple(janet_tuple_n(erase, erase_count)));
+    janet_struct_put(st, janet_ckeywordv("tpp"), janet_wrap_number(f->tpp));
+    janet_struct_put(st, janet_ckeywordv("delay"), janet_wrap_number(f->delay));
+    janet_struct_put(st, janet_ckeywordv("busy"), janet_wrap_number(f->busy));
+    return janet_wrap_struct(janet_struct_end(st));
+}
+
+// Check a range is on the flash
+static uint32_t flash_range(flash_t *f, const Janet *argv, int32_t n, uint32_t size) {
+    uint32_t addr = janet_getuinteger(argv, n);
+    if ((uint64_t)addr + size > f->size)
+        janet_panicf("range 0x%X + %d is past the end of the flash", addr, size);
+    return addr;
+}
+
+// Fast read 'size' bytes at 'addr' into 'in', one frame and one USB transfer per 64KB
+static FT_STATUS flash_read(flash_t *f, uint32_t addr, uint8_t *in, uint32_t size, uint32_t *readsz) {
+    device_t *d = flash_device(f);
+    channel_t *c = spi_device_channel(d);
+    uint8_t op = (f->addr_bytes == 4) ? FLASH_FAST_READ4 : FLASH_FAST_READ;
+    *readsz = 0;
+
+    USHORT state = 0;
+    FT_STATUS status = spi_device_begin(d, &state);
+    while (status == FT_OK && *readsz < size) {
+        uint32_t chunk = (size - *readsz) > FLASH_READ_CHUNK ? FLASH_READ_CHUNK : (size - *readsz);
+        uint8_t out[6];
+        uint32_t outsz = flash_command(f, out, op, addr + *readsz);
+        out[outsz++] = 0; // dummy byte
+        state = spi_device_command(d, c, state, out, outsz, chunk);
+        status = spi_device_send(d, state, in + *readsz, 0);
+        if (status == FT_OK)
+            *readsz += chunk;
+    }
+    return status;
+}
+
+JANET_FN(cfun_flash_read,
+    "(flash/read chip addr size buffer)",
+    "Read & append `size` n-bytes from `chip` at `addr` to `buffer`, with fast reads of 64KB each.\n\n"
+    "Returns bytes read. Sets `:err` to return status.\n\n"
+    "This is a **blocking function**.") {
+    janet_fixarity(argc, 4);
+
+    flash_t *f = (flash_t *)janet_getabstract(argv, 0, &flash_type);
+    uint32_t size = janet_getuinteger(argv, 2);
+    uint32_t addr = flash_range(f, argv, 1, size);
+    JanetBuffer *buffer = janet_getbuffer(argv, 3);
+    janet_buffer_extra(buffer, size);
+
+    uint32_t readsz = 0;
+    FT_STATUS status = flash_read(f, addr, buffer->data + buffer->count, size, &readsz);
+    buffer->count += readsz;
+    return flash_status(f, status, janet_wrap_integer(readsz));
+}
+
+JANET_FN(cfun_flash_erase,
+    "(flash/erase chip addr size &opt timeout)",
+    "Erase `size` bytes of `chip` at `addr`, both aligned to its smallest erase size, with the "
+    "largest erases that fit. Each erase waits for the flash to be ready, within `timeout` ms "
+    "(default 10000).\n\n"
+    "Returns true, or false on error. Sets `:err` to return status.\n\n"
+    "This is a **blocking function**.") {
+    janet_arity(argc, 3, 4);
+
+    flash_t *f = (flash_t *)janet_getabstract(argv, 0, &flash_type);
+    uint32_t size = janet_getuinteger(argv, 2);
+    uint32_t addr = flash_range(f, argv, 1, size);
+    uint32_t ms = (uint32_t)janet_optnat(argv, argc, 3, FLASH_ERASE_TIMEOUT);
+
+    uint32_t smallest = 0;
+    for (int i = 0; i < FLASH_ERASE_TYPES; i++)
+        if (f->erase_size[i] > 0)
+            smallest = f->erase_size[i];
+    if (0 == smallest || addr % smallest || size % smallest)
+        janet_panicf("erase range must be aligned to the %d byte erase size", smallest);
+
+    device_t *d = flash_device(f);
+    channel_t *c = spi_device_channel(d);
+    FT_STATUS status = FT_OK;
+    uint32_t end = addr + size;
+    while (status == FT_OK && addr < end) {
+        int i = 0;
+        while (f->erase_size[i] == 0 || addr % f->erase_size[i] || end - addr < f->erase_size[i])
+            i++;
+
+        // write enable and erase in one USB write, then poll until it's done
+        USHORT state = 0;
+        status = spi_device_begin(d, &state);
+        if (status != FT_OK)
+            break;
+        uint8_t out[5];
+        state = flash_queue_wren(d, c, state);
+        state = spi_device_command(d, c, state, out, flash_command(f, out, f->erase_op[i], addr), 0);
+        status = spi_device_send(d, state, NULL, 0);
+        uint8_t sr = 0;
+        if (status == FT_OK)
+            status = spi_device_poll(d, FLASH_RDSR, FLASH_SR_WIP, 0, ms, &sr);
+        addr += f->erase_size[i];
+    }
+    return flash_status(f, status, janet_wrap_boolean(status == FT_OK));
+}
+
+/* Queue a batch of pages, each as write enable, page program, a wait of the flash's
+    current delay in idle clocks, and a status read. 'frame' has room for a command and a page.
+    Returns the pin state the queued commands leave, and sets the pages queued. */
+static USHORT flash_queue_pages(flash_t *f, device_t *d, channel_t *c, USHORT state, uint8_t *frame,
+                                uint32_t addr, const uint8_t *data, uint32_t size, uint32_t *pages) {
+    uint8_t op = (f->addr_bytes == 4) ? FLASH_PP4 : FLASH_PP;
+    uint8_t rdsr = FLASH_RDSR;
+    uint32_t idle = (uint32_t)((uint64_t)f->delay * c->config.ClockRate / 8000000);
+
+    *pages = 0;
+    uint32_t offset = 0;
+    while (offset < size && *pages < FLASH_PIPELINE_PAGES) {
+        uint32_t page = f->page_size - ((addr + offset) % f->page_size);
+        if (page > size - offset)
+            page = size - offset;
+
+        uint32_t n = flash_command(f, frame, op, addr + offset);
+        memcpy(frame + n, data + offset, page);
+        state = flash_queue_wren(d, c, state);
+        state = spi_device_command(d, c, state, frame, n + page, 0);
+        mpsse_clock_idle(&c->cmd, idle);
+        state = spi_device_command(d, c, state, &rdsr, 1, 1);
+        offset += page;
+        (*pages)++;
+    }
+    return state;
+}
+
+JANET_FN(cfun_flash_program,
+    "(flash/program chip addr data &opt timeout)",
+    "Program `data` into `chip` at `addr`, which must have been erased. Pages are programmed in "
+    "batches of up to 16 per USB write, each as write enable, page program, a wait close to the "
+    "flash's page program time, and a status read. Pages after one still found programming are "
+    "sent again once it's done, waiting within `timeout` ms if given, otherwise the channel's "
+    "`spi/timeout`, and the wait grows to suit. See `flash/info`.\n\n"
+    "Returns true, or false on error. Sets `:err` to return status, `:failed-to-write-device` "
+    "if the flash did not start a page program, e.g. on a protected block.\n\n"
+    "Note: the wait uses an MPSSE command of the FT232H, FT2232H and FT4232H only.\n\n"
+    "This is a **blocking function**.") {
+    janet_arity(argc, 3, 4);
+
+    flash_t *f = (flash_t *)janet_getabstract(argv, 0, &flash_type);
+    JanetByteView data = janet_getbytes(argv, 2);
+    uint32_t addr = flash_range(f, argv, 1, (uint32_t)data.len);
+    uint32_t ms = (uint32_t)janet_optnat(argv, argc, 3, 0);
+
+    device_t *d = flash_device(f);
+    channel_t *c = spi_device_channel(d);
+    uint8_t *frame = janet_smalloc(5 + f->page_size);
+    uint8_t in[FLASH_PIPELINE_PAGES];
+
+    USHORT state = 0;
+    FT_STATUS status = spi_device_begin(d, &state);
+    uint32_t offset = 0;
+    while (status == FT_OK && offset < (uint32_t)data.len) {
+        uint32_t pages = 0;
+        state = flash_queue_pages(f, d, c, state, frame, addr + offset, data.bytes + offset,
+                                  (uint32_t)data.len - offset, &pages);
+        status = spi_device_send(d, state, in, ms);
+        if (status != FT_OK)
+            break;
+
+        /* A page still programming was accepted, but the write enables and page programs
+            after it were ignored: take the pages up to it, and send the rest again. */
+        uint32_t done = 0;
+        BOOL busy = FALSE;
+        while (done < pages && !busy) {
+            if (!(in[done] & FLASH_SR_WIP) && (in[done] & FLASH_SR_WEL)) {
+                status = FT_FAILED_TO_WRITE_DEVICE;
+                break;
+            }
+            busy = (in[done] & FLASH_SR_WIP) != 0;
+            uint32_t page = f->page_size - ((addr + offset) % f->page_size);
+            offset += (page < (uint32_t)data.len - offset) ? page : ((uint32_t)data.len - offset);
+            done++;
+        }
+        if (status != FT_OK)
+            break;
+
+        if (busy) {
+            f->busy++;
+            f->delay += f->delay / 4 + 8;
+            uint8_t sr = 0;
+            status = spi_device_poll(d, FLASH_RDSR, FLASH_SR_WIP, 0, ms, &sr);
+        } else if (pages == FLASH_PIPELINE_PAGES && f->delay > f->tpp / 2) {
+            f->delay -= f->delay / 64 + 1;
+        }
+    }
+    janet_sfree(frame);
+    return flash_status(f, status, janet_wrap_boolean(status == FT_OK));
+}
+
+JANET_FN(cfun_flash_verify,
+    "(flash/verify chip addr data)",
+    "Read back `chip` at `addr` and compare it with `data`, 64KB at a time.\n\n"
+    "Returns true if it matches, the address of the first byte that differs, or `nil` on error. "
+    "Sets `:err` to return status.\n\n"
+    "This is a **blocking function**.") {
+    janet_fixarity(argc, 3);
+
+    flash_t *f = (flash_t *)janet_getabstract(argv, 0, &flash_type);
+    JanetByteView data = janet_getbytes(argv, 2);
+    uint32_t addr = flash_range(f, argv, 1, (uint32_t)data.len);
+
+    uint8_t *in = janet_smalloc(FLASH_READ_CHUNK);
+    Janet result = janet_wrap_true();
+    FT_STATUS status = FT_OK;
+    for (uint32_t offset = 0; offset < (uint32_t)data.len; offset += FLASH_READ_CHUNK) {
+        uint32_t chunk = ((uint32_t)data.len - offset) > FLASH_READ_CHUNK ? FLASH_READ_CHUNK : ((uint32_t)data.len - offset);
+        uint32_t readsz = 0;
+        status = flash_read(f, addr + offset, in, chunk, &readsz);
+        if (status != FT_OK) {
+            result = janet_wrap_nil();
+            break;
+        }
+        if (memcmp(in, data.bytes + offset, chunk) != 0) {
+            uint32_t i = 0;
+            while (in[i] == data.bytes[offset + i])
+                i++;
+            result = janet_wrap_number((double)addr + offset + i);
+            break;
+        }
+    }
+    janet_sfree(in);
+    return flash_status(f, status, result);
+}
+
+static JanetMethod flash_methods[] = {
+    {"info",            cfun_flash_info},
+    {"read",            cfun_flash_read},
+    {"erase",           cfun_flash_erase},
+    {"program",         cfun_flash_program},
+    {"verify",          cfun_flash_verify},
+    {NULL,              NULL}
+};
+
+static int flash_get(void *p, Janet key, Janet *out) {
+    (void) p;
+    if (!janet_checktype(key, JANET_KEYWORD))
+        janet_panicf("expected keyword, but got %t", key);
+    return janet_getmethod(janet_unwrap_keyword(key), flash_methods, out);
+}
+
+static int flash_gcmark(void *p, size_t s) {
+    (void) s;
+    flash_t *f = (flash_t *)p;
+    janet_mark(f->device);
+    return 0;
+}
+
+static void flash_string(void *p, JanetBuffer *buffer) {
+    flash_t *f = (flash_t *)p;
+    janet_formatb(buffer, "%02X%02X%02X %dKB", f->jedec[0], f->jedec[1], f->jedec[2], (int32_t)(f->size / 1024));
+}
+
+void flash_register(JanetTable *env) {
+    JanetRegExt cfuns[] = {
+        JANET_REG("flash/open",         cfun_flash_open),
+        JANET_REG("flash/info",         cfun_flash_info),
+        JANET_REG("flash/read",         cfun_flash_read),
+        JANET_REG("flash/erase",        cfun_flash_erase),
+        JANET_REG("flash/program",      cfun_flash_program),
+        JANET_REG("flash/verify",       cfun_flash_verify),
+        JANET_REG_END
+    };
+    janet_cfuns_ext(env, "flash", cfuns);
+}
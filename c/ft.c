@@ -0,0 +1,1657 @@
+// ft/ functions that don't belong to a protocol: sample decoding and the like
+
+#include <math.h>
+#include "module.h"
+#include "../LibMPSSE_1.0.7/release/source/ftdi_mid.h"
+
+#ifdef _WIN32
+#define THREAD_RETURN           DWORD WINAPI
+#define ATOMIC_LOAD(p)          ((uint32_t)InterlockedCompareExchange((volatile LONG *)(p), 0, 0))
+#define ATOMIC_STORE(p, v)      InterlockedExchange((volatile LONG *)(p), (LONG)(v))
+#define ATOMIC_FETCH_ADD(p, v)  ((uint32_t)InterlockedExchangeAdd((volatile LONG *)(p), (LONG)(v)))
+#else
+#include <pthread.h>
+#include <time.h>
+#define THREAD_RETURN           void *
+#define ATOMIC_LOAD(p)          __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE(p, v)      __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define ATOMIC_FETCH_ADD(p, v)  __atomic_fetch_add((p), (v), __ATOMIC_ACQ_REL)
+#endif
+
+#define PARALLEL_WORKERS        8       // max threads used by ft_parallel
+#define SAMPLER_CAPACITY        1024    // default ring slots
+#define SAMPLER_JITTER_WEIGHT   16      // moving average of 1/16 per sample
+#define AWAIT_TIMEOUT           5.0     // default ft/await timeout, s
+#define AWAIT_TICK              1000000 // ns the watcher waits while a wakeup is queued
+#define AWAIT_MAX_WAIT          1000000000  // ns the watcher waits at most
+#define AWAIT_CLASSES           3       // ft/await priorities :high, :normal & :bulk
+#ifndef M_PI
+#define M_PI                    3.14159265358979323846
+#endif
+#define FUSION_REPORTS          256     // downsampled attitudes kept for ft/fusion-drain
+#define FUSION_BETA             0.1     // default Madgwick gain
+#define FUSION_KP               1.0     // default complementary gain, rad/s
+
+/* ft/fusion keeps the orientation of an IMU as a quaternion, updated each sample from its
+    accel & gyro channels, either on a sampler's thread or from blocks given by Janet. The
+    filter state is under 'lock', so Janet can read the attitude while the sampler updates it. */
+typedef struct {
+    Janet           frame;
+    frame_t         *f;             // unwrapped, for the thread
+    int32_t         channel[6];     // ax ay az gx gy gz, in the frame
+    int32_t         madgwick;       // else complementary
+    double          gain;
+    double          period;         // s, for the first sample and samples without a time
+    uint32_t        decimate;       // a report every 'decimate' updates
+    // under lock
+    double          q[4];           // w x y z
+    double          last;           // s, time of the last update
+    uint32_t        updates;
+    uint32_t        report_head;    // count of reports pushed
+    uint32_t        report_tail;    // count of reports drained, or dropped
+    double          reports[FUSION_REPORTS][5];     // t w x y z
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+#else
+    pthread_mutex_t lock;
+#endif
+} fusion_t;
+
+/* ft/sampler runs a transaction on its own thread at a fixed rate, and pushes each result
+    into a preallocated single-producer, single-consumer ring that Janet drains in batches.
+    'head' is only written by the thread, and 'tail' only by Janet. */
+typedef struct sampler_s {
+    Janet           transaction;
+    transaction_t   *t;             // unwrapped, for the thread
+    Janet           fusion;         // updated with each sample, or nil
+    fusion_t        *fu;
+    int64_t         period;         // ns
+    uint32_t        capacity;       // ring slots
+    uint32_t        slot_size;      // timestamp, then transaction->size bytes
+    uint8_t         *ring;
+    uint32_t        head;           // count of samples pushed
+    uint32_t        tail;           // count of samples drained
+    uint32_t        running;
+    uint32_t        stop;
+    // stats, written by the thread
+    uint32_t        runs;
+    uint32_t        missed;         // deadlines passed by more than a period, with no run
+    uint32_t        overflows;      // runs skipped with the ring full
+    uint32_t        errors;
+    uint32_t        last_status;
+    uint32_t        jitter_max;     // ns late from the deadline
+    uint32_t        jitter_avg;
+#ifdef _WIN32
+    HANDLE          thread;
+#else
+    pthread_t       thread;
+#endif
+    struct sampler_s *next;         // in the running samplers of this VM
+} sampler_t;
+
+static int  transaction_gc(void *p, size_t s);
+static int  transaction_gcmark(void *p, size_t s);
+static int  frame_get(void *p, Janet key, Janet *out);
+static int  frame_gcmark(void *p, size_t s);
+static int  fusion_get(void *p, Janet key, Janet *out);
+static int  fusion_gc(void *p, size_t s);
+static int  fusion_gcmark(void *p, size_t s);
+static int  sampler_get(void *p, Janet key, Janet *out);
+static int  sampler_gc(void *p, size_t s);
+static int  sampler_gcmark(void *p, size_t s);
+
+const JanetAbstractType transaction_type = {
+    "ft/transaction",
+    transaction_gc,         // gc
+    transaction_gcmark,     // gcmark
+    JANET_ATEND_GCMARK
+};
+
+const JanetAbstractType frame_type = {
+    "ft/frame",
+    NULL,                   // gc
+    frame_gcmark,           // gcmark
+    frame_get,              // get
+    JANET_ATEND_GET
+};
+
+static const JanetAbstractType fusion_type = {
+    "ft/fusion",
+    fusion_gc,              // gc
+    fusion_gcmark,          // gcmark
+    fusion_get,             // get
+    JANET_ATEND_GET
+};
+
+static const JanetAbstractType sampler_type = {
+    "ft/sampler",
+    sampler_gc,             // gc
+    sampler_gcmark,         // gcmark
+    sampler_get,            // get
+    JANET_ATEND_GET
+};
+
+/***************/
+/* C Functions */
+/***************/
+
+static inline int16_t i16be(const uint8_t *p) {
+    return (int16_t)((p[0] << 8) | p[1]);
+}
+
+JANET_FN(cfun_ft_unpack_i16be,
+    "(ft/unpack-i16be bytes scale &opt stride dest)",
+    "Decode the big-endian signed 16-bit words of `bytes` and multiply each by `scale`, "
+    "which is a number, or an indexed of numbers applied in turn to consecutive words "
+    "(e.g. one per word of a sensor frame).\n\n"
+    "Words start every `stride` bytes (default 2), so a larger stride picks one word out of each frame.\n\n"
+    "Results are written into `dest` from index 0, which is resized to fit: an array gets numbers, "
+    "and a buffer gets native-endian 64-bit doubles. Reusing `dest` decodes without allocating.\n\n"
+    "Returns `dest`, or a new array.") {
+    janet_arity(argc, 2, 4);
+
+    JanetByteView in = janet_getbytes(argv, 0);
+
+    int32_t stride = janet_optinteger(argv, argc, 2, 2);
+    if (stride < 2)
+        janet_panicf("stride %d is too small, expected at least 2", stride);
+    int32_t n = in.len < 2 ? 0 : (in.len - 2) / stride + 1;
+
+    Janet dest;
+    if (argc < 4 || janet_checktype(argv[3], JANET_NIL)) {
+        dest = janet_wrap_array(janet_array(n));
+    } else if (janet_checktypes(argv[3], JANET_TFLAG_ARRAY | JANET_TFLAG_BUFFER)) {
+        dest = argv[3];
+        if (janet_checktype(dest, JANET_BUFFER) && janet_unwrap_buffer(dest)->data == in.bytes)
+            janet_panic("dest must not be the source buffer");
+    } else {
+        janet_panic_type(argv[3], 3, JANET_TFLAG_ARRAY | JANET_TFLAG_BUFFER);
+    }
+
+    double scale = 1.0;
+    double *scales = &scale;
+    int32_t nscales = 1;
+    if (janet_checktype(argv[1], JANET_NUMBER)) {
+        scale = janet_unwrap_number(argv[1]);
+    } else {
+        JanetView v = janet_getindexed(argv, 1);
+        if (v.len < 1)
+            janet_panic("expected at least one scale");
+        for (int32_t i = 0; i < v.len; i++)
+            if (!janet_checktype(v.items[i], JANET_NUMBER))
+                janet_panicf("expected number scale, got %v", v.items[i]);
+        scales = janet_smalloc(v.len * sizeof(double));
+        for (int32_t i = 0; i < v.len; i++)
+            scales[i] = janet_unwrap_number(v.items[i]);
+        nscales = v.len;
+    }
+
+    // separate loops, so the common single scale case has no index to track
+    scale = scales[0];
+    if (janet_checktype(dest, JANET_ARRAY)) {
+        JanetArray *a = janet_unwrap_array(dest);
+        janet_array_ensure(a, n, 1);
+        if (nscales == 1) {
+            for (int32_t i = 0; i < n; i++)
+                a->data[i] = janet_wrap_number(i16be(in.bytes + i * stride) * scale);
+        } else {
+            for (int32_t i = 0, k = 0; i < n; i++) {
+                a->data[i] = janet_wrap_number(i16be(in.bytes + i * stride) * scales[k]);
+                if (++k == nscales)
+                    k = 0;
+            }
+        }
+        a->count = n;
+    } else {
+        JanetBuffer *b = janet_unwrap_buffer(dest);
+        janet_buffer_ensure(b, n * (int32_t)sizeof(double), 1);
+        double *out = (double *)b->data;
+        if (nscales == 1) {
+            for (int32_t i = 0; i < n; i++)
+                out[i] = i16be(in.bytes + i * stride) * scale;
+        } else {
+            for (int32_t i = 0, k = 0; i < n; i++) {
+                out[i] = i16be(in.bytes + i * stride) * scales[k];
+                if (++k == nscales)
+                    k = 0;
+            }
+        }
+        b->count = n * (int32_t)sizeof(double);
+    }
+
+    if (scales != &scale)
+        janet_sfree(scales);
+    return dest;
+}
+
+/* Frame layouts */
+
+int32_t frame_channel(const frame_t *f, Janet name) {
+    for (int32_t i = 0; i < f->count; i++)
+        if (janet_equals(f->channels[i].name, name))
+            return i;
+    return -1;
+}
+
+/* One channel of 'n' frames at a time: a fixed stride and a single multiply-add per word,
+    with the endian and sign tests out of the loop, which compilers vectorize. */
+void frame_convert(const frame_t *f, int32_t channel, const uint8_t *in, int32_t n, double *out) {
+    const frame_channel_t *c = &f->channels[channel];
+    const uint8_t *p = in + c->word * 2;
+    int32_t stride = f->words * 2;
+    double scale = c->scale;
+    double offset = c->offset;
+    if (f->little && f->is_unsigned) {
+        for (int32_t i = 0; i < n; i++)
+            out[i] = (uint16_t)(p[i * stride] | (p[i * stride + 1] << 8)) * scale + offset;
+    } else if (f->little) {
+        for (int32_t i = 0; i < n; i++)
+            out[i] = (int16_t)(p[i * stride] | (p[i * stride + 1] << 8)) * scale + offset;
+    } else if (f->is_unsigned) {
+        for (int32_t i = 0; i < n; i++)
+            out[i] = (uint16_t)((p[i * stride] << 8) | p[i * stride + 1]) * scale + offset;
+    } else {
+        for (int32_t i = 0; i < n; i++)
+            out[i] = (int16_t)((p[i * stride] << 8) | p[i * stride + 1]) * scale + offset;
+    }
+}
+
+// Index of a word given by its name in 'words', or by its index
+static int32_t frame_word(JanetView words, Janet word) {
+    if (janet_checkint(word)) {
+        int32_t i = janet_unwrap_integer(word);
+        if (i < 0 || i >= words.len)
+            janet_panicf("word %d is out of range, the frame has %d words", i, words.len);
+        return i;
+    }
+    for (int32_t i = 0; i < words.len; i++)
+        if (!janet_checktype(words.items[i], JANET_NIL) && janet_equals(words.items[i], word))
+            return i;
+    janet_panicf("frame has no word %v", word);
+}
+
+JANET_FN(cfun_ft_frame,
+    "(ft/frame words &opt channels endian type)",
+    "Describe a frame of interleaved 16-bit words, for `ft/frame-decode`. `words` names each word "
+    "in order, e.g. `[:ax :ay :az :t :gx :gy :gz]`, with `nil` for a word to skip. `endian` is `:be` "
+    "(the default) or `:le`, and `type` is `:i16` for signed words (the default) or `:u16`.\n\n"
+    "`channels` are what is decoded, each a word name, or `[name word &opt scale offset]` for the word "
+    "`word` (a name or index) times `scale` plus `offset`, which also remaps axes: "
+    "`[:x :ay -0.001]` is the negated y word, as x. Defaults to every named word, unscaled.\n\n"
+    "Returns an `<ft/frame>`.") {
+    janet_arity(argc, 1, 4);
+
+    JanetView words = janet_getindexed(argv, 0);
+    if (words.len < 1)
+        janet_panic("expected at least one word");
+
+    int little = 0;
+    if (argc > 2 && !janet_checktype(argv[2], JANET_NIL)) {
+        if (janet_keyeq(argv[2], "le"))
+            little = 1;
+        else if (!janet_keyeq(argv[2], "be"))
+            janet_panicf("expected :be or :le, got %v", argv[2]);
+    }
+    int is_unsigned = 0;
+    if (argc > 3 && !janet_checktype(argv[3], JANET_NIL)) {
+        if (janet_keyeq(argv[3], "u16"))
+            is_unsigned = 1;
+        else if (!janet_keyeq(argv[3], "i16"))
+            janet_panicf("expected :i16 or :u16, got %v", argv[3]);
+    }
+
+    JanetView channels = words;
+    if (argc > 1 && !janet_checktype(argv[1], JANET_NIL))
+        channels = janet_getindexed(argv, 1);
+
+    frame_t *f = (frame_t *)janet_abstract(&frame_type, sizeof(frame_t) + channels.len * sizeof(frame_channel_t));
+    f->words = words.len;
+    f->little = little;
+    f->is_unsigned = is_unsigned;
+    f->count = 0;
+    for (int32_t i = 0; i < channels.len; i++) {
+        Janet spec = channels.items[i];
+        if (janet_checktype(spec, JANET_NIL))
+            continue;   // a skipped word, when channels default to the words
+        frame_channel_t *c = &f->channels[f->count];
+        JanetView v;
+        if (janet_indexed_view(spec, &v.items, &v.len) && v.len >= 2 && v.len <= 4) {
+            c->name = v.items[0];
+            c->word = frame_word(words, v.items[1]);
+            c->scale = (v.len > 2) ? janet_getnumber(v.items, 2) : 1.0;
+            c->offset = (v.len > 3) ? janet_getnumber(v.items, 3) : 0.0;
+        } else if (janet_checktype(spec, JANET_KEYWORD) || janet_checktype(spec, JANET_SYMBOL)) {
+            c->name = spec;
+            c->word = frame_word(words, spec);
+            c->scale = 1.0;
+            c->offset = 0.0;
+        } else {
+            janet_panicf("channel %v is invalid, expected a word name or [name word &opt scale offset]", spec);
+        }
+        f->count++;
+    }
+    if (f->count < 1)
+        janet_panic("expected at least one channel");
+    return janet_wrap_abstract(f);
+}
+
+JANET_FN(cfun_ft_frame_decode,
+    "(ft/frame-decode frame bytes &opt dest)",
+    "Decode the frames of `bytes`, e.g. an `i2c/fifo-read` buffer or `ft/sampler-drain` data, "
+    "into a column per channel of `frame`: `dest` is a table of channel names to an array of numbers, "
+    "or to a buffer of native-endian 64-bit doubles, each refilled from index 0. Channels not in `dest` "
+    "get a new array. `bytes` must hold whole frames.\n\n"
+    "Returns `dest`, or a new table.") {
+    janet_arity(argc, 2, 3);
+
+    frame_t *f = (frame_t *)janet_getabstract(argv, 0, &frame_type);
+    JanetByteView in = janet_getbytes(argv, 1);
+    JanetTable *dest = (argc > 2 && !janet_checktype(argv[2], JANET_NIL))
+                       ? janet_gettable(argv, 2) : janet_table(f->count);
+    if (in.len % (f->words * 2))
+        janet_panicf("%d bytes is not a whole number of %d-byte frames", in.len, f->words * 2);
+    int32_t n = in.len / (f->words * 2);
+
+    double *scratch = NULL;     // for array columns, converted then wrapped
+    for (int32_t i = 0; i < f->count; i++) {
+        Janet column = janet_table_get(dest, f->channels[i].name);
+        if (janet_checktype(column, JANET_BUFFER)) {
+            JanetBuffer *b = janet_unwrap_buffer(column);
+            if (b->data == in.bytes)
+                janet_panic("dest must not hold the source buffer");
+            janet_buffer_ensure(b, n * (int32_t)sizeof(double), 1);
+            frame_convert(f, i, in.bytes, n, (double *)b->data);
+            b->count = n * (int32_t)sizeof(double);
+            continue;
+        }
+        JanetArray *a = janet_checktype(column, JANET_ARRAY) ? janet_unwrap_array(column) : janet_array(n);
+        janet_array_ensure(a, n, 1);
+        if (NULL == scratch)
+            scratch = janet_smalloc((n ? n : 1) * sizeof(double));
+        frame_convert(f, i, in.bytes, n, scratch);
+        for (int32_t k = 0; k < n; k++)
+            a->data[k] = janet_wrap_number(scratch[k]);
+        a->count = n;
+        janet_table_put(dest, f->channels[i].name, janet_wrap_array(a));
+    }
+    if (scratch)
+        janet_sfree(scratch);
+    return janet_wrap_table(dest);
+}
+
+JANET_FN(cfun_ft_frame_size,
+    "(ft/frame-size frame)",
+    "Bytes per frame.") {
+    janet_fixarity(argc, 1);
+
+    frame_t *f = (frame_t *)janet_getabstract(argv, 0, &frame_type);
+    return janet_wrap_integer(f->words * 2);
+}
+
+static JanetMethod frame_methods[] = {
+    {"decode",          cfun_ft_frame_decode},
+    {"size",            cfun_ft_frame_size},
+    {NULL,              NULL}
+};
+
+static int frame_get(void *p, Janet key, Janet *out) {
+    (void) p;
+    if (!janet_checktype(key, JANET_KEYWORD))
+        janet_panicf("expected keyword, but got %t", key);
+    return janet_getmethod(janet_unwrap_keyword(key), frame_methods, out);
+}
+
+static int frame_gcmark(void *p, size_t s) {
+    (void) s;
+    frame_t *f = (frame_t *)p;
+    for (int32_t i = 0; i < f->count; i++)
+        janet_mark(f->channels[i].name);
+    return 0;
+}
+
+/* Orientation filters */
+
+static void fusion_lock(fusion_t *fu) {
+#ifdef _WIN32
+    EnterCriticalSection(&fu->lock);
+#else
+    pthread_mutex_lock(&fu->lock);
+#endif
+}
+
+static void fusion_unlock(fusion_t *fu) {
+#ifdef _WIN32
+    LeaveCriticalSection(&fu->lock);
+#else
+    pthread_mutex_unlock(&fu->lock);
+#endif
+}
+
+static void quat_normalize(double *q) {
+    double norm = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    if (norm == 0.0) {
+        q[0] = 1.0;
+        q[1] = q[2] = q[3] = 0.0;
+        return;
+    }
+    for (int i = 0; i < 4; i++)
+        q[i] /= norm;
+}
+
+// Integrate the body rates g (rad/s) over dt
+static void quat_integrate(double *q, double gx, double gy, double gz, double dt) {
+    double dq[4] = {
+        0.5 * (-q[1] * gx - q[2] * gy - q[3] * gz),
+        0.5 * ( q[0] * gx + q[2] * gz - q[3] * gy),
+        0.5 * ( q[0] * gy - q[1] * gz + q[3] * gx),
+        0.5 * ( q[0] * gz + q[1] * gy - q[2] * gx)};
+    for (int i = 0; i < 4; i++)
+        q[i] += dq[i] * dt;
+    quat_normalize(q);
+}
+
+/* Madgwick's IMU filter: the rate of change from the gyro, less 'beta' times the normalized
+    gradient of the error between the measured gravity and that of the estimate. */
+static void fusion_madgwick(double *q, const double *v, double beta, double dt) {
+    double q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+    double gx = v[3], gy = v[4], gz = v[5];
+    double dq[4] = {
+        0.5 * (-q1 * gx - q2 * gy - q3 * gz),
+        0.5 * ( q0 * gx + q2 * gz - q3 * gy),
+        0.5 * ( q0 * gy - q1 * gz + q3 * gx),
+        0.5 * ( q0 * gz + q1 * gy - q2 * gx)};
+
+    double norm = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (norm > 0.0) {   // in free fall there is no gravity to correct with
+        double ax = v[0] / norm, ay = v[1] / norm, az = v[2] / norm;
+        double s[4] = {
+            4 * q0 * q2 * q2 + 2 * q2 * ax + 4 * q0 * q1 * q1 - 2 * q1 * ay,
+            4 * q1 * q3 * q3 - 2 * q3 * ax + 4 * q0 * q0 * q1 - 2 * q0 * ay - 4 * q1
+                + 8 * q1 * q1 * q1 + 8 * q1 * q2 * q2 + 4 * q1 * az,
+            4 * q0 * q0 * q2 + 2 * q0 * ax + 4 * q2 * q3 * q3 - 2 * q3 * ay - 4 * q2
+                + 8 * q2 * q1 * q1 + 8 * q2 * q2 * q2 + 4 * q2 * az,
+            4 * q1 * q1 * q3 - 2 * q1 * ax + 4 * q2 * q2 * q3 - 2 * q2 * ay};
+        double step = sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2] + s[3] * s[3]);
+        if (step > 0.0)
+            for (int i = 0; i < 4; i++)
+                dq[i] -= beta * s[i] / step;
+    }
+    for (int i = 0; i < 4; i++)
+        q[i] += dq[i] * dt;
+    quat_normalize(q);
+}
+
+/* A complementary filter: the gyro rates, plus 'kp' times the error between the measured
+    gravity and that of the estimate, so tilt follows the accelerometer below about kp rad/s
+    and the gyro above. Yaw is the integrated gyro alone. */
+static void fusion_complementary(double *q, const double *v, double kp, double dt) {
+    double gx = v[3], gy = v[4], gz = v[5];
+    double norm = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (norm > 0.0) {
+        double ax = v[0] / norm, ay = v[1] / norm, az = v[2] / norm;
+        // gravity as the estimate sees it, in the body frame
+        double vx = 2 * (q[1] * q[3] - q[0] * q[2]);
+        double vy = 2 * (q[0] * q[1] + q[2] * q[3]);
+        double vz = q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3];
+        gx += kp * (ay * vz - az * vy);
+        gy += kp * (az * vx - ax * vz);
+        gz += kp * (ax * vy - ay * vx);
+    }
+    quat_integrate(q, gx, gy, gz, dt);
+}
+
+// One sample, at 't' seconds or one period after the last if 't' is NAN. Called under the lock.
+static void fusion_step(fusion_t *fu, const uint8_t *frame, double t) {
+    double v[6];
+    for (int i = 0; i < 6; i++)
+        frame_convert(fu->f, fu->channel[i], frame, 1, &v[i]);
+    for (int i = 3; i < 6; i++)
+        v[i] *= M_PI / 180.0;
+
+    double dt = fu->period;
+    if (isnan(t))
+        t = fu->last + fu->period;
+    else if (fu->updates > 0 && t > fu->last)
+        dt = t - fu->last;
+    if (fu->madgwick)
+        fusion_madgwick(fu->q, v, fu->gain, dt);
+    else
+        fusion_complementary(fu->q, v, fu->gain, dt);
+    fu->last = t;
+
+    if (++fu->updates % fu->decimate == 0) {
+        if (fu->report_head - fu->report_tail == FUSION_REPORTS)
+            fu->report_tail++;  // drop the oldest
+        double *r = fu->reports[fu->report_head++ % FUSION_REPORTS];
+        r[0] = t;
+        memcpy(r + 1, fu->q, sizeof(fu->q));
+    }
+}
+
+JANET_FN(cfun_ft_fusion,
+    "(ft/fusion frame rate &opt algorithm gain decimate)",
+    "An orientation filter of an IMU, fusing its accelerometer and gyro into a quaternion at the full "
+    "sample `rate` (Hz). `frame` is an `<ft/frame>` of its samples, with channels `:ax :ay :az` "
+    "(in any unit, e.g. g) and `:gx :gy :gz` in °/s, e.g. of an MPU6050 `i2c/transaction` reply.\n\n"
+    "`algorithm` is `:madgwick` (the default), with `gain` its beta (default 0.1), or `:complementary`, "
+    "with `gain` the rate in rad/s below which tilt follows the accelerometer (default 1.0). Every "
+    "`decimate` updates (default 10) the attitude is also kept for `ft/fusion-drain`.\n\n"
+    "Samples come from `ft/fusion-update`, or from an `ft/sampler` given the filter, which updates it "
+    "on its thread as each sample is read.\n\n"
+    "Returns an `<ft/fusion>`.") {
+    janet_arity(argc, 2, 5);
+
+    frame_t *f = (frame_t *)janet_getabstract(argv, 0, &frame_type);
+    double rate = janet_getnumber(argv, 1);
+    if (!(rate > 0.0))
+        janet_panicf("rate %v is invalid, expected a positive number of Hz", argv[1]);
+    int32_t madgwick = 1;
+    if (argc > 2 && !janet_checktype(argv[2], JANET_NIL)) {
+        if (janet_keyeq(argv[2], "complementary"))
+            madgwick = 0;
+        else if (!janet_keyeq(argv[2], "madgwick"))
+            janet_panicf("expected :madgwick or :complementary, got %v", argv[2]);
+    }
+    double gain = (argc > 3 && !janet_checktype(argv[3], JANET_NIL))
+                  ? janet_getnumber(argv, 3) : (madgwick ? FUSION_BETA : FUSION_KP);
+    if (gain < 0.0)
+        janet_panicf("gain %v is invalid, expected a positive number", argv[3]);
+    int32_t decimate = janet_optinteger(argv, argc, 4, 10);
+    if (decimate < 1)
+        janet_panicf("decimate %d is invalid, expected at least 1", decimate);
+
+    static const char *names[6] = {"ax", "ay", "az", "gx", "gy", "gz"};
+    int32_t channel[6];
+    for (int i = 0; i < 6; i++) {
+        channel[i] = frame_channel(f, janet_ckeywordv(names[i]));
+        if (channel[i] < 0)
+            janet_panicf("frame has no channel :%s", names[i]);
+    }
+
+    fusion_t *fu = janet_abstract(&fusion_type, sizeof(fusion_t));
+    memset(fu, 0, sizeof(fusion_t));
+    fu->frame = argv[0];
+    fu->f = f;
+    memcpy(fu->channel, channel, sizeof(channel));
+    fu->madgwick = madgwick;
+    fu->gain = gain;
+    fu->period = 1.0 / rate;
+    fu->decimate = (uint32_t)decimate;
+    fu->q[0] = 1.0;
+#ifdef _WIN32
+    InitializeCriticalSection(&fu->lock);
+#else
+    pthread_mutex_init(&fu->lock, NULL);
+#endif
+    return janet_wrap_abstract(fu);
+}
+
+JANET_FN(cfun_ft_fusion_update,
+    "(ft/fusion-update fusion bytes &opt times)",
+    "Update the filter with every whole frame of `bytes`, e.g. `ft/sampler-drain` data or an "
+    "`i2c/fifo-read` buffer, oldest first. `times` are their timestamps in seconds, as drained; without "
+    "them the samples are taken to be one period apart.\n\n"
+    "Returns the number of samples.") {
+    janet_arity(argc, 2, 3);
+
+    fusion_t *fu = (fusion_t *)janet_getabstract(argv, 0, &fusion_type);
+    JanetByteView in = janet_getbytes(argv, 1);
+    int32_t size = fu->f->words * 2;
+    int32_t n = in.len / size;
+    JanetView times = {NULL, 0};
+    if (argc > 2 && !janet_checktype(argv[2], JANET_NIL)) {
+        times = janet_getindexed(argv, 2);
+        if (times.len < n)
+            janet_panicf("%d times for %d samples", times.len, n);
+        for (int32_t i = 0; i < n; i++)
+            if (!janet_checktype(times.items[i], JANET_NUMBER))
+                janet_panicf("expected number time, got %v", times.items[i]);
+    }
+
+    fusion_lock(fu);
+    for (int32_t i = 0; i < n; i++)
+        fusion_step(fu, in.bytes + i * size, times.items ? janet_unwrap_number(times.items[i]) : NAN);
+    fusion_unlock(fu);
+    return janet_wrap_integer(n);
+}
+
+JANET_FN(cfun_ft_fusion_attitude,
+    "(ft/fusion-attitude fusion)",
+    "The current orientation, as a quaternion tuple `[w x y z]`.") {
+    janet_fixarity(argc, 1);
+
+    fusion_t *fu = (fusion_t *)janet_getabstract(argv, 0, &fusion_type);
+    double q[4];
+    fusion_lock(fu);
+    memcpy(q, fu->q, sizeof(q));
+    fusion_unlock(fu);
+    Janet out[4];
+    for (int i = 0; i < 4; i++)
+        out[i] = janet_wrap_number(q[i]);
+    return janet_wrap_tuple(janet_tuple_n(out, 4));
+}
+
+JANET_FN(cfun_ft_fusion_euler,
+    "(ft/fusion-euler fusion)",
+    "The current orientation, as a tuple of `[roll pitch yaw]` in degrees.") {
+    janet_fixarity(argc, 1);
+
+    fusion_t *fu = (fusion_t *)janet_getabstract(argv, 0, &fusion_type);
+    double q[4];
+    fusion_lock(fu);
+    memcpy(q, fu->q, sizeof(q));
+    fusion_unlock(fu);
+    double sinp = 2 * (q[0] * q[2] - q[3] * q[1]);
+    if (sinp > 1.0)
+        sinp = 1.0;
+    else if (sinp < -1.0)
+        sinp = -1.0;
+    Janet out[3] = {
+        janet_wrap_number(atan2(2 * (q[0] * q[1] + q[2] * q[3]), 1 - 2 * (q[1] * q[1] + q[2] * q[2])) * 180.0 / M_PI),
+        janet_wrap_number(asin(sinp) * 180.0 / M_PI),
+        janet_wrap_number(atan2(2 * (q[0] * q[3] + q[1] * q[2]), 1 - 2 * (q[2] * q[2] + q[3] * q[3])) * 180.0 / M_PI)};
+    return janet_wrap_tuple(janet_tuple_n(out, 3));
+}
+
+JANET_FN(cfun_ft_fusion_drain,
+    "(ft/fusion-drain fusion &opt dest)",
+    "Take the attitudes kept every `decimate` updates, as tuples of `[time w x y z]`, oldest first, "
+    "pushed to the array `dest`. Only the latest 256 are kept.\n\n"
+    "Returns `dest`, or a new array.") {
+    janet_arity(argc, 1, 2);
+
+    fusion_t *fu = (fusion_t *)janet_getabstract(argv, 0, &fusion_type);
+    JanetArray *dest = (argc > 1 && !janet_checktype(argv[1], JANET_NIL))
+                       ? janet_getarray(argv, 1) : janet_array(0);
+
+    double reports[FUSION_REPORTS][5];
+    int32_t n = 0;
+    fusion_lock(fu);
+    for (; fu->report_tail != fu->report_head; fu->report_tail++)
+        memcpy(reports[n++], fu->reports[fu->report_tail % FUSION_REPORTS], sizeof(reports[0]));
+    fusion_unlock(fu);
+
+    janet_array_ensure(dest, dest->count + n, 2);
+    for (int32_t i = 0; i < n; i++) {
+        Janet r[5];
+        for (int k = 0; k < 5; k++)
+            r[k] = janet_wrap_number(reports[i][k]);
+        dest->data[dest->count++] = janet_wrap_tuple(janet_tuple_n(r, 5));
+    }
+    return janet_wrap_array(dest);
+}
+
+JANET_FN(cfun_ft_fusion_reset,
+    "(ft/fusion-reset fusion)",
+    "Reset the orientation to the identity, and drop the attitudes kept.\n\n"
+    "Returns `fusion`.") {
+    janet_fixarity(argc, 1);
+
+    fusion_t *fu = (fusion_t *)janet_getabstract(argv, 0, &fusion_type);
+    fusion_lock(fu);
+    fu->q[0] = 1.0;
+    fu->q[1] = fu->q[2] = fu->q[3] = 0.0;
+    fu->updates = 0;
+    fu->report_tail = fu->report_head;
+    fusion_unlock(fu);
+    return argv[0];
+}
+
+static JanetMethod fusion_methods[] = {
+    {"update",          cfun_ft_fusion_update},
+    {"attitude",        cfun_ft_fusion_attitude},
+    {"euler",           cfun_ft_fusion_euler},
+    {"drain",           cfun_ft_fusion_drain},
+    {"reset",           cfun_ft_fusion_reset},
+    {NULL,              NULL}
+};
+
+static int fusion_get(void *p, Janet key, Janet *out) {
+    (void) p;
+    if (!janet_checktype(key, JANET_KEYWORD))
+        janet_panicf("expected keyword, but got %t", key);
+    return janet_getmethod(janet_unwrap_keyword(key), fusion_methods, out);
+}
+
+static int fusion_gcmark(void *p, size_t s) {
+    (void) s;
+    janet_mark(((fusion_t *)p)->frame);
+    return 0;
+}
+
+// a sampler updating the filter marks it, so it's only running here when the VM exits
+static int fusion_gc(void *p, size_t s) {
+    (void) s;
+    ft_sampler_release(p);
+#ifdef _WIN32
+    DeleteCriticalSection(&((fusion_t *)p)->lock);
+#else
+    pthread_mutex_destroy(&((fusion_t *)p)->lock);
+#endif
+    return 0;
+}
+
+/* Transactions */
+
+Janet transaction_new(Janet owner, FT_HANDLE *handle, transaction_fn run,
+                      transaction_send_fn send, transaction_fn receive, uint32_t size,
+                      const uint8_t *data, uint32_t count) {
+    transaction_t *t = janet_abstract(&transaction_type, sizeof(transaction_t) + count);
+    t->owner = owner;
+    t->handle = handle;
+    t->run = run;
+    t->send = send;
+    t->receive = receive;
+    t->size = size;
+    t->count = count;
+    memcpy(t->data, data, count);
+    return janet_wrap_abstract(t);
+}
+
+FT_STATUS transaction_run(transaction_t *t, uint8_t *in) {
+    if (NULL == *t->handle)
+        return FT_DEVICE_NOT_OPENED;
+    return t->run(t, in);
+}
+
+static int transaction_gcmark(void *p, size_t s) {
+    (void) s;
+    janet_mark(((transaction_t *)p)->owner);
+    return 0;
+}
+
+// a sampler running the transaction marks it, so it's only running here when the VM exits
+static int transaction_gc(void *p, size_t s) {
+    (void) s;
+    ft_sampler_release(p);
+    return 0;
+}
+
+/* Sampler thread */
+
+int64_t ft_monotonic_ns(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (int64_t)((double)now.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static void sleep_until_ns(int64_t deadline) {
+#ifdef _WIN32
+    // no absolute timer: sleep most of the way, then spin on the counter
+    int64_t left;
+    while ((left = deadline - ft_monotonic_ns()) > 0) {
+        if (left > 2000000)
+            Sleep((DWORD)(left / 1000000) - 1);
+        else
+            SwitchToThread();
+    }
+#else
+    struct timespec ts = {deadline / 1000000000, deadline % 1000000000};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+        ; // EINTR
+#endif
+}
+
+static THREAD_RETURN sampler_thread(void *p) {
+    sampler_t *s = (sampler_t *)p;
+    transaction_t *t = s->t;
+    int64_t deadline = ft_monotonic_ns();
+    // the stats Janet reads are only stored atomically; the jitter is kept here between runs
+    uint32_t jitter_max = 0;
+    int64_t jitter_avg = 0;
+
+    while (!ATOMIC_LOAD(&s->stop)) {
+        sleep_until_ns(deadline);
+        int64_t start = ft_monotonic_ns();
+        int64_t late = start - deadline;
+        if (late >= s->period) {
+            // fell behind; skip to the current period rather than run back to back
+            int64_t skip = late / s->period;
+            ATOMIC_FETCH_ADD(&s->missed, (uint32_t)skip);
+            deadline += skip * s->period;
+            late -= skip * s->period;
+        }
+        // in ns, so clamped at about 4.29 s for long periods
+        uint32_t jitter = (late > (int64_t)UINT32_MAX) ? UINT32_MAX : (uint32_t)late;
+        if (jitter > jitter_max) {
+            jitter_max = jitter;
+            ATOMIC_STORE(&s->jitter_max, jitter_max);
+        }
+        jitter_avg += ((int64_t)jitter - jitter_avg) / SAMPLER_JITTER_WEIGHT;
+        ATOMIC_STORE(&s->jitter_avg, (uint32_t)jitter_avg);
+        deadline += s->period;
+
+        uint32_t head = s->head;
+        int full = head - ATOMIC_LOAD(&s->tail) >= s->capacity;
+        if (full && NULL == s->fu) {
+            ATOMIC_FETCH_ADD(&s->overflows, 1);
+            continue;
+        }
+        // a filter keeps being updated with the ring full, from the spare slot past its end
+        uint8_t *slot = s->ring + (size_t)(full ? s->capacity : head % s->capacity) * s->slot_size;
+        FT_STATUS status = transaction_run(t, slot + sizeof(int64_t));
+        ATOMIC_FETCH_ADD(&s->runs, 1);
+        ATOMIC_STORE(&s->last_status, (uint32_t)status);
+        if (status != FT_OK) {
+            ATOMIC_FETCH_ADD(&s->errors, 1);
+            continue;
+        }
+        if (s->fu) {
+            fusion_lock(s->fu);
+            fusion_step(s->fu, slot + sizeof(int64_t), (double)start / 1e9);
+            fusion_unlock(s->fu);
+        }
+        if (full) {
+            ATOMIC_FETCH_ADD(&s->overflows, 1);
+            continue;
+        }
+        memcpy(slot, &start, sizeof(int64_t));
+        ATOMIC_STORE(&s->head, head + 1);
+    }
+    return 0;
+}
+
+/* The samplers running in this VM. A running sampler is rooted, and marks its transaction and
+    filter, but when the VM exits they are all finalized, in any order, with the threads still
+    running: whichever of them goes first stops the threads that use it. */
+static JANET_THREAD_LOCAL sampler_t *samplers = NULL;
+
+static void sampler_stop(sampler_t *s) {
+    if (!s->running)
+        return;
+    for (sampler_t **l = &samplers; *l != NULL; l = &(*l)->next) {
+        if (*l == s) {
+            *l = s->next;
+            break;
+        }
+    }
+    ATOMIC_STORE(&s->stop, 1);
+#ifdef _WIN32
+    WaitForSingleObject(s->thread, INFINITE);
+    CloseHandle(s->thread);
+#else
+    pthread_join(s->thread, NULL);
+#endif
+    s->running = 0;
+    janet_gcunroot(janet_wrap_abstract(s));
+}
+
+// Stop the samplers whose thread uses 'p': a sampler, its filter, transaction, or channel handle
+void ft_sampler_release(const void *p) {
+    sampler_t *s = samplers;
+    while (s != NULL) {
+        sampler_t *next = s->next;
+        if ((const void *)s == p || (const void *)s->fu == p || (const void *)s->t == p
+            || (const void *)s->t->handle == p)
+            sampler_stop(s);
+        s = next;
+    }
+}
+
+JANET_FN(cfun_ft_sampler,
+    "(ft/sampler transaction period &opt capacity fusion)",
+    "Start a thread that runs a compiled read `transaction` (`i2c/transaction`, `spi/transaction`) "
+    "every `period` seconds, on absolute deadlines from a monotonic clock. Each result is timestamped, "
+    "and pushed into a ring of `capacity` samples (default 1024) that is drained with `ft/sampler-drain`.\n\n"
+    "Given an `<ft/fusion>` filter, the thread also updates it with each sample, whose reply must start "
+    "with a frame of the filter's layout.\n\n"
+    "When the ring is full, runs are skipped and counted as overflows, unless they update a filter. "
+    "When the thread falls more than a period behind, the deadlines it passed are counted as missed; "
+    "see `ft/sampler-stats`.\n\n"
+    "Returns an `<ft/sampler>`, or `nil` if the thread could not be started.\n\n"
+    "Note: the transaction's channel must not be used, or closed, until `ft/sampler-stop`. "
+    "A running sampler is not garbage collected.") {
+    janet_arity(argc, 2, 4);
+
+    transaction_t *t = (transaction_t *)janet_getabstract(argv, 0, &transaction_type);
+    double period = janet_getnumber(argv, 1);
+    if (!(period > 0.0))
+        janet_panicf("period %v is invalid, expected a positive number of seconds", argv[1]);
+    int32_t capacity = janet_optinteger(argv, argc, 2, SAMPLER_CAPACITY);
+    if (capacity < 1)
+        janet_panicf("capacity %d is invalid, expected at least 1", capacity);
+    fusion_t *fu = NULL;
+    if (argc > 3 && !janet_checktype(argv[3], JANET_NIL)) {
+        fu = (fusion_t *)janet_getabstract(argv, 3, &fusion_type);
+        if ((uint32_t)fu->f->words * 2 > t->size)
+            janet_panicf("transaction reads %d bytes, less than a %d byte frame", t->size, fu->f->words * 2);
+    }
+
+    sampler_t *s = janet_abstract(&sampler_type, sizeof(sampler_t));
+    memset(s, 0, sizeof(sampler_t));
+    s->transaction = argv[0];
+    s->t = t;
+    s->fusion = fu ? argv[3] : janet_wrap_nil();
+    s->fu = fu;
+    s->period = (int64_t)(period * 1e9);
+    s->capacity = capacity;
+    s->slot_size = (sizeof(int64_t) + t->size + 7) & ~7u;
+    s->ring = janet_malloc((size_t)(s->capacity + 1) * s->slot_size);  // and a spare slot
+    if (NULL == s->ring)
+        janet_panic("out of memory");
+
+#ifdef _WIN32
+    s->thread = CreateThread(NULL, 0, sampler_thread, s, 0, NULL);
+    if (NULL == s->thread)
+        return janet_wrap_nil();
+#else
+    if (pthread_create(&s->thread, NULL, sampler_thread, s) != 0)
+        return janet_wrap_nil();
+#endif
+    s->running = 1;
+    s->next = samplers;
+    samplers = s;
+    janet_gcroot(janet_wrap_abstract(s));
+    return janet_wrap_abstract(s);
+}
+
+JANET_FN(cfun_ft_sampler_drain,
+    "(ft/sampler-drain sampler &opt times data)",
+    "Take every sample in the ring. Timestamps in seconds, from the same monotonic clock as "
+    "the deadlines, are pushed to the array `times`, and each sample's bytes are pushed to the buffer `data`.\n\n"
+    "Returns a tuple of `[times data]`, new ones if omitted.") {
+    janet_arity(argc, 1, 3);
+
+    sampler_t *s = (sampler_t *)janet_getabstract(argv, 0, &sampler_type);
+    JanetArray *times = (argc > 1 && !janet_checktype(argv[1], JANET_NIL))
+                        ? janet_getarray(argv, 1) : janet_array(0);
+    JanetBuffer *data = (argc > 2 && !janet_checktype(argv[2], JANET_NIL))
+                        ? janet_getbuffer(argv, 2) : janet_buffer(0);
+
+    transaction_t *t = s->t;
+    uint32_t tail = s->tail;
+    uint32_t head = ATOMIC_LOAD(&s->head);
+    janet_array_ensure(times, times->count + (int32_t)(head - tail), 2);
+    janet_buffer_ensure(data, data->count + (int32_t)((head - tail) * t->size), 2);
+
+    for (; tail != head; tail++) {
+        uint8_t *slot = s->ring + (size_t)(tail % s->capacity) * s->slot_size;
+        int64_t ns;
+        memcpy(&ns, slot, sizeof(int64_t));
+        times->data[times->count++] = janet_wrap_number((double)ns / 1e9);
+        janet_buffer_push_bytes(data, slot + sizeof(int64_t), t->size);
+    }
+    ATOMIC_STORE(&s->tail, tail);
+
+    Janet out[2] = {janet_wrap_array(times), janet_wrap_buffer(data)};
+    return janet_wrap_tuple(janet_tuple_n(out, 2));
+}
+
+JANET_FN(cfun_ft_sampler_stats,
+    "(ft/sampler-stats sampler)",
+    "Return a struct of the sampler's counters:\n"
+    "* `:running`    - true until `ft/sampler-stop`\n"
+    "* `:period`     - seconds between deadlines\n"
+    "* `:runs`       - transactions run\n"
+    "* `:pending`    - samples in the ring, not yet drained\n"
+    "* `:missed`     - deadlines passed while behind, with no run\n"
+    "* `:overflows`  - runs skipped because the ring was full\n"
+    "* `:errors`     - failed runs, which push no sample\n"
+    "* `:err`        - status of the last run, as `i2c/err`\n"
+    "* `:jitter-max` - most seconds a run started after its deadline, up to about 4.29\n"
+    "* `:jitter-avg` - moving average of the same") {
+    janet_fixarity(argc, 1);
+
+    sampler_t *s = (sampler_t *)janet_getabstract(argv, 0, &sampler_type);
+    JanetKV *st = janet_struct_begin(10);
+    janet_struct_put(st, janet_ckeywordv("running"), janet_wrap_boolean(s->running));
+    janet_struct_put(st, janet_ckeywordv("period"), janet_wrap_number((double)s->period / 1e9));
+    janet_struct_put(st, janet_ckeywordv("runs"), janet_wrap_number(ATOMIC_LOAD(&s->runs)));
+    janet_struct_put(st, janet_ckeywordv("pending"), janet_wrap_number(ATOMIC_LOAD(&s->head) - s->tail));
+    janet_struct_put(st, janet_ckeywordv("missed"), janet_wrap_number(ATOMIC_LOAD(&s->missed)));
+    janet_struct_put(st, janet_ckeywordv("overflows"), janet_wrap_number(ATOMIC_LOAD(&s->overflows)));
+    janet_struct_put(st, janet_ckeywordv("errors"), janet_wrap_number(ATOMIC_LOAD(&s->errors)));
+    janet_struct_put(st, janet_ckeywordv("err"), ft_status_keyword(ATOMIC_LOAD(&s->last_status)));
+    janet_struct_put(st, janet_ckeywordv("jitter-max"), janet_wrap_number(ATOMIC_LOAD(&s->jitter_max) / 1e9));
+    janet_struct_put(st, janet_ckeywordv("jitter-avg"), janet_wrap_number(ATOMIC_LOAD(&s->jitter_avg) / 1e9));
+    return janet_wrap_struct(janet_struct_end(st));
+}
+
+JANET_FN(cfun_ft_sampler_stop,
+    "(ft/sampler-stop sampler)",
+    "Stop the sampler thread, waiting for a run in progress to finish. Samples left in the ring "
+    "can still be drained.\n\n"
+    "Returns `nil`.") {
+    janet_fixarity(argc, 1);
+
+    sampler_t *s = (sampler_t *)janet_getabstract(argv, 0, &sampler_type);
+    sampler_stop(s);
+    return janet_wrap_nil();
+}
+
+static JanetMethod sampler_methods[] = {
+    {"drain",   cfun_ft_sampler_drain},
+    {"stats",   cfun_ft_sampler_stats},
+    {"stop",    cfun_ft_sampler_stop},
+    {NULL,      NULL}
+};
+
+static int sampler_get(void *p, Janet key, Janet *out) {
+    (void) p;
+    if (!janet_checktype(key, JANET_KEYWORD))
+        janet_panicf("expected keyword, but got %t", key);
+    return janet_getmethod(janet_unwrap_keyword(key), sampler_methods, out);
+}
+
+static int sampler_gcmark(void *p, size_t s) {
+    (void) s;
+    janet_mark(((sampler_t *)p)->transaction);
+    janet_mark(((sampler_t *)p)->fusion);
+    return 0;
+}
+
+// a running sampler is rooted, so it's only running here when the VM exits
+static int sampler_gc(void *p, size_t s) {
+    (void) s;
+    sampler_t *sm = (sampler_t *)p;
+    sampler_stop(sm);
+    janet_free(sm->ring);
+    sm->ring = NULL;
+    return 0;
+}
+
+/* libMPSSE reports a read that ran out of time as a short read (FT_IO_ERROR). A short read is
+    reported as FT_TIMEOUT only when its transfer, which began at 'start', ran for the whole
+    read timeout of 'ms' less a margin of 1/16 for timer granularity. Anything quicker is a
+    real short read and stays FT_IO_ERROR. */
+#define DEADLINE_MARGIN(ms) ((int64_t)(ms) * 1000000 / 16)
+
+FT_STATUS ft_deadline_status(FT_STATUS status, int64_t start, uint32_t ms) {
+    if (status == FT_IO_ERROR && ms > 0
+        && ft_monotonic_ns() - start >= (int64_t)ms * 1000000 - DEADLINE_MARGIN(ms))
+        return FT_TIMEOUT;
+    return status;
+}
+
+/* ft_parallel runs fn over an array of jobs on a small pool of worker threads, and
+    returns once every job is done. Workers take the next job from a shared counter,
+    so a slow device doesn't hold up the jobs queued behind it. */
+typedef struct {
+    ft_job_fn       fn;
+    uint8_t         *jobs;
+    size_t          size;
+    uint32_t        count;
+    uint32_t        next;
+} parallel_t;
+
+static THREAD_RETURN parallel_worker(void *p) {
+    parallel_t *pl = (parallel_t *)p;
+    uint32_t i;
+    while ((i = ATOMIC_FETCH_ADD(&pl->next, 1)) < pl->count)
+        pl->fn(pl->jobs + (size_t)i * pl->size);
+    return 0;
+}
+
+void ft_parallel(ft_job_fn fn, void *jobs, size_t size, int32_t count) {
+    if (count < 1)
+        return;
+    parallel_t pl = { fn, (uint8_t *)jobs, size, (uint32_t)count, 0 };
+
+    // the calling thread is one of the workers, so it's fine if none can be started
+    int32_t n = count < PARALLEL_WORKERS ? count - 1 : PARALLEL_WORKERS - 1;
+#ifdef _WIN32
+    HANDLE threads[PARALLEL_WORKERS];
+#else
+    pthread_t threads[PARALLEL_WORKERS];
+#endif
+    int32_t started = 0;
+    for (; started < n; started++) {
+#ifdef _WIN32
+        threads[started] = CreateThread(NULL, 0, parallel_worker, &pl, 0, NULL);
+        if (NULL == threads[started])
+            break;
+#else
+        if (pthread_create(&threads[started], NULL, parallel_worker, &pl) != 0)
+            break;
+#endif
+    }
+
+    parallel_worker(&pl);
+
+    for (int32_t i = 0; i < started; i++) {
+#ifdef _WIN32
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], NULL);
+#endif
+    }
+}
+
+#ifdef JANET_EV
+/* ft/await sends a transaction and suspends the fiber until its reply is queued, so one
+    Janet thread can keep many adapters busy. Every device awaited on signals one shared
+    D2XX event on RX. A watcher thread waits on it (or for the nearest deadline), and
+    posts a wakeup to the event loop, which reads the replies that are complete and
+    resumes their fibers. Waiters are only touched on the Janet thread.
+
+    A channel has one transaction in flight at a time; the others wait their turn by
+    priority class, then in order. A list of transactions (e.g. the chunks of a bulk
+    read) goes back in the queue after each one, so higher classes go in between. */
+typedef struct {
+    JanetFiber      *fiber;         // NULL once resumed
+    uint32_t        sched_id;       // the fiber's, when it was suspended
+    Janet           transactions;   // an <ft/transaction>, or a tuple of them run in turn
+    int32_t         count;
+    int32_t         next;           // index of the one in flight, or to send next
+    int32_t         priority;       // class, 0 is highest
+    FT_HANDLE       *handle;        // of the channel they all run on
+    transaction_t   *t;             // in flight, or NULL while queued for the channel
+    uint32_t        expect;         // bytes of the reply
+    int64_t         timeout;        // ns each transaction may take
+    int64_t         queued;         // ns, when it was queued for the channel
+    int64_t         deadline;       // ns, of the transaction in flight
+    JanetBuffer     *out;
+} await_t;
+
+// Queueing delay per priority class on one channel, for ft/await-stats
+typedef struct {
+    FT_HANDLE       *handle;
+    uint32_t        sent[AWAIT_CLASSES];
+    int64_t         delay_total[AWAIT_CLASSES]; // ns from queued to sent
+    int64_t         delay_max[AWAIT_CLASSES];
+} lane_t;
+
+typedef struct {
+    JanetVM         *vm;
+    await_t         *waiters;
+    int32_t         count;
+    int32_t         capacity;
+    lane_t          *lanes;
+    int32_t         lane_count;
+    int32_t         lane_capacity;
+    // under lock, shared with the watcher
+    uint32_t        active;         // the watcher should keep running
+    uint32_t        running;
+    uint32_t        posted;         // a wakeup is queued on the event loop
+    int64_t         deadline;       // nearest of the waiters
+#ifdef _WIN32
+    HANDLE          event;
+    CRITICAL_SECTION lock;
+#else
+    EVENT_HANDLE    event;
+    pthread_mutex_t lock;
+#endif
+} notifier_t;
+
+// one per Janet thread, for as long as it runs
+static JANET_THREAD_LOCAL notifier_t *notifier = NULL;
+
+static void notifier_lock(notifier_t *n) {
+#ifdef _WIN32
+    EnterCriticalSection(&n->lock);
+#else
+    pthread_mutex_lock(&n->lock);
+#endif
+}
+
+static void notifier_unlock(notifier_t *n) {
+#ifdef _WIN32
+    LeaveCriticalSection(&n->lock);
+#else
+    pthread_mutex_unlock(&n->lock);
+#endif
+}
+
+// wake the watcher, as the device would
+static void notifier_signal(notifier_t *n) {
+#ifdef _WIN32
+    SetEvent(n->event);
+#else
+    pthread_mutex_lock(&n->event.eMutex);
+    pthread_cond_signal(&n->event.eCondVar);
+    pthread_mutex_unlock(&n->event.eMutex);
+#endif
+}
+
+static void notifier_service(JanetEVGenericMessage msg);
+
+/* The watcher holds the event's mutex except while waiting, so the driver can't signal
+    it in between and go unnoticed. */
+static THREAD_RETURN notifier_watcher(void *p) {
+    notifier_t *n = (notifier_t *)p;
+#ifndef _WIN32
+    pthread_mutex_lock(&n->event.eMutex);
+#endif
+    for (;;) {
+        notifier_lock(n);
+        if (!n->active) {
+            n->running = 0;
+            notifier_unlock(n);
+            break;
+        }
+        int64_t wait = n->deadline - ft_monotonic_ns();
+        if (n->posted && wait < AWAIT_TICK)
+            wait = AWAIT_TICK;
+        if (wait > AWAIT_MAX_WAIT)
+            wait = AWAIT_MAX_WAIT;
+        notifier_unlock(n);
+
+        if (wait > 0) {
+#ifdef _WIN32
+            WaitForSingleObject(n->event, (DWORD)((wait + 999999) / 1000000));
+#else
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            int64_t at = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec + wait;
+            ts.tv_sec = at / 1000000000;
+            ts.tv_nsec = at % 1000000000;
+            pthread_cond_timedwait(&n->event.eCondVar, &n->event.eMutex, &ts);
+#endif
+        }
+
+        // posted under the lock, so none is posted once the event loop has stopped the watcher
+        notifier_lock(n);
+        if (n->active && !n->posted) {
+            JanetEVGenericMessage msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.argp = n;
+            n->posted = 1;
+            janet_ev_post_event(n->vm, notifier_service, msg);
+        }
+        notifier_unlock(n);
+    }
+#ifndef _WIN32
+    pthread_mutex_unlock(&n->event.eMutex);
+#endif
+    return 0;
+}
+
+static notifier_t *notifier_get(void) {
+    if (notifier != NULL)
+        return notifier;
+    notifier_t *n = janet_malloc(sizeof(notifier_t));
+    if (NULL == n)
+        janet_panic("out of memory");
+    memset(n, 0, sizeof(notifier_t));
+    n->vm = janet_local_vm();
+#ifdef _WIN32
+    n->event = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (NULL == n->event) {
+        janet_free(n);
+        janet_panic("could not create event");
+    }
+    InitializeCriticalSection(&n->lock);
+#else
+    pthread_mutex_init(&n->event.eMutex, NULL);
+    pthread_cond_init(&n->event.eCondVar, NULL);
+    pthread_mutex_init(&n->lock, NULL);
+#endif
+    notifier = n;
+    return n;
+}
+
+// start the watcher if it's stopped, else wake it for a new waiter
+static int notifier_start(notifier_t *n) {
+    int started = 1;
+    notifier_lock(n);
+    n->active = 1;
+    if (!n->running) {
+#ifdef _WIN32
+        HANDLE thread = CreateThread(NULL, 0, notifier_watcher, n, 0, NULL);
+        if (NULL == thread)
+            started = 0;
+        else
+            CloseHandle(thread);
+#else
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, notifier_watcher, n) != 0)
+            started = 0;
+        else
+            pthread_detach(thread);
+#endif
+        n->running = started;
+    }
+    notifier_unlock(n);
+    return started;
+}
+
+static const char *await_priorities[AWAIT_CLASSES] = {"high", "normal", "bulk"};
+
+#ifdef _WIN32
+#define NOTIFIER_EVENT(n)       ((n)->event)
+#else
+#define NOTIFIER_EVENT(n)       (&(n)->event)
+#endif
+
+static lane_t *notifier_lane(notifier_t *n, FT_HANDLE *handle) {
+    for (int32_t i = 0; i < n->lane_count; i++) {
+        if (n->lanes[i].handle == handle)
+            return &n->lanes[i];
+    }
+    return NULL;
+}
+
+static transaction_t *await_item(await_t *w, int32_t i) {
+    if (janet_checktype(w->transactions, JANET_ABSTRACT))
+        return (transaction_t *)janet_unwrap_abstract(w->transactions);
+    return (transaction_t *)janet_unwrap_abstract(janet_unwrap_tuple(w->transactions)[i]);
+}
+
+// resume a waiter's fiber with the reply, or raise the status
+static void await_resume(await_t *w, FT_STATUS status, Janet value) {
+    if (w->fiber->sched_id == w->sched_id) {
+        if (status == FT_OK)
+            janet_schedule(w->fiber, value);
+        else
+            janet_schedule_signal(w->fiber, ft_status_keyword(status), JANET_SIGNAL_ERROR);
+    }
+    janet_gcunroot(janet_wrap_fiber(w->fiber));
+    janet_gcunroot(w->transactions);
+    janet_gcunroot(janet_wrap_buffer(w->out));
+    janet_ev_dec_refcount();
+    w->fiber = NULL;
+}
+
+// send the waiter's next transaction on its idle channel
+static FT_STATUS await_send(notifier_t *n, await_t *w, int64_t now) {
+    transaction_t *t = await_item(w, w->next);
+    if (NULL == *t->handle)
+        return FT_DEVICE_NOT_OPENED;
+    FT_STATUS status = Mid_SetEventNotification(*t->handle, FT_EVENT_RXCHAR, NOTIFIER_EVENT(n));
+    if (status == FT_OK)
+        status = t->send(t, &w->expect);
+    if (status != FT_OK)
+        return status;
+
+    lane_t *lane = notifier_lane(n, w->handle);
+    int64_t delay = now - w->queued;
+    lane->sent[w->priority]++;
+    lane->delay_total[w->priority] += delay;
+    if (delay > lane->delay_max[w->priority])
+        lane->delay_max[w->priority] = delay;
+    w->t = t;
+    w->deadline = now + w->timeout;
+    return FT_OK;
+}
+
+// is 'a' ahead of 'b' in the queue for a channel
+static int await_before(const await_t *a, const await_t *b) {
+    if (a->priority != b->priority)
+        return a->priority < b->priority;
+    return a->queued < b->queued;
+}
+
+/* Give each idle channel to its best queued waiter. Waiters whose fibers were canceled
+    while queued are dropped. */
+static void notifier_dispatch(notifier_t *n, int64_t now) {
+    int progress = 1;
+    while (progress) {
+        progress = 0;
+        for (int32_t i = 0; i < n->count; i++) {
+            await_t *w = &n->waiters[i];
+            if (NULL == w->fiber || w->t != NULL)
+                continue;
+            if (w->fiber->sched_id != w->sched_id) {
+                await_resume(w, FT_OK, janet_wrap_nil());
+                continue;
+            }
+            await_t *best = w;
+            int busy = 0;
+            for (int32_t j = 0; j < n->count && !busy; j++) {
+                await_t *o = &n->waiters[j];
+                if (NULL == o->fiber || o->handle != w->handle)
+                    continue;
+                if (o->t != NULL)
+                    busy = 1;
+                else if (o->fiber->sched_id == o->sched_id && await_before(o, best))
+                    best = o;
+            }
+            if (busy)
+                continue;
+            FT_STATUS status = await_send(n, best, now);
+            if (status != FT_OK)
+                await_resume(best, status, janet_wrap_nil());
+            progress = 1;
+        }
+    }
+}
+
+// drop resumed waiters, and hand the nearest deadline to the watcher, or stop it
+static void notifier_update(notifier_t *n) {
+    int64_t deadline = INT64_MAX;
+    int32_t kept = 0;
+    for (int32_t i = 0; i < n->count; i++) {
+        await_t *w = &n->waiters[i];
+        if (NULL == w->fiber)
+            continue;
+        if (w->t != NULL && w->deadline < deadline)
+            deadline = w->deadline;
+        n->waiters[kept++] = *w;
+    }
+    n->count = kept;
+
+    notifier_lock(n);
+    n->deadline = deadline;
+    n->active = kept > 0;
+    notifier_unlock(n);
+    if (0 == kept)
+        notifier_signal(n);
+}
+
+// on the event loop: read the replies that are queued, time out the rest, and send what's next
+static void notifier_service(JanetEVGenericMessage msg) {
+    notifier_t *n = (notifier_t *)msg.argp;
+    notifier_lock(n);
+    n->posted = 0;
+    notifier_unlock(n);
+
+    int64_t now = ft_monotonic_ns();
+    for (int32_t i = 0; i < n->count; i++) {
+        await_t *w = &n->waiters[i];
+        transaction_t *t = w->t;
+        if (NULL == w->fiber || NULL == t)
+            continue;
+        FT_STATUS status = FT_OK;
+        DWORD queued = 0;
+
+        if (NULL == *t->handle)
+            status = FT_DEVICE_NOT_OPENED;
+        else if (w->fiber->sched_id != w->sched_id)
+            status = FT_TIMEOUT;    // canceled; its reply is purged below
+        else
+            status = Mid_GetQueueStatus(*t->handle, &queued);
+
+        if (status == FT_OK && queued >= w->expect) {
+            janet_buffer_extra(w->out, t->size);
+            status = t->receive(t, w->out->data + w->out->count);
+            if (status == FT_OK) {
+                w->out->count += t->size;
+                w->t = NULL;
+                if (++w->next == w->count)
+                    await_resume(w, FT_OK, janet_wrap_buffer(w->out));
+                else
+                    w->queued = now;    // back in the queue for the next one
+            } else {
+                await_resume(w, status, janet_wrap_nil());
+            }
+            continue;
+        }
+        if (status == FT_OK && now >= w->deadline)
+            status = FT_TIMEOUT;
+        if (status != FT_OK) {
+            // a late reply would be read by the next transaction
+            if (*t->handle != NULL)
+                Mid_PurgeDevice(*t->handle);
+            await_resume(w, status, janet_wrap_nil());
+        }
+    }
+
+    notifier_dispatch(n, now);
+    notifier_update(n);
+}
+
+static int32_t await_priority(const Janet *argv, int32_t argc, int32_t n) {
+    if (n >= argc || janet_checktype(argv[n], JANET_NIL))
+        return 1;
+    JanetKeyword kw = janet_getkeyword(argv, n);
+    for (int32_t i = 0; i < AWAIT_CLASSES; i++) {
+        if (strcmp((const char *)kw, await_priorities[i]) == 0)
+            return i;
+    }
+    janet_panicf("invalid priority %v, expected :high, :normal or :bulk", argv[n]);
+}
+
+JANET_FN(cfun_ft_await,
+    "(ft/await transactions &opt timeout priority)",
+    "Run a compiled read transaction (`i2c/transaction`, `spi/transaction`), or an indexed of them "
+    "in turn, suspending the calling fiber rather than the thread while the device replies, so one "
+    "thread can wait on many adapters at once. Each reply is read when the device signals it is all "
+    "queued, or the fiber resumes with an error after `timeout` seconds (default 5).\n\n"
+    "Fibers awaiting the same channel take turns: one transaction is in flight at a time, and the "
+    "next is the oldest of the highest `priority` waiting, one of `:high`, `:normal` (the default) "
+    "or `:bulk`. A list of transactions waits its turn again after each one, so a bulk transfer split "
+    "into chunks, e.g. by `spi/transaction-chunks`, lets higher priority transactions in between. "
+    "See `ft/await-stats`.\n\n"
+    "Returns a buffer of the bytes read, one reply after another. Raises the status keyword, "
+    "e.g. `:timeout`, on error.\n\n"
+    "Note: all the transactions must be on one channel, and calls that don't go through `ft/await` "
+    "must not be made on it until they complete.") {
+    janet_arity(argc, 1, 3);
+    double timeout = janet_optnumber(argv, argc, 1, AWAIT_TIMEOUT);
+    if (timeout < 0)
+        janet_panic("timeout must not be negative");
+    int32_t priority = await_priority(argv, argc, 2);
+
+    // a list is copied to a tuple, so it can't change while it runs
+    Janet transactions = argv[0];
+    transaction_t *first = NULL;
+    int32_t count = 1;
+    if (janet_checktype(argv[0], JANET_ABSTRACT)) {
+        first = (transaction_t *)janet_getabstract(argv, 0, &transaction_type);
+    } else {
+        JanetView items = janet_getindexed(argv, 0);
+        if (items.len < 1)
+            janet_panic("expected at least one transaction");
+        for (int32_t i = 0; i < items.len; i++) {
+            transaction_t *t = (transaction_t *)janet_getabstract(items.items, i, &transaction_type);
+            if (NULL == first)
+                first = t;
+            else if (t->handle != first->handle)
+                janet_panic("transactions must all be on one channel");
+        }
+        transactions = janet_wrap_tuple(janet_tuple_n(items.items, items.len));
+        count = items.len;
+    }
+    if (NULL == *first->handle)
+        janet_panicv(ft_status_keyword(FT_DEVICE_NOT_OPENED));
+
+    notifier_t *n = notifier_get();
+    if (NULL == notifier_lane(n, first->handle)) {
+        if (n->lane_count == n->lane_capacity) {
+            int32_t capacity = n->lane_capacity ? n->lane_capacity * 2 : 4;
+            lane_t *lanes = janet_realloc(n->lanes, capacity * sizeof(lane_t));
+            if (NULL == lanes)
+                janet_panic("out of memory");
+            n->lanes = lanes;
+            n->lane_capacity = capacity;
+        }
+        lane_t *lane = &n->lanes[n->lane_count++];
+        memset(lane, 0, sizeof(lane_t));
+        lane->handle = first->handle;
+    }
+    if (n->count == n->capacity) {
+        int32_t capacity = n->capacity ? n->capacity * 2 : 8;
+        await_t *waiters = janet_realloc(n->waiters, capacity * sizeof(await_t));
+        if (NULL == waiters)
+            janet_panic("out of memory");
+        n->waiters = waiters;
+        n->capacity = capacity;
+    }
+    if (!notifier_start(n))
+        janet_panic("could not start the notifier thread");
+
+    JanetFiber *fiber = janet_root_fiber();
+    await_t *w = &n->waiters[n->count++];
+    memset(w, 0, sizeof(await_t));
+    w->fiber = fiber;
+    w->sched_id = fiber->sched_id;
+    w->transactions = transactions;
+    w->count = count;
+    w->priority = priority;
+    w->handle = first->handle;
+    w->timeout = (int64_t)(timeout * 1e9);
+    w->queued = ft_monotonic_ns();
+    w->out = janet_buffer(first->size * count);
+    janet_gcroot(janet_wrap_fiber(fiber));
+    janet_gcroot(transactions);
+    janet_gcroot(janet_wrap_buffer(w->out));
+    janet_ev_inc_refcount();
+
+    notifier_dispatch(n, w->queued);
+    notifier_update(n);
+    notifier_signal(n);     // for the watcher to take up a nearer deadline
+    janet_await();
+}
+
+JANET_FN(cfun_ft_await_stats,
+    "(ft/await-stats transaction)",
+    "Return the queueing of `ft/await` on the channel `transaction` runs on, as a struct of each "
+    "priority (`:high`, `:normal`, `:bulk`) to a struct of:\n"
+    "* `:sent`       - transactions sent\n"
+    "* `:delay-avg`  - average seconds from queued to sent\n"
+    "* `:delay-max`  - most seconds from queued to sent\n"
+    "* `:waiting`    - fibers queued now") {
+    janet_fixarity(argc, 1);
+    transaction_t *t = (transaction_t *)janet_getabstract(argv, 0, &transaction_type);
+
+    lane_t none;
+    memset(&none, 0, sizeof(lane_t));
+    lane_t *lane = &none;
+    int32_t waiting[AWAIT_CLASSES] = {0};
+    if (notifier != NULL) {
+        lane_t *found = notifier_lane(notifier, t->handle);
+        if (found != NULL)
+            lane = found;
+        for (int32_t i = 0; i < notifier->count; i++) {
+            await_t *w = &notifier->waiters[i];
+            if (w->fiber != NULL && w->handle == t->handle && NULL == w->t)
+                waiting[w->priority]++;
+        }
+    }
+
+    JanetKV *st = janet_struct_begin(AWAIT_CLASSES);
+    for (int32_t i = 0; i < AWAIT_CLASSES; i++) {
+        double avg = lane->sent[i] ? (double)lane->delay_total[i] / lane->sent[i] / 1e9 : 0.0;
+        JanetKV *cls = janet_struct_begin(4);
+        janet_struct_put(cls, janet_ckeywordv("sent"), janet_wrap_number(lane->sent[i]));
+        janet_struct_put(cls, janet_ckeywordv("delay-avg"), janet_wrap_number(avg));
+        janet_struct_put(cls, janet_ckeywordv("delay-max"), janet_wrap_number((double)lane->delay_max[i] / 1e9));
+        janet_struct_put(cls, janet_ckeywordv("waiting"), janet_wrap_integer(waiting[i]));
+        janet_struct_put(st, janet_ckeywordv(await_priorities[i]), janet_wrap_struct(janet_struct_end(cls)));
+    }
+    return janet_wrap_struct(janet_struct_end(st));
+}
+#endif
+
+void ft_register(JanetTable *env) {
+    JanetRegExt cfuns[] = {
+        JANET_REG("ft/unpack-i16be",    cfun_ft_unpack_i16be),
+        JANET_REG("ft/frame",           cfun_ft_frame),
+        JANET_REG("ft/frame-decode",    cfun_ft_frame_decode),
+        JANET_REG("ft/frame-size",      cfun_ft_frame_size),
+        JANET_REG("ft/fusion",          cfun_ft_fusion),
+        JANET_REG("ft/fusion-update",   cfun_ft_fusion_update),
+        JANET_REG("ft/fusion-attitude", cfun_ft_fusion_attitude),
+        JANET_REG("ft/fusion-euler",    cfun_ft_fusion_euler),
+        JANET_REG("ft/fusion-drain",    cfun_ft_fusion_drain),
+        JANET_REG("ft/fusion-reset",    cfun_ft_fusion_reset),
+        JANET_REG("ft/sampler",         cfun_ft_sampler),
+        JANET_REG("ft/sampler-drain",   cfun_ft_sampler_drain),
+        JANET_REG("ft/sampler-stats",   cfun_ft_sampler_stats),
+        JANET_REG("ft/sampler-stop",    cfun_ft_sampler_stop),
+#ifdef JANET_EV
+        JANET_REG("ft/await",           cfun_ft_await),
+        JANET_REG("ft/await-stats",     cfun_ft_await_stats),
+#endif
+        JANET_REG_END
+    };
+    janet_cfuns_ext(env, "ft", cfuns);
+}
@@ -1,29 +1,24 @@
 // libMPSSE-I2C functions as documented in Application Note AN_177, Version 1.5
 
-#include "module.h"
-#include "../LibMPSSE_1.0.7/release/include/libmpsse_i2c.h"
+#include "i2c.h"
+#include "../LibMPSSE_1.0.7/release/source/ftdi_mid.h"
 
-typedef struct {
-    uint32_t        index;          // 1-based, as user-entered
-    uint32_t        id;             // unique id per-channel set by libmpsse
-    FT_HANDLE       handle;
-    ChannelConfig   config;
-    uint32_t        read_options;   // these are use per-read/write
-    uint32_t        write_options;  //
-} channel_t;
+#define I2C_RETRIES 2   // default retries of a read after the channel resyncs
 
 static int  channel_get(void *p, Janet key, Janet *out);
 static int  channel_gc(void *p, size_t s);
+static void channel_marshal(void *p, JanetMarshalContext *ctx);
+static void *channel_unmarshal(JanetMarshalContext *ctx);
 static void channel_string(void *p, JanetBuffer *buffer);
 
-static const JanetAbstractType channel_type = {
+const JanetAbstractType i2c_channel_type = {
     "i2c/channel",
     channel_gc,             // gc
     NULL,                   // gcmark
     channel_get,            // get
     NULL,                   // put
-    NULL,                   // marshal
-    NULL,                   // unmarshal
+    channel_marshal,        // marshal
+    channel_unmarshal,      // unmarshal
     channel_string,         // to-string
     JANET_ATEND_TOSTRING
                             // compare
@@ -40,8 +35,58 @@ static const JanetAbstractType channel_type = {
 
 // Save the FT return status to dyn :i2c-err, and return the value directly.
 static Janet set_status_dyn(FT_STATUS status, Janet value) {
-    janet_setdyn("ft-err", janet_ckeywordv(ft_status_string[status]));
-    return value;
+    return ft_status(ERR_MODE_DYN, status, value);
+}
+
+// Report the status as set by the channel's err-mode
+static Janet channel_status(channel_t *c, FT_STATUS status, Janet value) {
+    return ft_status(c->err_mode, status, value);
+}
+
+/* Set the driver's read & write timeouts for a call with a deadline of 'ms', or the
+    channel's deadline if 0. They are only set when they change, and stay for the next call.
+    Returns the deadline in effect. */
+uint32_t i2c_channel_deadline(channel_t *c, uint32_t ms) {
+    if (ms == 0)
+        ms = c->timeout ? c->timeout : DEVICE_READ_TIMEOUT;
+    if (ms != c->timeout_set) {
+        c->timeout_set = 0;
+        if (Mid_SetDeviceTimeOut(c->handle, ms, ms) == FT_OK)
+            c->timeout_set = ms;
+    }
+    return ms;
+}
+
+// Purge what a failed transfer left in the device buffers, before the next one
+void i2c_channel_prepare(channel_t *c) {
+    if (c->dirty) {
+        c->purges++;
+        if (Mid_PurgeDevice(c->handle) == FT_OK)
+            c->dirty = FALSE;
+    }
+}
+
+/* After a transfer: on a short read or timeout (FT_IO_ERROR, FT_TIMEOUT), purge and check the MPSSE
+    echoes a bad command in sync. Returns true if the transfer should be run again,
+    while 'tries' lasts. NAKs are the device's answer, and aren't retried. */
+BOOL i2c_channel_recover(channel_t *c, FT_STATUS status, uint32_t *tries) {
+    if (status != FT_IO_ERROR && status != FT_TIMEOUT)
+        return FALSE;
+    c->desyncs++;
+    c->purges++;
+    c->dirty = TRUE;
+    FT_STATUS sync = Mid_PurgeDevice(c->handle);
+    if (sync == FT_OK)
+        sync = Mid_SyncMPSSE(c->handle);
+    if (sync != FT_OK)
+        return FALSE;
+    c->resyncs++;
+    c->dirty = FALSE;
+    if (*tries == 0 || status == FT_TIMEOUT) // a retry would be past the deadline
+        return FALSE;
+    (*tries)--;
+    c->retried++;
+    return TRUE;
 }
 
 JANET_FN(cfun_i2c_get_err,
@@ -68,12 +113,30 @@ JANET_FN(cfun_i2c_get_err,
     "* `:invalid-args`\n" // 16
     "* `:not-supported`\n"
     "* `:other-error`\n"
-    "* `:device-list-not-ready`\n\n"
+    "* `:device-list-not-ready`\n"
+    "* `:timeout`   - a call ran past its deadline, see `i2c/timeout`\n\n"
     "Note: currently a wrapper for (dyn :ft-err)") {
     janet_arity(argc, 0, 1);
     return janet_dyn("ft-err");
 }
 
+JANET_FN(cfun_i2c_err_mode,
+    "(i2c/err-mode channel &opt mode)",
+    "Get or set how calls on `channel` report their status. `mode` is one of:\n"
+    "* `:dyn`   - set `(dyn :ft-err)` as returned by `i2c/err`, and return the value (default)\n"
+    "* `:raise` - raise the status keyword on error, and return the value\n"
+    "* `:tuple` - return a tuple of `[value status]`\n\n"
+    "In `:raise` and `:tuple` modes the dynamic binding is not touched, which is cheaper in tight loops. "
+    "Functions not taking a channel (`open`, `info`...) always use `:dyn`.\n\n"
+    "Returns the channel's mode.") {
+    janet_arity(argc, 1, 2);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
+    if (argc > 1)
+        c->err_mode = ft_err_mode_get(argv, 1);
+    return ft_err_mode_keyword(c->err_mode);
+}
+
 JANET_FN(cfun_i2c_channelcount,
     "(i2c/channels)",
     "Get the number of I2C channels that are connected to the host system. "
@@ -109,7 +172,7 @@ JANET_FN(cfun_i2c_getchannelinfo,
         if (index < 1)
             return set_status_dyn(FT_INVALID_HANDLE, janet_wrap_nil());
     } else if (janet_checktype(argv[0], JANET_ABSTRACT)) {
-        channel_t *p = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+        channel_t *p = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
         index = p->index;
     } else
         janet_panicf("invalid type, expected <i2c/channel> or index, got %t", argv[0]);
@@ -136,10 +199,54 @@ JANET_FN(cfun_i2c_get_id,
     "Takes an `<i2c/channel>` and returns the unique, per-channel ID assigned by libMPSSE on channel creation.") {
     janet_fixarity(argc, 1);
 
-    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
     return janet_wrap_integer(c->id);
 }
 
+// Open the channel at c->index, and save its libMPSSE id and where it is
+static FT_STATUS channel_open(channel_t *c) {
+    FT_STATUS status = I2C_OpenChannel((c->index - 1), &c->handle);
+    if (status != FT_OK) {
+        c->handle = NULL;
+        return status;
+    }
+
+    // D2XX USB latency config option; requires d2xx linked
+    // FT_SetLatencyTimer(c->handle, 2); // set USB latency from default of 16 ms to 2
+
+    FT_DEVICE_LIST_INFO_NODE chaninfo;
+    status = I2C_GetChannelInfo((c->index - 1), &chaninfo);
+    if (status != FT_OK) { // bailout if we fail here
+        I2C_CloseChannel(c->handle); // probably will also quietly fail but better to be sure
+        c->handle = NULL;
+        janet_panicf("failed to get channel info on a newly opened channel: %s", ft_status_string[status]);
+    }
+    c->id = chaninfo.ID;
+    c->timeout_set = 0;
+    c->locid = chaninfo.LocId;
+    memcpy(c->serial, chaninfo.SerialNumber, sizeof(c->serial));
+    c->serial[sizeof(c->serial) - 1] = 0;
+    return FT_OK;
+}
+
+static channel_t *channel_new(uint32_t index) {
+    channel_t *c = (channel_t *)janet_abstract(&i2c_channel_type, sizeof(channel_t));
+    memset(&c->config, 0x0, sizeof(ChannelConfig));
+    memset(&c->init_config, 0x0, sizeof(ChannelConfig));
+    c->index = index;
+    c->id = c->locid = 0;
+    c->serial[0] = 0;
+    c->handle = NULL;
+    c->err_mode = ERR_MODE_DYN;
+    c->initialized = FALSE;
+    c->read_options = c->write_options = 0;
+    c->timeout = c->timeout_set = 0;
+    c->retries = I2C_RETRIES;
+    c->dirty = FALSE;
+    c->desyncs = c->resyncs = c->purges = c->retried = 0;
+    return c;
+}
+
 JANET_FN(cfun_i2c_openchannel,
     "(i2c/open index)",
     "Open a channel by (1-based) `index`.\n\n"
@@ -150,26 +257,11 @@ JANET_FN(cfun_i2c_openchannel,
     if (index < 1)
         return set_status_dyn(FT_INVALID_HANDLE, janet_wrap_nil());
     
-    channel_t *c = (channel_t *)janet_abstract(&channel_type, sizeof(channel_t));
-    memset(&c->config, 0x0, sizeof(ChannelConfig));
-    c->index = index;
-
-    FT_STATUS status = I2C_OpenChannel((index - 1), &c->handle);
+    channel_t *c = channel_new(index);
+    FT_STATUS status = channel_open(c);
     if (status != FT_OK)
         return set_status_dyn(status, janet_wrap_nil());
 
-    // D2XX USB latency config option; requires d2xx linked
-    // FT_SetLatencyTimer(c->handle, 2); // set USB latency from default of 16 ms to 2
-
-    FT_DEVICE_LIST_INFO_NODE chaninfo;
-    status = I2C_GetChannelInfo((index - 1), &chaninfo);
-    if (status != FT_OK) { // bailout if we fail here
-        I2C_CloseChannel(c->handle); // probably will also quietly fail but better to be sure
-        c->handle = NULL;
-        janet_panicf("failed to get channel info on a newly opened channel: %s", ft_status_string[status]);
-    }
-    c->id = chaninfo.ID;
-
     return set_status_dyn(FT_OK, janet_wrap_abstract(c));
 }
 
@@ -278,7 +370,7 @@ JANET_FN(cfun_i2c_is_open,
 
     uint32_t index = 0;
     if (janet_checktype(argv[0], JANET_ABSTRACT)) {
-        channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+        channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
         if (NULL == c->handle)
             return janet_wrap_boolean(FALSE);
         index = c->index;
@@ -341,9 +433,9 @@ JANET_FN(cfun_i2c_set_write_options,
     "* `:no-address`\n\n") {
     janet_arity(argc, 1, 6);
 
-    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
     c->write_options = transfer_option_keywords(argc, argv, WRITE_TRANSFER_OPT);
-    return set_status_dyn(FT_OK, janet_wrap_nil());
+    return channel_status(c, FT_OK, janet_wrap_nil());
 }
 
 JANET_FN(cfun_i2c_set_read_options,
@@ -357,26 +449,18 @@ JANET_FN(cfun_i2c_set_read_options,
     "* `:no-address`\n\n") {
     janet_arity(argc, 1, 6);
 
-    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
     c->read_options = transfer_option_keywords(argc, argv, READ_TRANSFER_OPT);
-    return set_status_dyn(FT_OK, janet_wrap_nil());
+    return channel_status(c, FT_OK, janet_wrap_nil());
 }
 
 #define I2C_ENABLE_DRIVE_ONLY_ZERO 0x0002 // Documented in AN-177, but missing in libmpsse header?
 
-JANET_FN(cfun_i2c_set_config_options,
-    "(i2c/config channel &opt kw ...)",
-    "Set channel config options. Takes zero, or more keywords:\n\n"
-    "* `:disable-3phase-clocking`\n"
-    "* `:enable-drive-only-zero`\n\n"
-    "Note: 3-phase clocking only available on hi-speed devices, not the FT2232D. "
-    "Drive-only-zero is only available on the FT232H.") {
-    janet_arity(argc, 1, 3);
-
-    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
-
+/* Set config option bits from Janet keywords from slot 'start' on, as taken by i2c/config
+    and i2c/open-all */
+static uint32_t i2c_config_option_keywords(int32_t argc, Janet *argv, int32_t start) {
     uint32_t options = 0;
-    for (int i = 1; i < argc; i++) {
+    for (int i = start; i < argc; i++) {
         if (janet_checktype(argv[i], JANET_KEYWORD)) {
             JanetKeyword opt = janet_unwrap_keyword(argv[i]);
             if (strcmp(opt, "disable-3phase-clocking") == 0)
@@ -388,9 +472,55 @@ JANET_FN(cfun_i2c_set_config_options,
         } else
             janet_panicf("invalid I2C config option type, expected keyword but got %t in slot #%d", argv[i], i+1);
     }
-    c->config.Options = options;
+    return options;
+}
+
+/* Clock rate from a keyword or integer in slot n, as taken by i2c/init and i2c/open-all */
+static I2C_CLOCKRATE i2c_clock_arg(int32_t argc, Janet *argv, int32_t n) {
+    I2C_CLOCKRATE rate = I2C_CLOCK_STANDARD_MODE;
+    if (n >= argc || janet_checktype(argv[n], JANET_NIL))
+        return rate;
+    if (janet_checktype(argv[n], JANET_KEYWORD)) {
+        JanetKeyword clock = janet_getkeyword(argv, n);
+        if (strcmp(clock, "fast") == 0)
+            rate = I2C_CLOCK_FAST_MODE;
+        else if (strcmp(clock, "fast-plus") == 0)
+            rate = I2C_CLOCK_FAST_MODE_PLUS;
+        else if (strcmp(clock, "high-speed") == 0)
+            rate = I2C_CLOCK_HIGH_SPEED_MODE;
+    } else {
+        rate = janet_getuinteger(argv, n);
+        if (rate < 1 || rate > 3400000)
+            janet_panicf("clock rate %d is out of range. Expected 1 to 3,400,000", rate);
+    }
+    return rate;
+}
+
+// Initialize with the config set, keeping it for reopen. Safe to call off the Janet thread.
+static FT_STATUS channel_init(channel_t *c) {
+    c->config.Options |= I2C_DISABLE_TRANSFER_PURGE;
+    c->init_config = c->config;
+    FT_STATUS status = I2C_InitChannel(c->handle, &c->config);
+    c->initialized = (status == FT_OK);
+    c->dirty = FALSE;
+    c->timeout_set = (status == FT_OK) ? DEVICE_READ_TIMEOUT : 0; // as set by init
+    return status;
+}
+
+JANET_FN(cfun_i2c_set_config_options,
+    "(i2c/config channel &opt kw ...)",
+    "Set channel config options. Takes zero, or more keywords:\n\n"
+    "* `:disable-3phase-clocking`\n"
+    "* `:enable-drive-only-zero`\n\n"
+    "Note: 3-phase clocking only available on hi-speed devices, not the FT2232D. "
+    "Drive-only-zero is only available on the FT232H.") {
+    janet_arity(argc, 1, 3);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
 
-    return set_status_dyn(FT_OK, janet_wrap_nil());
+    c->config.Options = i2c_config_option_keywords(argc, argv, 1);
+
+    return channel_status(c, FT_OK, janet_wrap_nil());
 }
 
 JANET_FN(cfun_i2c_initchannel,
@@ -402,28 +532,14 @@ JANET_FN(cfun_i2c_initchannel,
     "* `:fast`       - 400kb/s\n"
     "* `:fast-plus`  - 1000kb/s\n"
     "* `:high-speed` - 3.4Mb/s\n"
-    "* or a non-standard clock rate integer from 0 to 3,400,000.\n\n"
+    "* or a non-standard clock rate integer from 1 to 3,400,000.\n\n"
     "Note: Recommended latency of Full-speed devices (FT2232D) is 2 to 255, "
     "and Hi-speed devices (FT232H, FT2232H, FT4232H) is 1 to 255. Default is 255.") {
     janet_arity(argc, 1, 3);
 
-    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
     
-    I2C_CLOCKRATE rate = I2C_CLOCK_STANDARD_MODE;
-    if (janet_checktype(argv[1], JANET_KEYWORD)) {
-        JanetKeyword clock = janet_optkeyword(argv, argc, 1, janet_cstring("standard"));
-        if (strcmp(clock, "fast") == 0)
-            rate = I2C_CLOCK_FAST_MODE;
-        else if (strcmp(clock, "fast-plus") == 0)
-            rate = I2C_CLOCK_FAST_MODE_PLUS;
-        else if (strcmp(clock, "high-speed") == 0)
-            rate = I2C_CLOCK_HIGH_SPEED_MODE;
-    } else if (janet_checktype(argv[1], JANET_NUMBER)) {
-        rate = janet_getuinteger(argv, 2);
-        if (rate > 3400000)
-            janet_panicf("clock rate %d is out of range. Expected 0 to 3,400,000");
-    }
-    c->config.ClockRate = rate;
+    c->config.ClockRate = i2c_clock_arg(argc, argv, 1);
 
     uint8_t latency = janet_optinteger(argv, argc, 2, 255);
     if (latency < 1 || latency > 255)
@@ -431,10 +547,240 @@ JANET_FN(cfun_i2c_initchannel,
     c->config.LatencyTimer = latency;
 
     if (NULL == c->handle)
-        return set_status_dyn(FT_DEVICE_NOT_OPENED, janet_wrap_boolean(FALSE));
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_boolean(FALSE));
 
-    FT_STATUS status = I2C_InitChannel(c->handle, &c->config);
-    return set_status_dyn(status, janet_wrap_boolean(status == FT_OK? TRUE : FALSE));
+    FT_STATUS status = channel_init(c);
+    return channel_status(c, status, janet_wrap_boolean(status == FT_OK? TRUE : FALSE));
+}
+
+typedef struct {
+    channel_t       *c;
+    int32_t         slot;           // index in the result array
+    FT_STATUS       status;
+} init_job_t;
+
+static int info_name_eq(const char *s, JanetByteView name) {
+    return strncmp(s, (const char *)name.bytes, name.len) == 0 && s[name.len] == 0;
+}
+
+static void init_job(void *p) {
+    init_job_t *j = (init_job_t *)p;
+    j->status = channel_init(j->c);
+}
+
+JANET_FN(cfun_i2c_open_all,
+    "(i2c/open-all &opt selector clockrate latency & options)",
+    "Open and initialize many channels at once. `selector` is `:all` (default) for every channel, "
+    "or an indexed of serial number or description strings, each matching the first channel not "
+    "already taken. `clockrate` and `latency` are as `i2c/init`, and `options` are `i2c/config` keywords.\n\n"
+    "Channels are opened in turn, then initialized in parallel, so one slow or failing adapter doesn't "
+    "hold up the others.\n\n"
+    "Returns an array of ready `<i2c/channel>`s, one per channel (or per selector entry), with `nil` "
+    "for any that failed. Sets `:err` to the first failure, or `:ok`.") {
+    janet_arity(argc, 0, -1);
+
+    Janet selector = argc > 0 ? argv[0] : janet_ckeywordv("all");
+    JanetView names = {NULL, 0};
+    if (janet_checktype(selector, JANET_NIL) || janet_keyeq(selector, "all"))
+        names.len = -1;
+    else if (!janet_indexed_view(selector, &names.items, &names.len))
+        janet_panicf("expected :all or indexed of serial numbers and descriptions, got %v", selector);
+    I2C_CLOCKRATE rate = i2c_clock_arg(argc, argv, 1);
+    int32_t latency = janet_optinteger(argv, argc, 2, 255);
+    if (latency < 1 || latency > 255)
+        janet_panicf("latency %d out of range. expected 1 to 255", latency);
+    uint32_t options = i2c_config_option_keywords(argc, argv, 3);
+
+    uint32_t chans = 0;
+    FT_STATUS status = I2C_GetNumChannels(&chans);
+    if (status != FT_OK)
+        return set_status_dyn(status, janet_wrap_nil());
+
+    // pick a channel index for each result slot, 0 for none
+    int32_t count = names.len < 0 ? (int32_t)chans : names.len;
+    uint32_t *indices = janet_smalloc(sizeof(uint32_t) * (count + 1));
+    if (names.len < 0) {
+        for (int32_t i = 0; i < count; i++)
+            indices[i] = i + 1;
+    } else {
+        for (int32_t i = 0; i < count; i++) {
+            JanetByteView name = janet_getbytes(names.items, i);
+            indices[i] = 0;
+            for (uint32_t ch = 0; ch < chans && indices[i] == 0; ch++) {
+                FT_DEVICE_LIST_INFO_NODE chaninfo;
+                if (I2C_GetChannelInfo(ch, &chaninfo) != FT_OK)
+                    continue;
+                if (!info_name_eq(chaninfo.SerialNumber, name) && !info_name_eq(chaninfo.Description, name))
+                    continue;
+                int32_t taken = 0;
+                for (int32_t k = 0; k < i; k++)
+                    taken |= (indices[k] == ch + 1);
+                if (!taken)
+                    indices[i] = ch + 1;
+            }
+        }
+    }
+
+    // libMPSSE's channel list isn't thread safe, so opens are done here, in turn
+    FT_STATUS first = FT_OK;
+    JanetArray *out = janet_array(count);
+    init_job_t *jobs = janet_smalloc(sizeof(init_job_t) * (count + 1));
+    int32_t njobs = 0;
+    for (int32_t i = 0; i < count; i++) {
+        janet_array_push(out, janet_wrap_nil());
+        if (indices[i] == 0) {
+            if (first == FT_OK)
+                first = FT_DEVICE_NOT_FOUND;
+            continue;
+        }
+        channel_t *c = channel_new(indices[i]);
+        out->data[i] = janet_wrap_abstract(c);
+        status = channel_open(c);
+        if (status != FT_OK) {
+            out->data[i] = janet_wrap_nil();
+            if (first == FT_OK)
+                first = status;
+            continue;
+        }
+        c->config.ClockRate = rate;
+        c->config.LatencyTimer = (uint8_t)latency;
+        c->config.Options = options;
+        jobs[njobs].c = c;
+        jobs[njobs].slot = i;
+        jobs[njobs].status = FT_OK;
+        njobs++;
+    }
+    janet_sfree(indices);
+
+    ft_parallel(init_job, jobs, sizeof(init_job_t), njobs);
+
+    for (int32_t j = 0; j < njobs; j++) {
+        if (jobs[j].status != FT_OK) {
+            I2C_CloseChannel(jobs[j].c->handle);
+            jobs[j].c->handle = NULL;
+            out->data[jobs[j].slot] = janet_wrap_nil();
+            if (first == FT_OK)
+                first = jobs[j].status;
+        }
+    }
+    janet_sfree(jobs);
+
+    return set_status_dyn(first, janet_wrap_array(out));
+}
+
+JANET_FN(cfun_i2c_reopen,
+    "(i2c/reopen channel &opt full)",
+    "Recover a `channel` after a USB error, or reopen a closed one, keeping the same `<i2c/channel>`. "
+    "If the handle is still good and the MPSSE answers in sync, only its buffers are purged. "
+    "Otherwise, or if `full` is truthy, the handle is closed, the device is found again by its USB "
+    "location and serial number (or serial alone, if it moved port), reopened, and initialized with "
+    "the last `i2c/init` settings. Config and transfer options are kept.\n\n"
+    "Returns `true` if successful, or `false` on error. Sets `:err` to return status.") {
+    janet_arity(argc, 1, 2);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
+    int full = janet_optboolean(argv, argc, 1, 0);
+
+    // fast path: the device kept its MPSSE state, so the clock and pins are still set
+    if (c->handle != NULL && !full) {
+        FT_STATUS status = Mid_PurgeDevice(c->handle);
+        if (status == FT_OK)
+            status = Mid_SyncMPSSE(c->handle);
+        if (status == FT_OK) {
+            c->dirty = FALSE;
+            return channel_status(c, FT_OK, janet_wrap_boolean(TRUE));
+        }
+    }
+
+    if (c->handle != NULL) {
+        I2C_CloseChannel(c->handle); // probably fails after an unplug, but frees libMPSSE's node
+        c->handle = NULL;
+    }
+
+    uint32_t chans = 0;
+    FT_STATUS status = I2C_GetNumChannels(&chans);
+    if (status != FT_OK)
+        return channel_status(c, status, janet_wrap_boolean(FALSE));
+
+    // prefer the same port, then the same serial anywhere
+    uint32_t found = 0;
+    for (int pass = 0; pass < 2 && found == 0; pass++) {
+        for (uint32_t i = 0; i < chans && found == 0; i++) {
+            FT_DEVICE_LIST_INFO_NODE chaninfo;
+            if (I2C_GetChannelInfo(i, &chaninfo) != FT_OK)
+                continue;
+            if (strncmp(chaninfo.SerialNumber, c->serial, sizeof(c->serial)) != 0)
+                continue;
+            if (pass == 0 && chaninfo.LocId != c->locid)
+                continue;
+            if (pass == 1 && c->serial[0] == 0)
+                continue;
+            found = i + 1;
+        }
+    }
+    if (found == 0)
+        return channel_status(c, FT_DEVICE_NOT_FOUND, janet_wrap_boolean(FALSE));
+
+    c->index = found;
+    status = channel_open(c);
+    if (status != FT_OK)
+        return channel_status(c, status, janet_wrap_boolean(FALSE));
+
+    if (c->initialized) {
+        c->config = c->init_config;
+        status = channel_init(c);
+    }
+    return channel_status(c, status, janet_wrap_boolean(status == FT_OK? TRUE : FALSE));
+}
+
+JANET_FN(cfun_i2c_timeout,
+    "(i2c/timeout channel &opt ms)",
+    "Get or set the deadline of each read & write on `channel`, in ms. Calls that take a "
+    "`timeout` override it for that call. 0 restores libMPSSE's default of 5 seconds.\n\n"
+    "A read that runs out of time returns what it got so far, and sets `:timeout`. A short "
+    "read is only `:timeout` when its transfer ran for the whole deadline (less 1/16 for timer "
+    "granularity); a quicker short read sets `:io-error`. "
+    "The channel is then purged and resynced, but the read is not retried (see `i2c/health`).\n\n"
+    "Returns the channel's deadline. Sets `:err` to return status.") {
+    janet_arity(argc, 1, 2);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
+    FT_STATUS status = FT_OK;
+    if (argc > 1) {
+        c->timeout = (uint32_t)janet_getnat(argv, 1);
+        if (c->handle != NULL && i2c_channel_deadline(c, 0) != c->timeout_set)
+            status = FT_OTHER_ERROR;
+    }
+    return channel_status(c, status, janet_wrap_number(c->timeout ? c->timeout : DEVICE_READ_TIMEOUT));
+}
+
+JANET_FN(cfun_i2c_health,
+    "(i2c/health channel &opt retries)",
+    "Get the health of `channel`, and optionally set `retries`, how many times a read is run "
+    "again (default 2) after a short read or timeout. Before a retry, the device buffers are purged "
+    "and the MPSSE checked to be in sync again, by echoing a bad command. Writes, and reads "
+    "of a FIFO, resync but are not retried, as the device may already have acted on them.\n\n"
+    "Returns a struct of:\n"
+    "* `:retries` - as set\n"
+    "* `:desyncs` - transfers that failed with a short read or timeout\n"
+    "* `:resyncs` - times the MPSSE was found back in sync\n"
+    "* `:purges`  - device buffer purges, which libMPSSE would otherwise do before every transfer\n"
+    "* `:retried` - transfers run again\n"
+    "* `:dirty`   - `true` if the last resync failed; try `:reopen`") {
+    janet_arity(argc, 1, 2);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
+    if (argc > 1)
+        c->retries = janet_getuinteger(argv, 1);
+
+    JanetKV *st = janet_struct_begin(6);
+    janet_struct_put(st, janet_ckeywordv("retries"), janet_wrap_number(c->retries));
+    janet_struct_put(st, janet_ckeywordv("desyncs"), janet_wrap_number(c->desyncs));
+    janet_struct_put(st, janet_ckeywordv("resyncs"), janet_wrap_number(c->resyncs));
+    janet_struct_put(st, janet_ckeywordv("purges"), janet_wrap_number(c->purges));
+    janet_struct_put(st, janet_ckeywordv("retried"), janet_wrap_number(c->retried));
+    janet_struct_put(st, janet_ckeywordv("dirty"), janet_wrap_boolean(c->dirty));
+    return channel_status(c, FT_OK, janet_wrap_struct(janet_struct_end(st)));
 }
 
 JANET_FN(cfun_i2c_closechannel,
@@ -443,14 +789,14 @@ JANET_FN(cfun_i2c_closechannel,
     "Returns `true` if successful. Sets `:err` to return status.") {
     janet_fixarity(argc, 1);
 
-    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);   
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);   
     if ((NULL == c) || (NULL == c->handle))
-        return set_status_dyn(FT_DEVICE_NOT_OPENED, janet_wrap_boolean(FALSE));
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_boolean(FALSE));
     
     FT_STATUS status = I2C_CloseChannel(c->handle);
     c->handle = NULL;
 
-    return set_status_dyn(status, janet_wrap_boolean(status == FT_OK? TRUE : FALSE));
+    return channel_status(c, status, janet_wrap_boolean(status == FT_OK? TRUE : FALSE));
 }
 
 JANET_FN(cfun_ft_gpio_write,
@@ -458,19 +804,20 @@ JANET_FN(cfun_ft_gpio_write,
     "Write to GPIO lines, where `direction` and `value` are an 8-bit value mapping each line. "
     "Direction bit 0 for in, and 1 for out. Value is 0 logic low, 1 logic high.\n\n"
     "Returns `nil`. Sets `:err` to return status.\n\n"
-    "Note: libMPSSE cannot use the lower gpio port pins 0-7, such as those exposed in "
-    "FTDI cable assemblies. Setting bit-6 corresponds to the onboard red LED in some cables.") {
+    "Note: these are the high byte pins; the free lower pins, such as those exposed in "
+    "FTDI cable assemblies, are written with `i2c/gpio-low-write`. "
+    "Setting bit-6 corresponds to the onboard red LED in some cables.") {
     janet_fixarity(argc, 3);
 
     uint8_t dir = janet_getinteger(argv, 1);
     uint8_t value = janet_getinteger(argv, 2);
 
-    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
     if (NULL == c->handle)
-        return set_status_dyn(FT_DEVICE_NOT_OPENED, janet_wrap_nil());
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_nil());
 
     FT_STATUS status = FT_WriteGPIO(c->handle, dir, value);
-    return set_status_dyn(status, janet_wrap_nil());
+    return channel_status(c, status, janet_wrap_nil());
 }
 
 JANET_FN(cfun_ft_gpio_read, 
@@ -480,21 +827,24 @@ JANET_FN(cfun_ft_gpio_read,
     "Note: **Must call write-gpio to initialize before reading**. See the libMPSSE.") {
     janet_fixarity(argc, 1);
 
-    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
     if (NULL == c->handle)
-        return set_status_dyn(FT_DEVICE_NOT_OPENED, janet_wrap_nil());
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_nil());
 
     uint8_t value = 0;
+    i2c_channel_deadline(c, 0);
+    i2c_channel_prepare(c);
     FT_STATUS status = FT_ReadGPIO(c->handle, &value);
-    return set_status_dyn(status, janet_wrap_integer(value));
+    return channel_status(c, status, janet_wrap_integer(value));
 }
 
 JANET_FN(cfun_i2c_deviceread,
-    "(i2c/read channel address size buffer)",
-    "Read & append `size` n-bytes to `buffer` from I2C device at `address`.\n\n"
-    "Returns bytes read. Sets `:err` to return status.\n\n"
+    "(i2c/read channel address size buffer &opt timeout)",
+    "Read & append `size` n-bytes to `buffer` from I2C device at `address`, "
+    "within `timeout` ms if given, otherwise the channel's `i2c/timeout`.\n\n"
+    "Returns bytes read, which is less than `size` on `:timeout`. Sets `:err` to return status.\n\n"
     "This is a **blocking function**.") {
-    janet_fixarity(argc, 4);
+    janet_arity(argc, 4, 5);
 
     uint32_t address = janet_getuinteger(argv, 1);
     if (address > 127)
@@ -507,29 +857,38 @@ JANET_FN(cfun_i2c_deviceread,
     JanetBuffer *buffer = janet_getbuffer(argv, 3);
     janet_buffer_extra(buffer, size);
     
-    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
     if (NULL == c->handle)
-        return set_status_dyn(FT_DEVICE_NOT_OPENED, janet_wrap_integer(0));
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_integer(0));
 
+    uint32_t ms = i2c_channel_deadline(c, (uint32_t)janet_optnat(argv, argc, 4, 0));
     uint32_t readsz = 0;
-    FT_STATUS status = I2C_DeviceRead(c->handle,
-                                      address,
-                                      size, 
-                                      (buffer->data + buffer->count), 
-                                      &readsz, 
-                                      c->read_options);
+    uint32_t tries = c->retries;
+    FT_STATUS status;
+    do {
+        int64_t attempt = ft_monotonic_ns();
+        i2c_channel_prepare(c);
+        status = I2C_DeviceRead(c->handle,
+                                address,
+                                size, 
+                                (buffer->data + buffer->count), 
+                                &readsz, 
+                                c->read_options);
+        status = ft_deadline_status(status, attempt, ms);
+    } while (i2c_channel_recover(c, status, &tries));
     if (readsz > 0)
         buffer->count += readsz;
 
-    return set_status_dyn(status, janet_wrap_integer(readsz));
+    return channel_status(c, status, janet_wrap_integer(readsz));
 }
 
 JANET_FN(cfun_i2c_devicewrite,
-    "(i2c/write channel address size buffer)",
-    "Write `size` n-bytes of `buffer` to I2C channel/device `address`.\n\n"
+    "(i2c/write channel address size buffer &opt timeout)",
+    "Write `size` n-bytes of `buffer` to I2C channel/device `address`, "
+    "within `timeout` ms if given, otherwise the channel's `i2c/timeout`.\n\n"
     "Returns bytes written. Sets `:err` to return status.\n\n"
     "This is a **blocking function**.") {
-    janet_fixarity(argc, 4);
+    janet_arity(argc, 4, 5);
 
     uint32_t address = janet_getinteger(argv, 1);
     if (address > 127)
@@ -539,9 +898,9 @@ JANET_FN(cfun_i2c_devicewrite,
     if (size <= 0)
         janet_panicf("buffer size %d is out of range. Expected > 0", size);
 
-    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);    
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);    
     if (NULL == c->handle)
-        return set_status_dyn(FT_DEVICE_NOT_OPENED, janet_wrap_integer(0));
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_integer(0));
     
     FT_STATUS status;
     uint32_t writesz = 0;
@@ -557,13 +916,476 @@ JANET_FN(cfun_i2c_devicewrite,
             janet_panicf("write size %d larger than buffer count %d", size, buffer->count);
         buf = buffer->data;
     }
+    // not retried, as the device may have taken some of the data already
+    uint32_t ms = i2c_channel_deadline(c, (uint32_t)janet_optnat(argv, argc, 4, 0));
+    int64_t start = ft_monotonic_ns();
+    uint32_t tries = 0;
+    i2c_channel_prepare(c);
     status = I2C_DeviceWrite(c->handle, 
                              address,
                              size, 
                              buf, 
                              &writesz, 
                              c->write_options);
-    return set_status_dyn(status, janet_wrap_integer(writesz));
+    status = ft_deadline_status(status, start, ms);
+    i2c_channel_recover(c, status, &tries);
+    return channel_status(c, status, janet_wrap_integer(writesz));
+}
+
+JANET_FN(cfun_i2c_writeread,
+    "(i2c/write-read channel address data size buffer &opt timeout)",
+    "Write `data` to I2C device `address`, then with a repeated start read & append `size` "
+    "n-bytes to `buffer`, such as to read registers starting at the register address in `data`. "
+    "`data` is bytes or a buffer, or an 8-bit integer. Takes a `timeout` in ms as `i2c/read`.\n\n"
+    "Returns bytes read. Sets `:err` to return status.\n\n"
+    "Note: the whole transaction is one USB write & read, and ignores the `read-opt`/`write-opt` options.\n\n"
+    "This is a **blocking function**.") {
+    janet_arity(argc, 5, 7);
+
+    uint32_t address = janet_getuinteger(argv, 1);
+    if (address > 127)
+        janet_panicf("i2c address %d is out of range. Expected 7-bit address <= 127.", address);
+
+    uint8_t b = 0;
+    uint8_t *data = &b;
+    uint32_t datasz = 1;
+    if (janet_checktype(argv[2], JANET_NUMBER)) {
+        b = (uint8_t)janet_getuinteger(argv, 2);
+    } else {
+        JanetByteView bytes = janet_getbytes(argv, 2);
+        data = (uint8_t *)bytes.bytes;
+        datasz = bytes.len;
+    }
+
+    uint32_t size = janet_getuinteger(argv, 3);
+    if (size < 1)
+        janet_panic("read size must be greater than 0");
+
+    JanetBuffer *buffer = janet_getbuffer(argv, 4);
+    janet_buffer_extra(buffer, size);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
+    if (NULL == c->handle)
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_integer(0));
+
+    uint32_t ms = i2c_channel_deadline(c, (uint32_t)janet_optnat(argv, argc, 5, 0));
+    uint32_t readsz = 0;
+    uint32_t tries = c->retries;
+    FT_STATUS status;
+    do {
+        int64_t attempt = ft_monotonic_ns();
+        i2c_channel_prepare(c);
+        status = I2C_DeviceWriteRead(c->handle,
+                                     address,
+                                     datasz,
+                                     data,
+                                     size,
+                                     (buffer->data + buffer->count),
+                                     &readsz);
+        status = ft_deadline_status(status, attempt, ms);
+    } while (i2c_channel_recover(c, status, &tries));
+    if (readsz > 0)
+        buffer->count += readsz;
+
+    return channel_status(c, status, janet_wrap_integer(readsz));
+}
+
+// Compiled data is the device address, then the bytes to write
+static FT_STATUS transaction_writeread(transaction_t *t, uint8_t *in) {
+    uint32_t readsz = 0;
+    FT_STATUS status = I2C_DeviceWriteRead(*t->handle, t->data[0], t->count - 1, t->data + 1, t->size, in, &readsz);
+    if (status == FT_IO_ERROR) { // resync for the next run; the channel's stats are left to Janet
+        if (Mid_PurgeDevice(*t->handle) == FT_OK)
+            Mid_SyncMPSSE(*t->handle);
+    }
+    return status;
+}
+
+static FT_STATUS transaction_send(transaction_t *t, uint32_t *expect) {
+    DWORD n = 0;
+    FT_STATUS status = I2C_DeviceWriteReadSend(*t->handle, t->data[0], t->count - 1, t->data + 1, t->size, &n);
+    *expect = n;
+    return status;
+}
+
+static FT_STATUS transaction_receive(transaction_t *t, uint8_t *in) {
+    DWORD readsz = 0;
+    FT_STATUS status = I2C_DeviceWriteReadReceive(*t->handle, t->count - 1, t->size, in, &readsz);
+    if (status == FT_IO_ERROR) {
+        if (Mid_PurgeDevice(*t->handle) == FT_OK)
+            Mid_SyncMPSSE(*t->handle);
+    }
+    return status;
+}
+
+JANET_FN(cfun_i2c_transaction,
+    "(i2c/transaction channel address data size)",
+    "Compile an `i2c/write-read` of `size` bytes from device `address`, to be run by `ft/sampler` "
+    "or `ft/await`. "
+    "`data` is bytes or a buffer, or an 8-bit integer, and is copied.\n\n"
+    "Returns an `<ft/transaction>`.") {
+    janet_fixarity(argc, 4);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
+    uint32_t address = janet_getuinteger(argv, 1);
+    if (address > 127)
+        janet_panicf("i2c address %d is out of range. Expected 7-bit address <= 127.", address);
+
+    uint8_t compiled[256];
+    uint32_t count = 1;
+    compiled[0] = (uint8_t)address;
+    if (janet_checktype(argv[2], JANET_NUMBER)) {
+        compiled[count++] = (uint8_t)janet_getuinteger(argv, 2);
+    } else {
+        JanetByteView bytes = janet_getbytes(argv, 2);
+        if (bytes.len > (int32_t)sizeof(compiled) - 1)
+            janet_panicf("transaction data of %d bytes is too long, expected at most %d", bytes.len, (int)sizeof(compiled) - 1);
+        memcpy(compiled + 1, bytes.bytes, bytes.len);
+        count += bytes.len;
+    }
+
+    uint32_t size = janet_getuinteger(argv, 3);
+    if (size < 1)
+        janet_panic("read size must be greater than 0");
+
+    return transaction_new(argv[0], &c->handle, transaction_writeread, transaction_send, transaction_receive,
+                           size, compiled, count);
+}
+
+// Registers are read with a write-read of the register address, and written after it in one write
+static FT_STATUS regmap_i2c_read(regmap_t *m, uint8_t reg, uint8_t *data, uint32_t n) {
+    channel_t *c = (channel_t *)janet_unwrap_abstract(m->owner);
+    if (NULL == c->handle)
+        return FT_DEVICE_NOT_OPENED;
+    uint32_t ms = i2c_channel_deadline(c, 0);
+    uint32_t readsz = 0;
+    uint32_t tries = c->retries;
+    FT_STATUS status;
+    do {
+        int64_t attempt = ft_monotonic_ns();
+        i2c_channel_prepare(c);
+        status = I2C_DeviceWriteRead(c->handle, m->address, 1, &reg, n, data, &readsz);
+        status = ft_deadline_status(status, attempt, ms);
+    } while (i2c_channel_recover(c, status, &tries));
+    return status;
+}
+
+static FT_STATUS regmap_i2c_write(regmap_t *m, uint8_t reg, uint8_t *data, uint32_t n) {
+    channel_t *c = (channel_t *)janet_unwrap_abstract(m->owner);
+    if (NULL == c->handle)
+        return FT_DEVICE_NOT_OPENED;
+    uint8_t frame[1 + REGMAP_SIZE];
+    frame[0] = reg;
+    memcpy(frame + 1, data, n);
+
+    // not retried, as the device may have taken it already
+    uint32_t ms = i2c_channel_deadline(c, 0);
+    int64_t start = ft_monotonic_ns();
+    uint32_t readsz = 0;
+    uint32_t tries = 0;
+    i2c_channel_prepare(c);
+    FT_STATUS status = I2C_DeviceWriteRead(c->handle, m->address, 1 + n, frame, 0, NULL, &readsz);
+    status = ft_deadline_status(status, start, ms);
+    i2c_channel_recover(c, status, &tries);
+    return status;
+}
+
+// Compiled data of a plan is the device address, then each burst's register and length - 1
+static uint32_t transaction_plan_entries(transaction_t *t, UCHAR *addresses, UCHAR *registers, DWORD *sizes) {
+    uint32_t n = (t->count - 1) / 2;
+    for (uint32_t i = 0; i < n; i++) {
+        addresses[i] = t->data[0];
+        registers[i] = t->data[1 + 2 * i];
+        sizes[i] = (DWORD)t->data[2 + 2 * i] + 1;
+    }
+    return n;
+}
+
+// Any burst nAcked fails the plan; after a short read the channel is resynced for the next run
+static FT_STATUS transaction_plan_status(transaction_t *t, FT_STATUS status, uint32_t n, const UCHAR *nacked) {
+    if (status == FT_IO_ERROR) {
+        if (Mid_PurgeDevice(*t->handle) == FT_OK)
+            Mid_SyncMPSSE(*t->handle);
+    }
+    for (uint32_t i = 0; status == FT_OK && i < n; i++)
+        if (nacked[i])
+            status = FT_DEVICE_NOT_FOUND;
+    return status;
+}
+
+static FT_STATUS transaction_plan(transaction_t *t, uint8_t *in) {
+    UCHAR addresses[REGMAP_PLAN_MAX];
+    UCHAR registers[REGMAP_PLAN_MAX];
+    DWORD sizes[REGMAP_PLAN_MAX];
+    UCHAR nacked[REGMAP_PLAN_MAX];
+    uint32_t n = transaction_plan_entries(t, addresses, registers, sizes);
+    FT_STATUS status = I2C_Poll(*t->handle, n, addresses, registers, sizes, in, nacked);
+    return transaction_plan_status(t, status, n, nacked);
+}
+
+// The same single write of every burst as I2C_Poll, and once it's all queued, a single read
+static FT_STATUS transaction_plan_send(transaction_t *t, uint32_t *expect) {
+    UCHAR addresses[REGMAP_PLAN_MAX];
+    UCHAR registers[REGMAP_PLAN_MAX];
+    DWORD sizes[REGMAP_PLAN_MAX];
+    uint32_t n = transaction_plan_entries(t, addresses, registers, sizes);
+    DWORD k = 0;
+    FT_STATUS status = I2C_PollSend(*t->handle, n, addresses, registers, sizes, &k);
+    *expect = k;
+    return status;
+}
+
+static FT_STATUS transaction_plan_receive(transaction_t *t, uint8_t *in) {
+    UCHAR addresses[REGMAP_PLAN_MAX];
+    UCHAR registers[REGMAP_PLAN_MAX];
+    DWORD sizes[REGMAP_PLAN_MAX];
+    UCHAR nacked[REGMAP_PLAN_MAX];
+    uint32_t n = transaction_plan_entries(t, addresses, registers, sizes);
+    FT_STATUS status = I2C_PollReceive(*t->handle, n, sizes, in, nacked);
+    return transaction_plan_status(t, status, n, nacked);
+}
+
+static FT_STATUS regmap_i2c_compile(regmap_t *m, const regmap_burst_t *bursts, int32_t n, uint32_t size, Janet *out) {
+    channel_t *c = (channel_t *)janet_unwrap_abstract(m->owner);
+    uint8_t compiled[1 + 2 * REGMAP_PLAN_MAX];
+    compiled[0] = (uint8_t)m->address;
+    for (int32_t i = 0; i < n; i++) {
+        compiled[1 + 2 * i] = bursts[i].reg;
+        compiled[2 + 2 * i] = (uint8_t)(bursts[i].len - 1);
+    }
+    *out = transaction_new(m->owner, &c->handle, transaction_plan, transaction_plan_send, transaction_plan_receive,
+                           size, compiled, 1 + 2 * n);
+    return FT_OK;
+}
+
+JANET_FN(cfun_i2c_regmap,
+    "(i2c/regmap channel address &opt volatile)",
+    "A register map of the device at `address`, with a shadow of its 8-bit registers, see `regmap/get`. "
+    "`volatile` is an indexed of the registers the device changes itself, and of `[first last]` ranges "
+    "of them, which are always read from the device.\n\n"
+    "Returns a `<regmap/map>`.\n\n"
+    "Note: each read is one `i2c/write-read`, and each write is the register address and data in one "
+    "USB write, ignoring the `write-opt` options. A `regmap/plan` reads its bursts as `i2c/poll` does.") {
+    janet_arity(argc, 2, 3);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
+    uint32_t address = janet_getuinteger(argv, 1);
+    if (address > 127)
+        janet_panicf("i2c address %d is out of range. Expected 7-bit address <= 127.", address);
+    return regmap_new(argv[0], &c->err_mode, regmap_i2c_read, regmap_i2c_write, regmap_i2c_compile,
+                      address, argc, argv, 2);
+}
+
+JANET_FN(cfun_i2c_fifo_read,
+    "(i2c/fifo-read channel address count-reg data-reg frame &opt max buffer)",
+    "Drain a sensor FIFO: read the big-endian 16-bit byte count at register `count-reg`, "
+    "then burst read the whole `frame`-byte frames available (at most `max` bytes) from the FIFO "
+    "register `data-reg`, and decode each frame as big-endian signed 16-bit words. Given `buffer`, "
+    "the frames are appended to it undecoded instead, e.g. for `ft/frame-decode`.\n\n"
+    "Returns an array of tuples, one per frame, or `buffer`; or `nil` on error. Sets `:err` to return status.\n\n"
+    "Note: each of the two reads is one `i2c/write-read` transaction. Bytes of a partial frame are left in the FIFO.\n\n"
+    "This is a **blocking function**.") {
+    janet_arity(argc, 5, 7);
+
+    uint32_t address = janet_getuinteger(argv, 1);
+    if (address > 127)
+        janet_panicf("i2c address %d is out of range. Expected 7-bit address <= 127.", address);
+    uint32_t reg = janet_getuinteger(argv, 2);
+    if (reg > 255)
+        janet_panicf("count-reg 0x%X is out of range. Expected an 8-bit register", reg);
+    uint8_t count_reg = (uint8_t)reg;
+    reg = janet_getuinteger(argv, 3);
+    if (reg > 255)
+        janet_panicf("data-reg 0x%X is out of range. Expected an 8-bit register", reg);
+    uint8_t data_reg = (uint8_t)reg;
+    uint32_t frame = janet_getuinteger(argv, 4);
+    if (frame < 2 || frame % 2)
+        janet_panicf("frame size %d is invalid. Expected an even number of bytes", frame);
+    uint32_t max = janet_optinteger(argv, argc, 5, 0xFFFF);
+    JanetBuffer *raw = (argc > 6) ? janet_getbuffer(argv, 6) : NULL;
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
+    if (NULL == c->handle)
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_nil());
+
+    uint8_t count_be[2];
+    uint32_t readsz = 0;
+    uint32_t ms = i2c_channel_deadline(c, 0);
+    int64_t start = ft_monotonic_ns();
+    uint32_t tries = c->retries;
+    FT_STATUS status;
+    do {
+        int64_t attempt = ft_monotonic_ns();
+        i2c_channel_prepare(c);
+        status = I2C_DeviceWriteRead(c->handle, address, 1, &count_reg, 2, count_be, &readsz);
+        status = ft_deadline_status(status, attempt, ms);
+    } while (i2c_channel_recover(c, status, &tries));
+    if (status != FT_OK)
+        return channel_status(c, status, janet_wrap_nil());
+
+    uint32_t count = ((uint32_t)count_be[0] << 8) | count_be[1];
+    if (count > max)
+        count = max;
+    count -= count % frame;
+
+    if (raw != NULL && count == 0)
+        return channel_status(c, status, janet_wrap_buffer(raw));
+    JanetArray *frames = NULL;
+    if (raw == NULL) {
+        frames = janet_array(count / frame);
+        if (count == 0)
+            return channel_status(c, status, janet_wrap_array(frames));
+    }
+
+    uint8_t *data;
+    if (raw != NULL) {
+        janet_buffer_extra(raw, count);
+        data = raw->data + raw->count;
+    } else {
+        data = janet_smalloc(count);
+    }
+    // not retried, as reading the FIFO pops it
+    tries = 0;
+    start = ft_monotonic_ns();
+    status = I2C_DeviceWriteRead(c->handle, address, 1, &data_reg, count, data, &readsz);
+    status = ft_deadline_status(status, start, ms);
+    i2c_channel_recover(c, status, &tries);
+    if (raw != NULL) {
+        if (status != FT_OK)
+            return channel_status(c, status, janet_wrap_nil());
+        raw->count += count;
+        return channel_status(c, status, janet_wrap_buffer(raw));
+    }
+    if (status != FT_OK) {
+        janet_sfree(data);
+        return channel_status(c, status, janet_wrap_nil());
+    }
+
+    uint32_t words = frame / 2;
+    for (uint8_t *f = data; f < data + count; f += frame) {
+        Janet *t = janet_tuple_begin(words);
+        for (uint32_t w = 0; w < words; w++)
+            t[w] = janet_wrap_integer((int16_t)((f[2*w] << 8) | f[2*w + 1]));
+        janet_array_push(frames, janet_wrap_tuple(janet_tuple_end(t)));
+    }
+    janet_sfree(data);
+    return channel_status(c, status, janet_wrap_array(frames));
+}
+
+#define I2C_POLL_MAX_ENTRIES 32 // one bit each in the NAK mask
+
+JANET_FN(cfun_i2c_poll,
+    "(i2c/poll channel entries)",
+    "Read registers from many devices in one transaction. `entries` is an indexed of `[address reg len]`, "
+    "each read as by `i2c/write-read` with the 8-bit register address `reg`, and up to 32 entries.\n\n"
+    "Every entry's start/address/register/repeated start/read/stop commands go out in one USB write, "
+    "and all the ACKs and data come back with one read.\n\n"
+    "Returns a tuple of `[buffers nak]`, where `buffers` is a tuple of a buffer per entry, and bit `n` of the "
+    "integer `nak` is set if entry `n` was not acknowledged (its buffer then holds no valid data). "
+    "Returns `nil` on error. Sets `:err` to return status.\n\n"
+    "This is a **blocking function**.") {
+    janet_fixarity(argc, 2);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
+    JanetView entries = janet_getindexed(argv, 1);
+    if (entries.len < 1 || entries.len > I2C_POLL_MAX_ENTRIES)
+        janet_panicf("expected 1 to %d poll entries, got %d", I2C_POLL_MAX_ENTRIES, entries.len);
+
+    UCHAR addresses[I2C_POLL_MAX_ENTRIES];
+    UCHAR registers[I2C_POLL_MAX_ENTRIES];
+    DWORD sizes[I2C_POLL_MAX_ENTRIES];
+    UCHAR nacked[I2C_POLL_MAX_ENTRIES];
+    uint32_t total = 0;
+    for (int32_t i = 0; i < entries.len; i++) {
+        JanetView e;
+        if (!janet_indexed_view(entries.items[i], &e.items, &e.len) || e.len != 3)
+            janet_panicf("poll entry %v is invalid, expected [address reg len]", entries.items[i]);
+        uint32_t address = janet_getuinteger(e.items, 0);
+        if (address > 127)
+            janet_panicf("i2c address %d is out of range. Expected 7-bit address <= 127.", address);
+        uint32_t size = janet_getuinteger(e.items, 2);
+        if (size < 1)
+            janet_panic("read size must be greater than 0");
+        addresses[i] = (UCHAR)address;
+        uint32_t reg = janet_getuinteger(e.items, 1);
+        if (reg > 255)
+            janet_panicf("register 0x%X is out of range. Expected an 8-bit register", reg);
+        registers[i] = (UCHAR)reg;
+        sizes[i] = size;
+        total += size;
+    }
+
+    if (NULL == c->handle)
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_nil());
+
+    uint8_t *data = janet_smalloc(total);
+    uint32_t ms = i2c_channel_deadline(c, 0);
+    uint32_t tries = c->retries;
+    FT_STATUS status;
+    do {
+        int64_t attempt = ft_monotonic_ns();
+        i2c_channel_prepare(c);
+        status = I2C_Poll(c->handle, entries.len, addresses, registers, sizes, data, nacked);
+        status = ft_deadline_status(status, attempt, ms);
+    } while (i2c_channel_recover(c, status, &tries));
+    if (status != FT_OK) {
+        janet_sfree(data);
+        return channel_status(c, status, janet_wrap_nil());
+    }
+
+    Janet *buffers = janet_tuple_begin(entries.len);
+    uint32_t nak = 0;
+    uint8_t *d = data;
+    for (int32_t i = 0; i < entries.len; i++) {
+        JanetBuffer *b = janet_buffer(sizes[i]);
+        janet_buffer_push_bytes(b, d, sizes[i]);
+        buffers[i] = janet_wrap_buffer(b);
+        d += sizes[i];
+        if (nacked[i])
+            nak |= 1u << i;
+    }
+    janet_sfree(data);
+
+    Janet out[2] = {janet_wrap_tuple(janet_tuple_end(buffers)), janet_wrap_number(nak)};
+    return channel_status(c, status, janet_wrap_tuple(janet_tuple_n(out, 2)));
+}
+
+JANET_FN(cfun_i2c_scan,
+    "(i2c/scan channel &opt first last)",
+    "Find the devices that ACK their address on the bus, from `first` to `last` address. "
+    "Defaults to 0x08 to 0x77, skipping the reserved addresses.\n\n"
+    "Returns an array of responding 7-bit addresses, or `nil` on error. Sets `:err` to return status.\n\n"
+    "Note: every address is probed with a write in one USB transfer, instead of one `i2c/write` per address.\n\n"
+    "This is a **blocking function**.") {
+    janet_arity(argc, 1, 3);
+
+    uint32_t first = janet_optinteger(argv, argc, 1, 0x08);
+    uint32_t last = janet_optinteger(argv, argc, 2, 0x77);
+    if (first > 127 || last > 127 || first > last)
+        janet_panicf("i2c address range %d to %d is invalid. Expected 7-bit addresses, first <= last.", first, last);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
+    if (NULL == c->handle)
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_nil());
+
+    uint8_t present[128];
+    uint32_t count = 0;
+    uint32_t ms = i2c_channel_deadline(c, 0);
+    uint32_t tries = c->retries;
+    FT_STATUS status;
+    do {
+        int64_t attempt = ft_monotonic_ns();
+        i2c_channel_prepare(c);
+        status = I2C_Scan(c->handle, first, last, present, &count);
+        status = ft_deadline_status(status, attempt, ms);
+    } while (i2c_channel_recover(c, status, &tries));
+    if (status != FT_OK)
+        return channel_status(c, status, janet_wrap_nil());
+
+    JanetArray *found = janet_array(count);
+    for (uint32_t i = 0; i < count; i++)
+        janet_array_push(found, janet_wrap_integer(present[i]));
+    return channel_status(c, status, janet_wrap_array(found));
 }
 
 static Janet version_to_tuple(uint32_t ver) {
@@ -590,18 +1412,78 @@ JANET_FN(cfun_ft_ver_libmpsse,
     return set_status_dyn(FT_OK, janet_wrap_tuple(janet_tuple_n(vals, 2)));
 }
 
+JANET_FN(cfun_i2c_gpio_low_write,
+    "(i2c/gpio-low-write channel dir value &opt :deferred)",
+    "Write to the low byte GPIO lines ADBUS4-7, which are not used by I2C. Bits 0-3 (SCL/SDA) are ignored. "
+    "`dir` and `value` map each line as in `gpio-write`.\n\n"
+    "The lines keep their state across transfers, as it is merged into the protocol's own "
+    "low byte commands. With `:deferred` nothing is written now, and the lines change with "
+    "the first SCL/SDA command of the next transfer, in the same USB write.\n\n"
+    "Returns `nil`. Sets `:err` to return status.\n\n"
+    "Note: the channel must be initialized.") {
+    janet_arity(argc, 3, 4);
+
+    uint8_t dir = janet_getinteger(argv, 1);
+    uint8_t value = janet_getinteger(argv, 2);
+
+    BOOL deferred = FALSE;
+    if (argc > 3) {
+        JanetKeyword opt = janet_getkeyword(argv, 3);
+        if (strcmp(opt, "deferred") != 0)
+            janet_panicf("invalid gpio option %v, expected :deferred", argv[3]);
+        deferred = TRUE;
+    }
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
+    if (NULL == c->handle)
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_nil());
+
+    FT_STATUS status = I2C_WriteGPIOLow(c->handle, dir, value, deferred);
+    return channel_status(c, status, janet_wrap_nil());
+}
+
+JANET_FN(cfun_i2c_gpio_low_read,
+    "(i2c/gpio-low-read channel)",
+    "Read the 8 lines of the low byte of the MPSSE channel, including the I2C lines.\n\n"
+    "Returns an unsigned 8-bit integer, or `nil` on error. Sets `:err` to return status.") {
+    janet_fixarity(argc, 1);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &i2c_channel_type);
+    if (NULL == c->handle)
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_nil());
+
+    uint8_t value = 0;
+    i2c_channel_deadline(c, 0);
+    i2c_channel_prepare(c);
+    FT_STATUS status = FT_ReadGPIOLow(c->handle, &value);
+    return channel_status(c, status, janet_wrap_integer(value));
+}
+
 static JanetMethod channel_methods[] = {
     {"err",             cfun_i2c_get_err},
+    {"err-mode",        cfun_i2c_err_mode},
     {"info",            cfun_i2c_getchannelinfo},
     {"id",              cfun_i2c_get_id},
     {"is-open",         cfun_i2c_is_open},
     {"close",           cfun_i2c_closechannel},
+    {"reopen",          cfun_i2c_reopen},
+    {"health",          cfun_i2c_health},
+    {"timeout",         cfun_i2c_timeout},
     {"init",            cfun_i2c_initchannel},
     {"read",            cfun_i2c_deviceread},
     {"write",           cfun_i2c_devicewrite},
+    {"write-read",      cfun_i2c_writeread},
+    {"fifo-read",       cfun_i2c_fifo_read},
+    {"regmap",          cfun_i2c_regmap},
+    {"transaction",     cfun_i2c_transaction},
+    {"poll",            cfun_i2c_poll},
+    {"scan",            cfun_i2c_scan},
     {"read-opt",        cfun_i2c_set_read_options},
     {"write-opt",       cfun_i2c_set_write_options},
-    {"config",          cfun_i2c_set_config_options}
+    {"config",          cfun_i2c_set_config_options},
+    {"gpio-low-write",  cfun_i2c_gpio_low_write},
+    {"gpio-low-read",   cfun_i2c_gpio_low_read},
+    {NULL,              NULL}
 };
 
 static int channel_get(void *p, Janet key, Janet *out) {
@@ -616,6 +1498,8 @@ static int channel_gc(void *p, size_t s) {
     channel_t *c = (channel_t *)p;
     FT_STATUS status = FT_DEVICE_NOT_OPENED;
     if (c != NULL) {
+        // a closed channel, or one moved to another thread, has no handle
+        ft_sampler_release(&c->handle);
         if (c->handle != NULL) {
             status = I2C_CloseChannel(c->handle);
             c->handle = NULL;
@@ -625,6 +1509,51 @@ static int channel_gc(void *p, size_t s) {
     return 0;
 }
 
+/* Channels move between threads (ev/thread, threaded channels): the handle is passed
+    as a pointer, which marshal only allows between threads of the same process, and the
+    sender's copy is left without one, as if closed. */
+static void channel_marshal(void *p, JanetMarshalContext *ctx) {
+    channel_t *c = (channel_t *)p;
+    janet_marshal_abstract(ctx, p);
+    janet_marshal_int(ctx, (int32_t)c->index);
+    janet_marshal_int(ctx, (int32_t)c->id);
+    janet_marshal_int(ctx, (int32_t)c->locid);
+    janet_marshal_bytes(ctx, (const uint8_t *)c->serial, sizeof(c->serial));
+    janet_marshal_ptr(ctx, c->handle);
+    janet_marshal_int(ctx, (int32_t)c->err_mode);
+    janet_marshal_bytes(ctx, (const uint8_t *)&c->config, sizeof(ChannelConfig));
+    janet_marshal_bytes(ctx, (const uint8_t *)&c->init_config, sizeof(ChannelConfig));
+    janet_marshal_int(ctx, (int32_t)c->initialized);
+    janet_marshal_int(ctx, (int32_t)c->read_options);
+    janet_marshal_int(ctx, (int32_t)c->write_options);
+    janet_marshal_int(ctx, (int32_t)c->timeout);
+    janet_marshal_int(ctx, (int32_t)c->timeout_set);
+    janet_marshal_int(ctx, (int32_t)c->retries);
+    janet_marshal_int(ctx, (int32_t)c->dirty);
+    c->handle = NULL;
+}
+
+static void *channel_unmarshal(JanetMarshalContext *ctx) {
+    channel_t *c = (channel_t *)janet_unmarshal_abstract(ctx, sizeof(channel_t));
+    c->index = (uint32_t)janet_unmarshal_int(ctx);
+    c->id = (uint32_t)janet_unmarshal_int(ctx);
+    c->locid = (uint32_t)janet_unmarshal_int(ctx);
+    janet_unmarshal_bytes(ctx, (uint8_t *)c->serial, sizeof(c->serial));
+    c->handle = (FT_HANDLE)janet_unmarshal_ptr(ctx);
+    c->err_mode = (err_mode_t)janet_unmarshal_int(ctx);
+    janet_unmarshal_bytes(ctx, (uint8_t *)&c->config, sizeof(ChannelConfig));
+    janet_unmarshal_bytes(ctx, (uint8_t *)&c->init_config, sizeof(ChannelConfig));
+    c->initialized = (BOOL)janet_unmarshal_int(ctx);
+    c->read_options = (uint32_t)janet_unmarshal_int(ctx);
+    c->write_options = (uint32_t)janet_unmarshal_int(ctx);
+    c->timeout = (uint32_t)janet_unmarshal_int(ctx);
+    c->timeout_set = (uint32_t)janet_unmarshal_int(ctx);
+    c->retries = (uint32_t)janet_unmarshal_int(ctx);
+    c->dirty = (BOOL)janet_unmarshal_int(ctx);
+    c->desyncs = c->resyncs = c->purges = c->retried = 0;
+    return c;
+}
+
 static void channel_string(void *p, JanetBuffer *buffer) {
     channel_t *c = (channel_t *)p;
     janet_formatb(buffer, "#%d 0x%X", c->index, c);
@@ -633,6 +1562,7 @@ static void channel_string(void *p, JanetBuffer *buffer) {
 void i2c_register(JanetTable *env) {
     JanetRegExt cfuns[] = {
         JANET_REG("i2c/err",            cfun_i2c_get_err),
+        JANET_REG("i2c/err-mode",       cfun_i2c_err_mode),
         JANET_REG("i2c/channels",       cfun_i2c_channelcount),
         JANET_REG("i2c/info",           cfun_i2c_getchannelinfo),
         JANET_REG("i2c/find-by",        cfun_i2c_find),
@@ -641,15 +1571,28 @@ void i2c_register(JanetTable *env) {
         JANET_REG("i2c/write-opt",      cfun_i2c_set_write_options),
         JANET_REG("i2c/config",         cfun_i2c_set_config_options),
         JANET_REG("i2c/open",           cfun_i2c_openchannel),
+        JANET_REG("i2c/open-all",       cfun_i2c_open_all),
         JANET_REG("i2c/is-open",        cfun_i2c_is_open),
         JANET_REG("i2c/init",           cfun_i2c_initchannel),
         JANET_REG("i2c/close",          cfun_i2c_closechannel),
+        JANET_REG("i2c/reopen",         cfun_i2c_reopen),
+        JANET_REG("i2c/health",         cfun_i2c_health),
+        JANET_REG("i2c/timeout",        cfun_i2c_timeout),
         JANET_REG("i2c/read",           cfun_i2c_deviceread),
         JANET_REG("i2c/write",          cfun_i2c_devicewrite),
+        JANET_REG("i2c/write-read",     cfun_i2c_writeread),
+        JANET_REG("i2c/fifo-read",      cfun_i2c_fifo_read),
+        JANET_REG("i2c/regmap",         cfun_i2c_regmap),
+        JANET_REG("i2c/transaction",    cfun_i2c_transaction),
+        JANET_REG("i2c/poll",           cfun_i2c_poll),
+        JANET_REG("i2c/scan",           cfun_i2c_scan),
         JANET_REG("i2c/gpio-read",      cfun_ft_gpio_read),
         JANET_REG("i2c/gpio-write",     cfun_ft_gpio_write),
+        JANET_REG("i2c/gpio-low-read",  cfun_i2c_gpio_low_read),
+        JANET_REG("i2c/gpio-low-write", cfun_i2c_gpio_low_write),
         JANET_REG("ft/version",         cfun_ft_ver_libmpsse),
         JANET_REG_END
     };
     janet_cfuns_ext(env, "i2c", cfuns);
+    janet_register_abstract_type(&i2c_channel_type);
 }
\ No newline at end of file
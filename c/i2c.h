@@ -0,0 +1,43 @@
+#ifndef _I2C_H_
+#define _I2C_H_
+#include "module.h"
+#include "../LibMPSSE_1.0.7/release/include/libmpsse_i2c.h"
+
+/* I2C channels, shared with the modules built on them (eeprom). */
+
+typedef struct {
+    uint32_t        index;          // 1-based, as user-entered
+    uint32_t        id;             // unique id per-channel set by libmpsse
+    uint32_t        locid;          // USB location and serial, to find the device again on reopen
+    char            serial[16];
+    FT_HANDLE       handle;
+    err_mode_t      err_mode;       // how calls on the channel report their status
+    ChannelConfig   config;
+    ChannelConfig   init_config;    // as last passed to init, before libMPSSE adjusts the clock
+    BOOL            initialized;
+    uint32_t        read_options;   // these are use per-read/write
+    uint32_t        write_options;  //
+    uint32_t        timeout;        // ms deadline of each call, 0 for libMPSSE's default
+    uint32_t        timeout_set;    // as set in the driver now, 0 if unknown
+    // health: libMPSSE's purge before every transfer is disabled, and done only after a failure
+    uint32_t        retries;        // max retries of a read after a resync
+    BOOL            dirty;          // a failed transfer may have left bytes behind
+    uint32_t        desyncs;        // transfers that failed with a short read or timeout
+    uint32_t        resyncs;        // purges that got the MPSSE echoing in sync again
+    uint32_t        purges;
+    uint32_t        retried;
+} channel_t;
+
+extern const JanetAbstractType i2c_channel_type;
+
+/* Set the driver's read & write timeouts for a call with a deadline of 'ms', or the
+    channel's deadline if 0. Returns the deadline in effect. */
+extern uint32_t i2c_channel_deadline(channel_t *c, uint32_t ms);
+
+// Purge what a failed transfer left in the device buffers, before the next one
+extern void i2c_channel_prepare(channel_t *c);
+
+/* After a transfer: resync on a short read or timeout, and return true if the transfer
+    should be run again, while 'tries' lasts. */
+extern BOOL i2c_channel_recover(channel_t *c, FT_STATUS status, uint32_t *tries);
+#endif
@@ -0,0 +1,676 @@
+// JTAG over the MPSSE, built on the libMPSSE middle layer (there is no libMPSSE-JTAG)
+
+#include "mpsse.h"
+#include "../LibMPSSE_1.0.7/release/source/ftdi_mid.h"
+
+// MPSSE commands, LSB first: data out on -ve edge, TDO in on +ve edge
+#define JTAG_SHIFT_BYTES        0x39
+#define JTAG_SHIFT_BITS         0x3B
+#define JTAG_TMS                0x4B
+#define JTAG_TMS_READ           0x6B
+#define JTAG_TMS_MAX_BITS       7
+
+// ADBUS0 TCK, ADBUS1 TDI, ADBUS2 TDO, ADBUS3 TMS
+#define JTAG_LOW_VALUE          0x08    // TMS high, TCK low
+#define JTAG_LOW_DIRECTION      0x0B
+
+#define JTAG_CHAIN_MAX          16      // default max devices for jtag/scan-chain
+
+typedef enum {
+    TAP_RESET, TAP_IDLE,
+    TAP_DRSELECT, TAP_DRCAPTURE, TAP_DRSHIFT, TAP_DREXIT1, TAP_DRPAUSE, TAP_DREXIT2, TAP_DRUPDATE,
+    TAP_IRSELECT, TAP_IRCAPTURE, TAP_IRSHIFT, TAP_IREXIT1, TAP_IRPAUSE, TAP_IREXIT2, TAP_IRUPDATE,
+    TAP_STATES
+} tap_state_t;
+
+static const char *tap_state_string[TAP_STATES] = {
+    "reset", "idle",
+    "dr-select", "dr-capture", "dr-shift", "dr-exit1", "dr-pause", "dr-exit2", "dr-update",
+    "ir-select", "ir-capture", "ir-shift", "ir-exit1", "ir-pause", "ir-exit2", "ir-update",
+};
+
+// Next TAP state for TMS = 0, and TMS = 1
+static const uint8_t tap_next[TAP_STATES][2] = {
+    {TAP_IDLE,      TAP_RESET},     // reset
+    {TAP_IDLE,      TAP_DRSELECT},  // idle
+    {TAP_DRCAPTURE, TAP_IRSELECT},  // dr-select
+    {TAP_DRSHIFT,   TAP_DREXIT1},   // dr-capture
+    {TAP_DRSHIFT,   TAP_DREXIT1},   // dr-shift
+    {TAP_DRPAUSE,   TAP_DRUPDATE},  // dr-exit1
+    {TAP_DRPAUSE,   TAP_DREXIT2},   // dr-pause
+    {TAP_DRSHIFT,   TAP_DRUPDATE},  // dr-exit2
+    {TAP_IDLE,      TAP_DRSELECT},  // dr-update
+    {TAP_IRCAPTURE, TAP_RESET},     // ir-select
+    {TAP_IRSHIFT,   TAP_IREXIT1},   // ir-capture
+    {TAP_IRSHIFT,   TAP_IREXIT1},   // ir-shift
+    {TAP_IRPAUSE,   TAP_IRUPDATE},  // ir-exit1
+    {TAP_IRPAUSE,   TAP_IREXIT2},   // ir-pause
+    {TAP_IRSHIFT,   TAP_IRUPDATE},  // ir-exit2
+    {TAP_IDLE,      TAP_DRSELECT},  // ir-update
+};
+
+typedef struct {
+    uint32_t        index;          // 1-based, as user-entered
+    uint32_t        id;             // unique id per-channel set by libmpsse
+    FT_HANDLE       handle;
+    err_mode_t      err_mode;       // how calls on the channel report their status
+    tap_state_t     state;          // TAP state at the end of the queued commands
+    mpsse_cmd_t     cmd;            // queued commands, sent by jtag/flush
+    uint32_t        *scans;         // bit length of each queued scan, to unpack TDO on flush
+    int32_t         scan_count;
+    int32_t         scan_capacity;
+} channel_t;
+
+static int  channel_get(void *p, Janet key, Janet *out);
+static int  channel_gc(void *p, size_t s);
+static void channel_marshal(void *p, JanetMarshalContext *ctx);
+static void *channel_unmarshal(JanetMarshalContext *ctx);
+static void channel_string(void *p, JanetBuffer *buffer);
+
+static const JanetAbstractType channel_type = {
+    "jtag/channel",
+    channel_gc,             // gc
+    NULL,                   // gcmark
+    channel_get,            // get
+    NULL,                   // put
+    channel_marshal,        // marshal
+    channel_unmarshal,      // unmarshal
+    channel_string,         // to-string
+    JANET_ATEND_TOSTRING
+};
+
+/***************/
+/* C Functions */
+/***************/
+
+// Save the FT return status to dyn :ft-err, and return the value directly.
+static Janet set_status_dyn(FT_STATUS status, Janet value) {
+    return ft_status(ERR_MODE_DYN, status, value);
+}
+
+// Report the status as set by the channel's err-mode
+static Janet channel_status(channel_t *c, FT_STATUS status, Janet value) {
+    return ft_status(c->err_mode, status, value);
+}
+
+static tap_state_t get_tap_state(const Janet *argv, int32_t n) {
+    JanetKeyword kw = janet_getkeyword(argv, n);
+    for (int i = 0; i < TAP_STATES; i++)
+        if (strcmp(kw, tap_state_string[i]) == 0)
+            return (tap_state_t)i;
+    janet_panicf("invalid TAP state %v", argv[n]);
+}
+
+/* Shortest TMS sequence from one TAP state to another, LSB first. No path
+    between any two states is longer than 8 bits. */
+static uint8_t tms_path(tap_state_t from, tap_state_t to, uint8_t *tms) {
+    int8_t prev[TAP_STATES];
+    uint8_t prev_tms[TAP_STATES];
+    uint8_t queue[TAP_STATES];
+    int head = 0, tail = 0;
+
+    memset(prev, -1, sizeof(prev));
+    prev[from] = from;
+    queue[tail++] = from;
+    while (head < tail && prev[to] < 0) {
+        uint8_t s = queue[head++];
+        for (int bit = 0; bit < 2; bit++) {
+            uint8_t n = tap_next[s][bit];
+            if (prev[n] < 0) {
+                prev[n] = s;
+                prev_tms[n] = bit;
+                queue[tail++] = n;
+            }
+        }
+    }
+
+    uint8_t len = 0;
+    *tms = 0;
+    for (uint8_t s = to; s != from; s = prev[s])
+        *tms = (*tms << 1) | prev_tms[s], len++;
+    return len;
+}
+
+static void queue_goto(channel_t *c, tap_state_t to) {
+    uint8_t tms = 0;
+    uint8_t len = tms_path(c->state, to, &tms);
+    while (len > 0) { // one TMS command clocks at most 7 bits
+        uint8_t n = len > JTAG_TMS_MAX_BITS ? JTAG_TMS_MAX_BITS : len;
+        mpsse_clock_bits(&c->cmd, JTAG_TMS, tms & ((1 << n) - 1), n, 0);
+        tms >>= n;
+        len -= n;
+    }
+    c->state = to;
+}
+
+static void queue_reset(channel_t *c) {
+    mpsse_clock_bits(&c->cmd, JTAG_TMS, 0x1F, 5, 0);
+    c->state = TAP_RESET;
+}
+
+static void queue_idle(channel_t *c, uint32_t cycles) {
+    queue_goto(c, TAP_IDLE);
+    while (cycles > 0) {
+        uint8_t n = cycles > JTAG_TMS_MAX_BITS ? JTAG_TMS_MAX_BITS : cycles;
+        mpsse_clock_bits(&c->cmd, JTAG_TMS, 0x00, n, 0);
+        cycles -= n;
+    }
+}
+
+/* Shift 'bits' of data through IR or DR, all but the last bit with byte and bit
+    commands, and the last one with TMS high to leave the shift state. TDO is captured. */
+static int32_t queue_scan(channel_t *c, tap_state_t shift, uint32_t bits, const uint8_t *data, tap_state_t end) {
+    queue_goto(c, shift);
+
+    uint32_t bytes = (bits - 1) / 8;
+    uint8_t rest = (bits - 1) % 8;
+    if (bytes > 0)
+        mpsse_clock_inout(&c->cmd, JTAG_SHIFT_BYTES, data, bytes);
+    if (rest > 0)
+        mpsse_clock_bits(&c->cmd, JTAG_SHIFT_BITS, data[bytes], rest, 1);
+    uint8_t last = (data[bytes] >> rest) & 0x01;
+    mpsse_clock_bits(&c->cmd, JTAG_TMS_READ, (last << 7) | 0x01, 1, 1);
+    c->state = tap_next[shift][1];
+    queue_goto(c, end);
+
+    if (c->scan_count == c->scan_capacity) {
+        int32_t capacity = c->scan_capacity ? c->scan_capacity * 2 : 16;
+        uint32_t *scans = janet_realloc(c->scans, capacity * sizeof(uint32_t));
+        if (NULL == scans)
+            janet_panic("out of memory");
+        c->scans = scans;
+        c->scan_capacity = capacity;
+    }
+    c->scans[c->scan_count] = bits;
+    return c->scan_count++;
+}
+
+/* Send the queue in one write, and unpack the TDO of each scan into its own buffer.
+    Bit commands shift TDO in from the top of the byte. */
+static FT_STATUS flush_scans(channel_t *c, JanetArray **out) {
+    uint32_t expect = c->cmd.read_count;
+    uint8_t *in = NULL;
+    if (expect > 0) {
+        in = janet_malloc(expect);
+        if (NULL == in)
+            janet_panic("out of memory");
+    }
+
+    FT_STATUS status = mpsse_transfer(c->handle, &c->cmd, in, NULL);
+    if (status == FT_OK) {
+        uint32_t r = 0;
+        *out = janet_array(c->scan_count);
+        for (int32_t i = 0; i < c->scan_count; i++) {
+            uint32_t bits = c->scans[i];
+            uint32_t bytes = (bits - 1) / 8;
+            uint8_t rest = (bits - 1) % 8;
+            JanetBuffer *tdo = janet_buffer((bits + 7) / 8);
+            memcpy(tdo->data, in + r, bytes);
+            r += bytes;
+            tdo->data[bytes] = 0;
+            if (rest > 0)
+                tdo->data[bytes] = in[r++] >> (8 - rest);
+            tdo->data[bytes] |= (in[r++] >> 7) << rest;
+            tdo->count = (bits + 7) / 8;
+            janet_array_push(*out, janet_wrap_buffer(tdo));
+        }
+    }
+    c->scan_count = 0;
+    janet_free(in);
+    return status;
+}
+
+JANET_FN(cfun_jtag_get_err,
+    "(jtag/err)",
+    "The return status of the last executed JTAG function as a keyword representing an error code. "
+    "When called as a method `(:err chan)`, the channel is ignored.\n\n"
+    "See `i2c/err` for the list of `FT_STATUS` keywords.\n\n"
+    "Note: currently a wrapper for (dyn :ft-err)") {
+    janet_arity(argc, 0, 1);
+    return janet_dyn("ft-err");
+}
+
+JANET_FN(cfun_jtag_err_mode,
+    "(jtag/err-mode channel &opt mode)",
+    "Get or set how calls on `channel` report their status. `mode` is one of:\n"
+    "* `:dyn`   - set `(dyn :ft-err)` as returned by `jtag/err`, and return the value (default)\n"
+    "* `:raise` - raise the status keyword on error, and return the value\n"
+    "* `:tuple` - return a tuple of `[value status]`\n\n"
+    "In `:raise` and `:tuple` modes the dynamic binding is not touched, which is cheaper in tight loops. "
+    "Functions not taking a channel (`open`, `info`...) always use `:dyn`.\n\n"
+    "Returns the channel's mode.") {
+    janet_arity(argc, 1, 2);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    if (argc > 1)
+        c->err_mode = ft_err_mode_get(argv, 1);
+    return ft_err_mode_keyword(c->err_mode);
+}
+
+JANET_FN(cfun_jtag_channelcount,
+    "(jtag/channels)",
+    "Get the number of MPSSE channels that are connected to the host system. "
+    "Sets `:err` to return status.\n\n"
+    "This function is **not thread-safe**.") {
+    janet_fixarity(argc, 0);
+
+    DWORD chans = 0;
+    FT_STATUS status = FT_GetNumChannels(JTAG, &chans);
+    return set_status_dyn(status, janet_wrap_integer(chans));
+}
+
+JANET_FN(cfun_jtag_getchannelinfo,
+    "(jtag/info index)",
+    "Retrieve detailed information about a JTAG channel, "
+    "given a 1-based channel `index`, or a `<jtag/channel>` object.\n"
+    "Returns `nil` on error. Sets `:err` to return status.\n\n"
+    "On success, returns the same table as `spi/info`.\n\n"
+    "This function is **not thread-safe**.") {
+    janet_fixarity(argc, 1);
+
+    uint32_t index = 0;
+    if (janet_type(argv[0]) == JANET_NUMBER) {
+        index = janet_getuinteger(argv, 0);
+        if (index < 1)
+            return set_status_dyn(FT_INVALID_HANDLE, janet_wrap_nil());
+    } else if (janet_type(argv[0]) == JANET_ABSTRACT) {
+        channel_t *p = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+        index = p->index;
+    } else
+        janet_panicf("invalid type, expected <jtag/channel> or index, got %t", argv[0]);
+
+    FT_DEVICE_LIST_INFO_NODE chaninfo;
+    FT_STATUS status = FT_GetChannelInfo(JTAG, --index, &chaninfo);
+    if (status != FT_OK)
+        return set_status_dyn(status, janet_wrap_nil());
+
+    JanetKV *out = janet_struct_begin(7);
+    janet_struct_put(out, janet_ckeywordv("serial"), janet_cstringv(chaninfo.SerialNumber));
+    janet_struct_put(out, janet_ckeywordv("description"), janet_cstringv(chaninfo.Description));
+    janet_struct_put(out, janet_ckeywordv("id"), janet_wrap_integer(chaninfo.ID));
+    janet_struct_put(out, janet_ckeywordv("locid"), janet_wrap_integer(chaninfo.LocId));
+    janet_struct_put(out, janet_ckeywordv("handle"), janet_wrap_pointer(chaninfo.ftHandle));
+    janet_struct_put(out, janet_ckeywordv("type"), janet_wrap_integer(chaninfo.Type));
+    janet_struct_put(out, janet_ckeywordv("flags"), janet_wrap_integer(chaninfo.Flags));
+
+    return set_status_dyn(FT_OK, janet_wrap_struct(janet_struct_end(out)));
+}
+
+JANET_FN(cfun_jtag_openchannel,
+    "(jtag/open index)",
+    "Open a channel by (1-based) `index`.\n\n"
+    "Returns a `<jtag/channel>` if succesful, or `nil` on error. Sets `:err` to return status.\n\n") {
+    janet_fixarity(argc, 1);
+
+    uint32_t index = janet_getuinteger(argv, 0);
+    if (index < 1)
+        return set_status_dyn(FT_INVALID_HANDLE, janet_wrap_nil());
+
+    channel_t *c = (channel_t *)janet_abstract(&channel_type, sizeof(channel_t));
+    mpsse_init(&c->cmd, 0);
+    c->index = index;
+    c->err_mode = ERR_MODE_DYN;
+    c->handle = NULL;
+    c->state = TAP_RESET;
+    c->scans = NULL;
+    c->scan_count = c->scan_capacity = 0;
+
+    FT_STATUS status = FT_OpenChannel(JTAG, (index - 1), &c->handle);
+    if (status != FT_OK)
+        return set_status_dyn(status, janet_wrap_nil());
+
+    FT_DEVICE_LIST_INFO_NODE chaninfo;
+    status = FT_GetChannelInfo(JTAG, (index - 1), &chaninfo);
+    if (status != FT_OK) { // bailout if we fail here
+        FT_CloseChannel(JTAG, c->handle);
+        c->handle = NULL;
+        janet_panicf("failed to get channel info on a newly opened channel: %s", ft_status_string[status]);
+    }
+    c->id = chaninfo.ID;
+
+    return set_status_dyn(FT_OK, janet_wrap_abstract(c));
+}
+
+JANET_FN(cfun_jtag_is_open,
+    "(jtag/is-open channel)",
+    "Returns true if a channel is open, or false if closed.") {
+    janet_fixarity(argc, 1);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    return janet_wrap_boolean((NULL == c->handle) ? FALSE : TRUE);
+}
+
+JANET_FN(cfun_jtag_initchannel,
+    "(jtag/init channel clockrate &opt latency)",
+    "Initialize an open `channel`, `clockrate` and optional `latency`, "
+    "then reset the TAP and move it to `:idle`. "
+    "Returns `true` if successful, or `false` on error. Sets :err to return status.\n\n"
+    "* clockrate   - 1 to 30,000,000 Hz\n"
+    "* latency     - 0 to 255 (default)\n\n"
+    "Note: TCK, TDI, TDO and TMS are ADBUS0 to 3.") {
+    janet_arity(argc, 2, 3);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+
+    uint32_t clock = janet_getuinteger(argv, 1);
+    if (clock < 1 || clock > 30000000)
+        janet_panicf("clockrate %d is out of range. Expected 1 to 30,000,000 Hz", clock);
+
+    uint32_t latency = janet_optinteger(argv, argc, 2, 255);
+    if (latency > 255)
+        janet_panicf("latency %d out of range. expected 0 to 255", latency);
+
+    if (NULL == c->handle)
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_boolean(FALSE));
+
+    FT_STATUS status = FT_InitChannel(JTAG, c->handle, clock, latency, 0, 0);
+    if (status != FT_OK)
+        return channel_status(c, status, janet_wrap_boolean(FALSE));
+
+    mpsse_clear(&c->cmd);
+    c->scan_count = 0;
+    mpsse_set_low(&c->cmd, JTAG_LOW_VALUE, JTAG_LOW_DIRECTION);
+    queue_reset(c);
+    queue_goto(c, TAP_IDLE);
+    status = mpsse_transfer(c->handle, &c->cmd, NULL, NULL);
+    return channel_status(c, status, janet_wrap_boolean(status == FT_OK? TRUE : FALSE));
+}
+
+JANET_FN(cfun_jtag_closechannel,
+    "(jtag/close channel)",
+    "Close an open `channel`. Anything still queued is discarded.\n\n"
+    "Returns `true` if successful, or `false` on error. Sets `:err` to return status.") {
+    janet_fixarity(argc, 1);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    if (NULL == c->handle)
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_boolean(FALSE));
+
+    FT_STATUS status = FT_CloseChannel(JTAG, c->handle);
+    c->handle = NULL;
+    mpsse_clear(&c->cmd);
+    c->scan_count = 0;
+    return channel_status(c, status, janet_wrap_boolean(status == FT_OK? TRUE : FALSE));
+}
+
+JANET_FN(cfun_jtag_state,
+    "(jtag/state channel)",
+    "The TAP state the channel will be in once the queue is flushed, as a keyword:\n\n"
+    "`:reset` `:idle`\n\n"
+    "`:dr-select` `:dr-capture` `:dr-shift` `:dr-exit1` `:dr-pause` `:dr-exit2` `:dr-update`\n\n"
+    "`:ir-select` `:ir-capture` `:ir-shift` `:ir-exit1` `:ir-pause` `:ir-exit2` `:ir-update`") {
+    janet_fixarity(argc, 1);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    return janet_ckeywordv(tap_state_string[c->state]);
+}
+
+JANET_FN(cfun_jtag_tms_path,
+    "(jtag/tms-path from to)",
+    "The shortest TMS sequence from TAP state `from` to `to`, as `jtag/queue` `:goto` clocks it. "
+    "States are as `jtag/state`.\n\n"
+    "Returns a tuple of the TMS bits, 0 or 1, in the order they are clocked.") {
+    janet_fixarity(argc, 2);
+
+    tap_state_t from = get_tap_state(argv, 0);
+    tap_state_t to = get_tap_state(argv, 1);
+    uint8_t tms = 0;
+    uint8_t len = tms_path(from, to, &tms);
+    Janet *bits = janet_tuple_begin(len);
+    for (uint8_t i = 0; i < len; i++)
+        bits[i] = janet_wrap_integer((tms >> i) & 1);
+    return janet_wrap_tuple(janet_tuple_end(bits));
+}
+
+static int32_t queue_scan_args(channel_t *c, tap_state_t shift, int32_t argc, Janet *argv, int32_t n) {
+    uint32_t bits = janet_getuinteger(argv, n);
+    if (bits < 1)
+        janet_panic("scan length must be greater than 0 bits");
+    JanetByteView data = janet_getbytes(argv, n + 1);
+    if (bits > (uint32_t)data.len * 8)
+        janet_panicf("scan length %d bits larger than data of %d bytes", bits, data.len);
+    tap_state_t end = TAP_IDLE;
+    if (argc > n + 2)
+        end = get_tap_state(argv, n + 2);
+    return queue_scan(c, shift, bits, data.bytes, end);
+}
+
+JANET_FN(cfun_jtag_queue,
+    "(jtag/queue channel kw & args)",
+    "Queue a JTAG operation, to be sent with the rest of the queue by `jtag/flush`:\n\n"
+    "* `:ir bits data &opt end`  - shift `bits` of `data` through the IR, then go to `end` (default `:idle`)\n"
+    "* `:dr bits data &opt end`  - the same through the DR\n"
+    "* `:goto state`             - move the TAP to `state` by the shortest TMS path\n"
+    "* `:reset`                  - hold TMS high for 5 clocks, to `:reset`\n"
+    "* `:idle cycles`            - clock `cycles` in `:idle`\n\n"
+    "`data` is bytes or a buffer, LSB first. "
+    "Returns the index of an IR/DR scan in the array returned by `jtag/flush`, otherwise `nil`.") {
+    janet_arity(argc, 2, 6);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    JanetKeyword kw = janet_getkeyword(argv, 1);
+    if (strcmp(kw, "ir") == 0) {
+        janet_arity(argc, 4, 5);
+        return janet_wrap_integer(queue_scan_args(c, TAP_IRSHIFT, argc, argv, 2));
+    } else if (strcmp(kw, "dr") == 0) {
+        janet_arity(argc, 4, 5);
+        return janet_wrap_integer(queue_scan_args(c, TAP_DRSHIFT, argc, argv, 2));
+    } else if (strcmp(kw, "goto") == 0) {
+        janet_fixarity(argc, 3);
+        queue_goto(c, get_tap_state(argv, 2));
+    } else if (strcmp(kw, "reset") == 0) {
+        janet_fixarity(argc, 2);
+        queue_reset(c);
+    } else if (strcmp(kw, "idle") == 0) {
+        janet_fixarity(argc, 3);
+        queue_idle(c, janet_getuinteger(argv, 2));
+    } else
+        janet_panicf("invalid JTAG queue operation %v", argv[1]);
+    return janet_wrap_nil();
+}
+
+JANET_FN(cfun_jtag_flush,
+    "(jtag/flush channel)",
+    "Send everything queued on `channel` in a single USB write, and read back the TDO of every scan.\n\n"
+    "Returns an array of buffers, one per queued IR/DR scan in order, or `nil` on error. "
+    "Sets `:err` to return status.\n\n"
+    "Note: on error the TAP state is unknown; queue a `:reset`.\n\n"
+    "This is a **blocking function**.") {
+    janet_fixarity(argc, 1);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    if (NULL == c->handle)
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_nil());
+
+    JanetArray *out = NULL;
+    FT_STATUS status = flush_scans(c, &out);
+    if (status != FT_OK)
+        return channel_status(c, status, janet_wrap_nil());
+    return channel_status(c, status, janet_wrap_array(out));
+}
+
+static Janet scan_now(channel_t *c, tap_state_t shift, int32_t argc, Janet *argv) {
+    if (NULL == c->handle)
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_nil());
+    int32_t i = queue_scan_args(c, shift, argc, argv, 1);
+
+    JanetArray *out = NULL;
+    FT_STATUS status = flush_scans(c, &out);
+    if (status != FT_OK)
+        return channel_status(c, status, janet_wrap_nil());
+    return channel_status(c, status, out->data[i]);
+}
+
+JANET_FN(cfun_jtag_ir,
+    "(jtag/ir channel bits data &opt end)",
+    "Shift `bits` of `data` through the IR, then go to `end` (default `:idle`), flushing the queue.\n\n"
+    "Returns a buffer of the TDO shifted out, or `nil` on error. Sets `:err` to return status.\n\n"
+    "This is a **blocking function**.") {
+    janet_arity(argc, 3, 4);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    return scan_now(c, TAP_IRSHIFT, argc, argv);
+}
+
+JANET_FN(cfun_jtag_dr,
+    "(jtag/dr channel bits data &opt end)",
+    "Shift `bits` of `data` through the DR, then go to `end` (default `:idle`), flushing the queue.\n\n"
+    "Returns a buffer of the TDO shifted out, or `nil` on error. Sets `:err` to return status.\n\n"
+    "This is a **blocking function**.") {
+    janet_arity(argc, 3, 4);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    return scan_now(c, TAP_DRSHIFT, argc, argv);
+}
+
+JANET_FN(cfun_jtag_scan_chain,
+    "(jtag/scan-chain channel &opt max)",
+    "Detect the devices on the chain: reset the TAP, which selects IDCODE (or BYPASS) on every device, "
+    "then shift ones through the DR until they come back out. Checks for up to `max` devices, default 16.\n\n"
+    "Returns an array of IDCODEs, nearest TDO first with 0 for a device in BYPASS, "
+    "or `nil` on error. Sets `:err` to return status, `:device-not-found` if the chain looks longer than `max`.\n\n"
+    "Note: the queue must be empty.\n\n"
+    "This is a **blocking function**.") {
+    janet_arity(argc, 1, 2);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    uint32_t max = janet_optinteger(argv, argc, 1, JTAG_CHAIN_MAX);
+    if (max < 1 || max > 1024)
+        janet_panicf("max devices %d out of range. Expected 1 to 1024", max);
+    if (c->cmd.count > 0 || c->scan_count > 0)
+        janet_panic("jtag queue must be flushed before scan-chain");
+    if (NULL == c->handle)
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_nil());
+
+    uint32_t bits = (max + 1) * 32;
+    uint8_t *ones = janet_smalloc(bits / 8);
+    memset(ones, 0xFF, bits / 8);
+    queue_reset(c);
+    queue_scan(c, TAP_DRSHIFT, bits, ones, TAP_IDLE);
+    janet_sfree(ones);
+
+    JanetArray *out = NULL;
+    FT_STATUS status = flush_scans(c, &out);
+    if (status != FT_OK)
+        return channel_status(c, status, janet_wrap_nil());
+
+    const uint8_t *tdo = janet_unwrap_buffer(out->data[0])->data;
+    JanetArray *chain = janet_array(4);
+    uint32_t p = 0;
+    while (p + 32 <= bits) {
+        if (!(tdo[p / 8] & (1 << (p % 8)))) { // BYPASS captures a 0
+            if ((uint32_t)chain->count == max)
+                return channel_status(c, FT_DEVICE_NOT_FOUND, janet_wrap_nil());
+            janet_array_push(chain, janet_wrap_integer(0));
+            p++;
+            continue;
+        }
+        uint32_t id = 0;
+        for (int b = 0; b < 32; b++, p++)
+            id |= (uint32_t)((tdo[p / 8] >> (p % 8)) & 0x01) << b;
+        if (id == 0xFFFFFFFF) // our own ones, the end of the chain
+            return channel_status(c, status, janet_wrap_array(chain));
+        if ((uint32_t)chain->count == max)
+            break;
+        janet_array_push(chain, janet_wrap_number((double)id));
+    }
+    return channel_status(c, FT_DEVICE_NOT_FOUND, janet_wrap_nil());
+}
+
+static JanetMethod channel_methods[] = {
+    {"err",             cfun_jtag_get_err},
+    {"err-mode",        cfun_jtag_err_mode},
+    {"info",            cfun_jtag_getchannelinfo},
+    {"is-open",         cfun_jtag_is_open},
+    {"close",           cfun_jtag_closechannel},
+    {"init",            cfun_jtag_initchannel},
+    {"state",           cfun_jtag_state},
+    {"queue",           cfun_jtag_queue},
+    {"flush",           cfun_jtag_flush},
+    {"ir",              cfun_jtag_ir},
+    {"dr",              cfun_jtag_dr},
+    {"scan-chain",      cfun_jtag_scan_chain},
+    {NULL,              NULL}
+};
+
+static int channel_get(void *p, Janet key, Janet *out) {
+    (void) p;
+    if (!janet_checktype(key, JANET_KEYWORD))
+        janet_panicf("expected keyword, but got %t", key);
+    return janet_getmethod(janet_unwrap_keyword(key), channel_methods, out);
+}
+
+static int channel_gc(void *p, size_t s) {
+    (void) s;
+    channel_t *c = (channel_t *)p;
+    FT_STATUS status = FT_DEVICE_NOT_OPENED;
+    if (c != NULL) {
+        // a closed channel, or one moved to another thread, has no handle
+        if (c->handle != NULL) {
+            status = FT_CloseChannel(JTAG, c->handle);
+            c->handle = NULL;
+        }
+        mpsse_deinit(&c->cmd);
+        janet_free(c->scans);
+        c->scans = NULL;
+    }
+    set_status_dyn(status, janet_wrap_nil());
+    return 0;
+}
+
+/* Channels move between threads (ev/thread, threaded channels): the handle is passed
+    as a pointer, which marshal only allows between threads of the same process, and the
+    sender's copy is left without one, as if closed. */
+static void channel_marshal(void *p, JanetMarshalContext *ctx) {
+    channel_t *c = (channel_t *)p;
+    if (c->scan_count > 0 || c->cmd.count > 0)
+        janet_panic("cannot move a jtag channel with queued commands, flush it first");
+    janet_marshal_abstract(ctx, p);
+    janet_marshal_int(ctx, (int32_t)c->index);
+    janet_marshal_int(ctx, (int32_t)c->id);
+    janet_marshal_ptr(ctx, c->handle);
+    janet_marshal_int(ctx, (int32_t)c->err_mode);
+    janet_marshal_int(ctx, (int32_t)c->state);
+    c->handle = NULL;
+}
+
+static void *channel_unmarshal(JanetMarshalContext *ctx) {
+    channel_t *c = (channel_t *)janet_unmarshal_abstract(ctx, sizeof(channel_t));
+    c->index = (uint32_t)janet_unmarshal_int(ctx);
+    c->id = (uint32_t)janet_unmarshal_int(ctx);
+    c->handle = (FT_HANDLE)janet_unmarshal_ptr(ctx);
+    c->err_mode = (err_mode_t)janet_unmarshal_int(ctx);
+    c->state = (tap_state_t)janet_unmarshal_int(ctx);
+    mpsse_init(&c->cmd, 0);
+    c->scans = NULL;
+    c->scan_count = c->scan_capacity = 0;
+    return c;
+}
+
+static void channel_string(void *p, JanetBuffer *buffer) {
+    channel_t *c = (channel_t *)p;
+    janet_formatb(buffer, "#%d 0x%X", c->index, c);
+}
+
+void jtag_register(JanetTable *env) {
+    JanetRegExt cfuns[] = {
+        JANET_REG("jtag/err",           cfun_jtag_get_err),
+        JANET_REG("jtag/err-mode",      cfun_jtag_err_mode),
+        JANET_REG("jtag/channels",      cfun_jtag_channelcount),
+        JANET_REG("jtag/info",          cfun_jtag_getchannelinfo),
+        JANET_REG("jtag/open",          cfun_jtag_openchannel),
+        JANET_REG("jtag/is-open",       cfun_jtag_is_open),
+        JANET_REG("jtag/init",          cfun_jtag_initchannel),
+        JANET_REG("jtag/close",         cfun_jtag_closechannel),
+        JANET_REG("jtag/state",         cfun_jtag_state),
+        JANET_REG("jtag/tms-path",      cfun_jtag_tms_path),
+        JANET_REG("jtag/queue",         cfun_jtag_queue),
+        JANET_REG("jtag/flush",         cfun_jtag_flush),
+        JANET_REG("jtag/ir",            cfun_jtag_ir),
+        JANET_REG("jtag/dr",            cfun_jtag_dr),
+        JANET_REG("jtag/scan-chain",    cfun_jtag_scan_chain),
+        JANET_REG_END
+    };
+    janet_cfuns_ext(env, "jtag", cfuns);
+    janet_register_abstract_type(&channel_type);
+}
@@ -21,18 +21,83 @@ const char *ft_status_string[] = { // FT_[error]
     "not-supported",
     "other-error",
     "device-list-not-ready",
+    "timeout", // 20, FT_TIMEOUT
 };
 
+#define FT_STATUS_COUNT (sizeof(ft_status_string) / sizeof(ft_status_string[0]))
+
+static const char *err_mode_string[] = {"dyn", "raise", "tuple"};
+
+/* Interned once per VM, so reporting a status never allocates. Keywords belong to the VM
+    of their thread, so each thread keeps its own set: at module entry, or on first use by a
+    thread that was given a channel without importing the module. */
+static JANET_THREAD_LOCAL Janet status_keywords[FT_STATUS_COUNT];
+static JANET_THREAD_LOCAL int status_interned = 0;
+
+static void status_intern(void) {
+    for (size_t i = 0; status_interned && i < FT_STATUS_COUNT; i++)
+        janet_gcunroot(status_keywords[i]);
+    for (size_t i = 0; i < FT_STATUS_COUNT; i++) {
+        status_keywords[i] = janet_ckeywordv(ft_status_string[i]);
+        janet_gcroot(status_keywords[i]);
+    }
+    status_interned = 1;
+}
+
+Janet ft_status_keyword(FT_STATUS status) {
+    if (!status_interned)
+        status_intern();
+    if (status >= FT_STATUS_COUNT)
+        status = FT_OTHER_ERROR;
+    return status_keywords[status];
+}
+
+Janet ft_status(err_mode_t mode, FT_STATUS status, Janet value) {
+    switch (mode) {
+    case ERR_MODE_RAISE:
+        if (status != FT_OK)
+            janet_panicv(ft_status_keyword(status));
+        return value;
+    case ERR_MODE_TUPLE: {
+        Janet vals[2] = {value, ft_status_keyword(status)};
+        return janet_wrap_tuple(janet_tuple_n(vals, 2));
+    }
+    default:
+        janet_setdyn("ft-err", ft_status_keyword(status));
+        return value;
+    }
+}
+
+err_mode_t ft_err_mode_get(const Janet *argv, int32_t n) {
+    JanetKeyword mode = janet_getkeyword(argv, n);
+    for (int i = 0; i < (int)(sizeof(err_mode_string) / sizeof(err_mode_string[0])); i++)
+        if (strcmp((const char *)mode, err_mode_string[i]) == 0)
+            return (err_mode_t)i;
+    janet_panicf("invalid error mode %v, expected :dyn, :raise or :tuple", argv[n]);
+}
+
+Janet ft_err_mode_keyword(err_mode_t mode) {
+    return janet_ckeywordv(err_mode_string[mode]);
+}
+
 /****************/
 /* Module Entry */
 /****************/
 
 JANET_MODULE_ENTRY(JanetTable *env) {
+    status_intern();    // afresh, in case an earlier VM of this thread has exited
+
     /* The I2C and SPI modules are nearly identical, but their headers
         have conflicting types (ChannelConfig) and have to be separated, yay
-        It does make it easier to add other modules in the future (ie, JTAG) */
+        It does make it easier to add other modules, such as JTAG, which has
+        no libMPSSE library and drives the middle layer directly */
     spi_register(env);
     i2c_register(env);
+    jtag_register(env);
+    flash_register(env);
+    eeprom_register(env);
+    regmap_register(env);
+    ft_register(env);
 
 #ifdef _MSC_VER
     Init_libMPSSE();
@@ -4,6 +4,123 @@
 #include "../LibMPSSE_1.0.7/release/libftd2xx/ftd2xx.h"
 
 extern const char *ft_status_string[];
+
+// Not a D2XX status: a call ran past its deadline, see <mod>/timeout
+#define FT_TIMEOUT              ((FT_STATUS)FT_DEVICE_LIST_NOT_READY + 1)
+
+// How a channel reports the FT_STATUS of each call, set with <mod>/err-mode
+typedef enum {
+    ERR_MODE_DYN,           // set (dyn :ft-err), and return the value
+    ERR_MODE_RAISE,         // raise the status keyword on error
+    ERR_MODE_TUPLE,         // return [value status]
+} err_mode_t;
+
+extern Janet ft_status_keyword(FT_STATUS status);
+extern Janet ft_status(err_mode_t mode, FT_STATUS status, Janet value);
+extern err_mode_t ft_err_mode_get(const Janet *argv, int32_t n);
+extern Janet ft_err_mode_keyword(err_mode_t mode);
+
+/* A read transaction compiled by a protocol module (i2c/transaction, spi/transaction),
+    with everything needed to run it again without touching the Janet VM, so it can
+    be run from another thread by ft/sampler. It can also be run in two halves, as
+    ft/await does: 'send' writes it and sets the bytes the device will reply with,
+    and 'receive' reads them once they're queued. */
+typedef struct transaction_s transaction_t;
+typedef FT_STATUS (*transaction_fn)(transaction_t *t, uint8_t *in);
+typedef FT_STATUS (*transaction_send_fn)(transaction_t *t, uint32_t *expect);
+
+struct transaction_s {
+    Janet               owner;      // <channel> or <device> the transaction runs on
+    FT_HANDLE           *handle;    // the owner channel's handle, NULL once closed
+    transaction_fn      run;
+    transaction_send_fn send;
+    transaction_fn      receive;
+    uint32_t            size;       // bytes read by each run
+    uint32_t            count;      // bytes of compiled data
+    uint8_t             data[];     // protocol specific, e.g. an MPSSE command stream
+};
+
+extern const JanetAbstractType transaction_type;
+extern Janet transaction_new(Janet owner, FT_HANDLE *handle, transaction_fn run,
+                             transaction_send_fn send, transaction_fn receive, uint32_t size,
+                             const uint8_t *data, uint32_t count);
+extern FT_STATUS transaction_run(transaction_t *t, uint8_t *in);
+
+/* A register map of a device (i2c/regmap, spi/regmap): a host-side shadow of its 8-bit
+    registers, so a bitfield update is one write, and reads of the registers the device
+    doesn't change itself are served from the shadow. 'read' and 'write' transfer 'n'
+    consecutive registers from 'reg' on the owner. */
+#define REGMAP_SIZE             256
+
+#define REGMAP_PLAN_MAX         32      // bursts in a plan, as i2c/poll takes
+
+typedef struct {
+    uint8_t             reg;
+    uint16_t            len;
+} regmap_burst_t;
+
+typedef struct regmap_s regmap_t;
+typedef FT_STATUS (*regmap_fn)(regmap_t *m, uint8_t reg, uint8_t *data, uint32_t n);
+// Compile burst reads of a plan into one <ft/transaction> reading 'size' bytes, see regmap/plan
+typedef FT_STATUS (*regmap_compile_fn)(regmap_t *m, const regmap_burst_t *bursts, int32_t n,
+                                       uint32_t size, Janet *out);
+
+struct regmap_s {
+    Janet               owner;      // <channel> or <device> the registers are on
+    err_mode_t          *err_mode;  // of the owner's channel, to report each call
+    regmap_fn           read;
+    regmap_fn           write;
+    regmap_compile_fn   compile;
+    uint32_t            address;    // protocol specific, e.g. the I2C device address
+    uint8_t             value[REGMAP_SIZE];
+    uint8_t             valid[REGMAP_SIZE / 8];     // bit set while the shadow holds a register
+    uint8_t             volatile_[REGMAP_SIZE / 8]; // bit set for registers always read from the device
+    uint32_t            reads;      // bus transfers
+    uint32_t            writes;
+    uint32_t            hits;       // registers served from the shadow
+    uint32_t            skipped;    // writes left out as the register already held the value
+};
+
+extern const JanetAbstractType regmap_type;
+extern Janet regmap_new(Janet owner, err_mode_t *err_mode, regmap_fn read, regmap_fn write,
+                        regmap_compile_fn compile, uint32_t address, int32_t argc, Janet *argv, int32_t n);
+
+/* A frame layout (ft/frame): how blocks of interleaved 16-bit sensor frames, such as a FIFO
+    drain or sampler ring, map to channels in physical units, each a word of the frame times
+    a scale plus an offset. */
+typedef struct {
+    Janet               name;
+    int32_t             word;       // of the frame
+    double              scale;
+    double              offset;
+} frame_channel_t;
+
+typedef struct {
+    int32_t             words;      // 16-bit words per frame
+    int32_t             little;     // words are little-endian, else big-endian
+    int32_t             is_unsigned; // words are unsigned, else signed
+    int32_t             count;      // channels
+    frame_channel_t     channels[];
+} frame_t;
+
+extern const JanetAbstractType frame_type;
+extern int32_t frame_channel(const frame_t *f, Janet name);
+extern void frame_convert(const frame_t *f, int32_t channel, const uint8_t *in, int32_t n, double *out);
+
+extern int64_t ft_monotonic_ns(void);
+extern FT_STATUS ft_deadline_status(FT_STATUS status, int64_t start, uint32_t ms);
+extern void ft_sampler_release(const void *p);
+
+/* Run 'fn' on each of 'count' jobs, 'size' bytes apart, from a pool of worker threads.
+    Jobs must not touch the Janet VM. Returns when all jobs are done. */
+typedef void (*ft_job_fn)(void *job);
+extern void ft_parallel(ft_job_fn fn, void *jobs, size_t size, int32_t count);
+
 extern void i2c_register(JanetTable*);
 extern void spi_register(JanetTable*);
+extern void jtag_register(JanetTable*);
+extern void flash_register(JanetTable*);
+extern void eeprom_register(JanetTable*);
+extern void regmap_register(JanetTable*);
+extern void ft_register(JanetTable*);
 #endif
\ No newline at end of file
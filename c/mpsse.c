@@ -0,0 +1,160 @@
+// MPSSE command stream builder, shared by the protocol modules
+
+#include "mpsse.h"
+#include "../LibMPSSE_1.0.7/release/source/ftdi_mid.h"
+
+void mpsse_init(mpsse_cmd_t *cmd, uint32_t capacity) {
+    cmd->data = NULL;
+    if (capacity > 0) {
+        cmd->data = janet_malloc(capacity);
+        if (NULL == cmd->data)
+            janet_panic("out of memory");
+    }
+    cmd->count = 0;
+    cmd->capacity = capacity;
+    cmd->read_count = 0;
+}
+
+void mpsse_deinit(mpsse_cmd_t *cmd) {
+    janet_free(cmd->data);
+    cmd->data = NULL;
+    cmd->count = cmd->capacity = cmd->read_count = 0;
+}
+
+void mpsse_clear(mpsse_cmd_t *cmd) {
+    cmd->count = 0;
+    cmd->read_count = 0;
+}
+
+static void mpsse_ensure(mpsse_cmd_t *cmd, uint32_t n) {
+    if (cmd->count + n <= cmd->capacity)
+        return;
+    uint32_t capacity = cmd->capacity ? cmd->capacity : 64;
+    while (capacity < cmd->count + n)
+        capacity *= 2;
+    uint8_t *data = janet_realloc(cmd->data, capacity);
+    if (NULL == data)
+        janet_panic("out of memory");
+    cmd->data = data;
+    cmd->capacity = capacity;
+}
+
+void mpsse_byte(mpsse_cmd_t *cmd, uint8_t b) {
+    mpsse_ensure(cmd, 1);
+    cmd->data[cmd->count++] = b;
+}
+
+void mpsse_set_low(mpsse_cmd_t *cmd, uint8_t value, uint8_t dir) {
+    mpsse_ensure(cmd, 3);
+    cmd->data[cmd->count++] = MPSSE_SET_LOW;
+    cmd->data[cmd->count++] = value;
+    cmd->data[cmd->count++] = dir;
+}
+
+void mpsse_set_high(mpsse_cmd_t *cmd, uint8_t value, uint8_t dir) {
+    mpsse_ensure(cmd, 3);
+    cmd->data[cmd->count++] = MPSSE_SET_HIGH;
+    cmd->data[cmd->count++] = value;
+    cmd->data[cmd->count++] = dir;
+}
+
+// Length of a clock data command is encoded as (size - 1), LSB first
+static void mpsse_clock_cmd(mpsse_cmd_t *cmd, uint8_t op, uint32_t size) {
+    mpsse_ensure(cmd, 3);
+    cmd->data[cmd->count++] = op;
+    cmd->data[cmd->count++] = (uint8_t)((size - 1) & 0xFF);
+    cmd->data[cmd->count++] = (uint8_t)(((size - 1) >> 8) & 0xFF);
+}
+
+void mpsse_clock_out(mpsse_cmd_t *cmd, uint8_t op, const uint8_t *data, uint32_t size) {
+    while (size > 0) {
+        uint32_t chunk = size > MPSSE_MAX_CHUNK ? MPSSE_MAX_CHUNK : size;
+        mpsse_clock_cmd(cmd, op, chunk);
+        mpsse_ensure(cmd, chunk);
+        memcpy(cmd->data + cmd->count, data, chunk);
+        cmd->count += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+void mpsse_clock_in(mpsse_cmd_t *cmd, uint8_t op, uint32_t size) {
+    while (size > 0) {
+        uint32_t chunk = size > MPSSE_MAX_CHUNK ? MPSSE_MAX_CHUNK : size;
+        mpsse_clock_cmd(cmd, op, chunk);
+        cmd->read_count += chunk;
+        size -= chunk;
+    }
+}
+
+void mpsse_clock_inout(mpsse_cmd_t *cmd, uint8_t op, const uint8_t *data, uint32_t size) {
+    while (size > 0) {
+        uint32_t chunk = size > MPSSE_MAX_CHUNK ? MPSSE_MAX_CHUNK : size;
+        mpsse_clock_cmd(cmd, op, chunk);
+        mpsse_ensure(cmd, chunk);
+        memcpy(cmd->data + cmd->count, data, chunk);
+        cmd->count += chunk;
+        cmd->read_count += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+// Clock for 'bytes' x 8 cycles with no data, a delay timed by the device rather than USB
+void mpsse_clock_idle(mpsse_cmd_t *cmd, uint32_t bytes) {
+    while (bytes > 0) {
+        uint32_t chunk = bytes > MPSSE_MAX_CHUNK ? MPSSE_MAX_CHUNK : bytes;
+        mpsse_clock_cmd(cmd, MPSSE_CLOCK_BYTES, chunk);
+        bytes -= chunk;
+    }
+}
+
+// Bit mode commands (and TMS commands) clock 1 to 8 bits of a single data byte
+void mpsse_clock_bits(mpsse_cmd_t *cmd, uint8_t op, uint8_t data, uint8_t bits, int read) {
+    mpsse_ensure(cmd, 3);
+    cmd->data[cmd->count++] = op;
+    cmd->data[cmd->count++] = (uint8_t)(bits - 1);
+    cmd->data[cmd->count++] = data;
+    if (read)
+        cmd->read_count++;
+}
+
+/* Send a complete command stream in one write, and if it returns data, read all
+    'readsz' bytes of it into 'in' with one read. Safe to call off the Janet thread. */
+FT_STATUS mpsse_run(FT_HANDLE handle, const uint8_t *data, uint32_t count, uint8_t *in, uint32_t readsz, uint32_t *transferred) {
+    FT_STATUS status = FT_OK;
+    DWORD n = 0;
+
+    if (transferred != NULL)
+        *transferred = 0;
+
+    // the mid-layer protocol argument is unused by FT_Channel_Write/Read
+    if (count > 0) {
+        status = FT_Channel_Write(SPI, handle, count, (uint8_t *)data, &n);
+        if (status == FT_OK && n != count)
+            status = FT_IO_ERROR;
+    }
+
+    if (status == FT_OK && readsz > 0) {
+        n = 0;
+        status = FT_Channel_Read(SPI, handle, readsz, in, &n);
+        if (transferred != NULL)
+            *transferred = n;
+        if (status == FT_OK && n != readsz)
+            status = FT_IO_ERROR;
+    }
+    return status;
+}
+
+/* Send the queued commands in one write, and if they return data, read all of it
+    into 'in' (at least cmd->read_count bytes) with one read.
+    The command buffer is cleared on return. */
+FT_STATUS mpsse_transfer(FT_HANDLE handle, mpsse_cmd_t *cmd, uint8_t *in, uint32_t *readsz) {
+    uint32_t expect = cmd->read_count;
+    if (expect > 0)
+        mpsse_byte(cmd, MPSSE_SEND_IMMEDIATE);
+
+    FT_STATUS status = mpsse_run(handle, cmd->data, cmd->count, in, expect, readsz);
+    mpsse_clear(cmd);
+    return status;
+}
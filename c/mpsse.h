@@ -0,0 +1,42 @@
+#ifndef _MPSSE_H_
+#define _MPSSE_H_
+#include "module.h"
+
+/* Raw MPSSE command streams, for transactions that libMPSSE would split into
+    several USB writes (or has no function for). Commands are appended to a
+    growable buffer, then sent with a single FT_Write, and whatever they return
+    is read back with a single FT_Read. */
+
+#define MPSSE_SET_LOW           0x80
+#define MPSSE_GET_LOW           0x81
+#define MPSSE_SET_HIGH          0x82
+#define MPSSE_SEND_IMMEDIATE    0x87
+#define MPSSE_CLOCK_BYTES       0x8F    // clock n x 8 bits with no data, FT232H/FT2232H/FT4232H only
+#define MPSSE_MAX_CHUNK         65536   // max length of one clock data command
+
+// SPI clock data commands (MSB first) for each mode, as used by libMPSSE
+#define MPSSE_SPI_OUT(mode)     (((mode) == 1 || (mode) == 2) ? 0x10 : 0x11)
+#define MPSSE_SPI_IN(mode)      (((mode) == 1 || (mode) == 2) ? 0x24 : 0x20)
+#define MPSSE_SPI_INOUT(mode)   (((mode) == 1 || (mode) == 2) ? 0x34 : 0x31)
+
+typedef struct {
+    uint8_t     *data;
+    uint32_t    count;
+    uint32_t    capacity;
+    uint32_t    read_count;     // bytes the queued commands will return
+} mpsse_cmd_t;
+
+extern void mpsse_init(mpsse_cmd_t *cmd, uint32_t capacity);
+extern void mpsse_deinit(mpsse_cmd_t *cmd);
+extern void mpsse_clear(mpsse_cmd_t *cmd);
+extern void mpsse_byte(mpsse_cmd_t *cmd, uint8_t b);
+extern void mpsse_set_low(mpsse_cmd_t *cmd, uint8_t value, uint8_t dir);
+extern void mpsse_set_high(mpsse_cmd_t *cmd, uint8_t value, uint8_t dir);
+extern void mpsse_clock_out(mpsse_cmd_t *cmd, uint8_t op, const uint8_t *data, uint32_t size);
+extern void mpsse_clock_in(mpsse_cmd_t *cmd, uint8_t op, uint32_t size);
+extern void mpsse_clock_inout(mpsse_cmd_t *cmd, uint8_t op, const uint8_t *data, uint32_t size);
+extern void mpsse_clock_idle(mpsse_cmd_t *cmd, uint32_t bytes);
+extern void mpsse_clock_bits(mpsse_cmd_t *cmd, uint8_t op, uint8_t data, uint8_t bits, int read);
+extern FT_STATUS mpsse_run(FT_HANDLE handle, const uint8_t *data, uint32_t count, uint8_t *in, uint32_t readsz, uint32_t *transferred);
+extern FT_STATUS mpsse_transfer(FT_HANDLE handle, mpsse_cmd_t *cmd, uint8_t *in, uint32_t *readsz);
+#endif
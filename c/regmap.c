@@ -0,0 +1,637 @@
+// Register maps: a host-side shadow of a device's configuration registers, over I2C or SPI
+
+#include "module.h"
+
+#define BIT_GET(bits, n)        ((bits)[(n) >> 3] & (1 << ((n) & 7)))
+#define BIT_SET(bits, n)        ((bits)[(n) >> 3] |= (uint8_t)(1 << ((n) & 7)))
+#define BIT_CLEAR(bits, n)      ((bits)[(n) >> 3] &= (uint8_t)~(1 << ((n) & 7)))
+
+static int  regmap_get(void *p, Janet key, Janet *out);
+static int  regmap_gcmark(void *p, size_t s);
+static int  plan_get(void *p, Janet key, Janet *out);
+static int  plan_gcmark(void *p, size_t s);
+
+const JanetAbstractType regmap_type = {
+    "regmap/map",
+    NULL,                   // gc
+    regmap_gcmark,          // gcmark
+    regmap_get,             // get
+    JANET_ATEND_GET
+};
+
+/* A read plan: the registers of a set of named fields, coalesced into as few burst reads as
+    the cost model allows, compiled into one transaction, with where each field lands in its reply. */
+typedef struct {
+    Janet           name;
+    uint32_t        reg;
+    uint32_t        len;
+    uint32_t        offset;         // in the transaction's reply
+} plan_field_t;
+
+typedef struct {
+    Janet           map;
+    Janet           transaction;    // <ft/transaction> of every burst
+    regmap_burst_t  bursts[REGMAP_PLAN_MAX];
+    int32_t         burst_count;
+    uint32_t        size;           // bytes read by the bursts
+    int32_t         field_count;
+    plan_field_t    fields[];
+} plan_t;
+
+static const JanetAbstractType plan_type = {
+    "regmap/plan",
+    NULL,                   // gc
+    plan_gcmark,            // gcmark
+    plan_get,               // get
+    JANET_ATEND_GET
+};
+
+// Report the status as set by the err-mode of the owner's channel
+static Janet regmap_status(regmap_t *m, FT_STATUS status, Janet value) {
+    return ft_status(*m->err_mode, status, value);
+}
+
+static uint8_t regmap_reg(const Janet *argv, int32_t n) {
+    uint32_t reg = janet_getuinteger(argv, n);
+    if (reg >= REGMAP_SIZE)
+        janet_panicf("register 0x%X is out of range. Expected an 8-bit register", reg);
+    return (uint8_t)reg;
+}
+
+static uint8_t regmap_byte(const Janet *argv, int32_t n) {
+    uint32_t b = janet_getuinteger(argv, n);
+    if (b > 255)
+        janet_panicf("value %d is out of range. Expected a byte", b);
+    return (uint8_t)b;
+}
+
+/* Set the bits of the registers of 'spec': an indexed of registers, and of [first last]
+    ranges of them, such as the sensor data and status registers. */
+static void regmap_spec(uint8_t *bits, Janet spec) {
+    JanetView v;
+    if (!janet_indexed_view(spec, &v.items, &v.len))
+        janet_panicf("expected an indexed of registers and [first last] ranges, got %v", spec);
+    for (int32_t i = 0; i < v.len; i++) {
+        JanetView range;
+        if (janet_checktype(v.items[i], JANET_NUMBER)) {
+            BIT_SET(bits, regmap_reg(v.items, i));
+        } else if (janet_indexed_view(v.items[i], &range.items, &range.len) && range.len == 2) {
+            uint8_t first = regmap_reg(range.items, 0);
+            uint8_t last = regmap_reg(range.items, 1);
+            for (uint32_t r = first; r <= last; r++)
+                BIT_SET(bits, r);
+        } else {
+            janet_panicf("register %v is invalid, expected a register or [first last]", v.items[i]);
+        }
+    }
+}
+
+Janet regmap_new(Janet owner, err_mode_t *err_mode, regmap_fn read, regmap_fn write,
+                 regmap_compile_fn compile, uint32_t address, int32_t argc, Janet *argv, int32_t n) {
+    regmap_t *m = (regmap_t *)janet_abstract(&regmap_type, sizeof(regmap_t));
+    memset(m, 0, sizeof(regmap_t));
+    m->owner = owner;
+    m->err_mode = err_mode;
+    m->read = read;
+    m->write = write;
+    m->compile = compile;
+    m->address = address;
+    if (argc > n && !janet_checktype(argv[n], JANET_NIL))
+        regmap_spec(m->volatile_, argv[n]);
+    return janet_wrap_abstract(m);
+}
+
+// True if every register of the span is in the shadow, and not volatile
+static BOOL regmap_cached(regmap_t *m, uint32_t reg, uint32_t n) {
+    for (uint32_t r = reg; r < reg + n; r++)
+        if (!BIT_GET(m->valid, r) || BIT_GET(m->volatile_, r))
+            return FALSE;
+    return TRUE;
+}
+
+// Keep what was read or written in the shadow, except the volatile registers
+static void regmap_store(regmap_t *m, uint32_t reg, const uint8_t *data, uint32_t n) {
+    for (uint32_t r = reg; r < reg + n; r++) {
+        if (BIT_GET(m->volatile_, r))
+            continue;
+        m->value[r] = data[r - reg];
+        BIT_SET(m->valid, r);
+    }
+}
+
+// Read a span from the shadow if it's all there, otherwise from the device in one transfer
+static FT_STATUS regmap_read(regmap_t *m, uint32_t reg, uint8_t *data, uint32_t n) {
+    if (regmap_cached(m, reg, n)) {
+        memcpy(data, m->value + reg, n);
+        m->hits += n;
+        return FT_OK;
+    }
+    m->reads++;
+    FT_STATUS status = m->read(m, (uint8_t)reg, data, n);
+    if (status == FT_OK)
+        regmap_store(m, reg, data, n);
+    return status;
+}
+
+static FT_STATUS regmap_write(regmap_t *m, uint32_t reg, uint8_t *data, uint32_t n) {
+    m->writes++;
+    FT_STATUS status = m->write(m, (uint8_t)reg, data, n);
+    if (status == FT_OK)
+        regmap_store(m, reg, data, n);
+    else // the device may or may not have taken it
+        for (uint32_t r = reg; r < reg + n; r++)
+            BIT_CLEAR(m->valid, r);
+    return status;
+}
+
+// Check a span of 'n' registers from 'reg' fits the map
+static void regmap_span(uint32_t reg, uint32_t n) {
+    if (n < 1 || reg + n > REGMAP_SIZE)
+        janet_panicf("%d registers from 0x%X is out of range", n, reg);
+}
+
+JANET_FN(cfun_regmap_get,
+    "(regmap/get map reg)",
+    "The value of register `reg`, from the shadow if it holds it and the register isn't volatile, "
+    "otherwise read from the device.\n\n"
+    "Returns the byte, or `nil` on error. Sets `:err` to return status.") {
+    janet_fixarity(argc, 2);
+
+    regmap_t *m = (regmap_t *)janet_getabstract(argv, 0, &regmap_type);
+    uint8_t reg = regmap_reg(argv, 1);
+    uint8_t value = 0;
+    FT_STATUS status = regmap_read(m, reg, &value, 1);
+    return regmap_status(m, status, (status == FT_OK) ? janet_wrap_integer(value) : janet_wrap_nil());
+}
+
+JANET_FN(cfun_regmap_read,
+    "(regmap/read map reg n &opt buffer)",
+    "Read & append `n` consecutive registers from `reg` to `buffer`. They come from the shadow "
+    "if it holds every one of them and none is volatile, otherwise from one burst read of the "
+    "device, which also fills the shadow.\n\n"
+    "Returns the buffer, or `nil` on error. Sets `:err` to return status.") {
+    janet_arity(argc, 3, 4);
+
+    regmap_t *m = (regmap_t *)janet_getabstract(argv, 0, &regmap_type);
+    uint8_t reg = regmap_reg(argv, 1);
+    uint32_t n = janet_getuinteger(argv, 2);
+    regmap_span(reg, n);
+    JanetBuffer *buffer = (argc > 3) ? janet_getbuffer(argv, 3) : janet_buffer(n);
+    janet_buffer_extra(buffer, n);
+
+    FT_STATUS status = regmap_read(m, reg, buffer->data + buffer->count, n);
+    if (status != FT_OK)
+        return regmap_status(m, status, janet_wrap_nil());
+    buffer->count += n;
+    return regmap_status(m, status, janet_wrap_buffer(buffer));
+}
+
+JANET_FN(cfun_regmap_set,
+    "(regmap/set map reg value)",
+    "Write the byte `value` to register `reg`, and keep it in the shadow.\n\n"
+    "Returns true, or false on error. Sets `:err` to return status.") {
+    janet_fixarity(argc, 3);
+
+    regmap_t *m = (regmap_t *)janet_getabstract(argv, 0, &regmap_type);
+    uint8_t reg = regmap_reg(argv, 1);
+    uint8_t value = regmap_byte(argv, 2);
+    FT_STATUS status = regmap_write(m, reg, &value, 1);
+    return regmap_status(m, status, janet_wrap_boolean(status == FT_OK));
+}
+
+JANET_FN(cfun_regmap_write,
+    "(regmap/write map reg bytes)",
+    "Write `bytes` to consecutive registers from `reg` in one transfer, and keep them in the shadow.\n\n"
+    "Returns true, or false on error. Sets `:err` to return status.") {
+    janet_fixarity(argc, 3);
+
+    regmap_t *m = (regmap_t *)janet_getabstract(argv, 0, &regmap_type);
+    uint8_t reg = regmap_reg(argv, 1);
+    JanetByteView bytes = janet_getbytes(argv, 2);
+    regmap_span(reg, (uint32_t)bytes.len);
+    FT_STATUS status = regmap_write(m, reg, (uint8_t *)bytes.bytes, (uint32_t)bytes.len);
+    return regmap_status(m, status, janet_wrap_boolean(status == FT_OK));
+}
+
+JANET_FN(cfun_regmap_update,
+    "(regmap/update map reg mask value)",
+    "Set the bits of register `reg` in `mask` to those of `value`, leaving the others. The current "
+    "value comes from the shadow when it holds it, so the update is a single write, and no "
+    "transfer at all if the register already has those bits. Otherwise it is read first, and "
+    "not written if it already has them.\n\n"
+    "Returns the register's new value, or `nil` on error. Sets `:err` to return status.") {
+    janet_fixarity(argc, 4);
+
+    regmap_t *m = (regmap_t *)janet_getabstract(argv, 0, &regmap_type);
+    uint8_t reg = regmap_reg(argv, 1);
+    uint8_t mask = regmap_byte(argv, 2);
+    uint8_t value = regmap_byte(argv, 3);
+
+    uint8_t old = 0;
+    FT_STATUS status = regmap_read(m, reg, &old, 1);
+    if (status != FT_OK)
+        return regmap_status(m, status, janet_wrap_nil());
+
+    uint8_t new = (uint8_t)((old & ~mask) | (value & mask));
+    if (new == old) {
+        m->skipped++;
+        return regmap_status(m, status, janet_wrap_integer(new));
+    }
+    status = regmap_write(m, reg, &new, 1);
+    return regmap_status(m, status, (status == FT_OK) ? janet_wrap_integer(new) : janet_wrap_nil());
+}
+
+JANET_FN(cfun_regmap_sync,
+    "(regmap/sync map first last)",
+    "Fill the shadow with registers `first` to `last` in one burst read, e.g. the configuration "
+    "registers on init. Don't include registers that reading changes, such as a FIFO.\n\n"
+    "Returns true, or false on error. Sets `:err` to return status.") {
+    janet_fixarity(argc, 3);
+
+    regmap_t *m = (regmap_t *)janet_getabstract(argv, 0, &regmap_type);
+    uint8_t first = regmap_reg(argv, 1);
+    uint8_t last = regmap_reg(argv, 2);
+    if (last < first)
+        janet_panicf("register range 0x%X to 0x%X is invalid", first, last);
+
+    uint8_t data[REGMAP_SIZE];
+    uint32_t n = last - first + 1;
+    m->reads++;
+    FT_STATUS status = m->read(m, first, data, n);
+    if (status == FT_OK)
+        regmap_store(m, first, data, n);
+    return regmap_status(m, status, janet_wrap_boolean(status == FT_OK));
+}
+
+JANET_FN(cfun_regmap_invalidate,
+    "(regmap/invalidate map &opt reg)",
+    "Drop register `reg`, or every register, from the shadow, so it's read from the device next. "
+    "Needed after the device changes registers on its own, e.g. a reset.\n\n"
+    "Returns `map`.") {
+    janet_arity(argc, 1, 2);
+
+    regmap_t *m = (regmap_t *)janet_getabstract(argv, 0, &regmap_type);
+    if (argc > 1)
+        BIT_CLEAR(m->valid, regmap_reg(argv, 1));
+    else
+        memset(m->valid, 0, sizeof(m->valid));
+    return argv[0];
+}
+
+JANET_FN(cfun_regmap_volatile,
+    "(regmap/volatile map reg &opt on)",
+    "Mark register `reg` as volatile, always read from the device, or not if `on` is false. "
+    "Volatile registers can also be given as a list when the map is made.\n\n"
+    "Returns whether the register is volatile.") {
+    janet_arity(argc, 2, 3);
+
+    regmap_t *m = (regmap_t *)janet_getabstract(argv, 0, &regmap_type);
+    uint8_t reg = regmap_reg(argv, 1);
+    if (argc > 2) {
+        if (janet_truthy(argv[2]))
+            BIT_SET(m->volatile_, reg);
+        else
+            BIT_CLEAR(m->volatile_, reg);
+    }
+    return janet_wrap_boolean(BIT_GET(m->volatile_, reg) != 0);
+}
+
+JANET_FN(cfun_regmap_stats,
+    "(regmap/stats map)",
+    "Counts of the bus `:reads` and `:writes` made, the registers served from the shadow as `:hits`, "
+    "and the updates `:skipped` as the register already held the value.") {
+    janet_fixarity(argc, 1);
+
+    regmap_t *m = (regmap_t *)janet_getabstract(argv, 0, &regmap_type);
+    uint32_t cached = 0;
+    for (int i = 0; i < REGMAP_SIZE; i++)
+        if (BIT_GET(m->valid, i))
+            cached++;
+    JanetKV *st = janet_struct_begin(5);
+    janet_struct_put(st, janet_ckeywordv("reads"), janet_wrap_number(m->reads));
+    janet_struct_put(st, janet_ckeywordv("writes"), janet_wrap_number(m->writes));
+    janet_struct_put(st, janet_ckeywordv("hits"), janet_wrap_number(m->hits));
+    janet_struct_put(st, janet_ckeywordv("skipped"), janet_wrap_number(m->skipped));
+    janet_struct_put(st, janet_ckeywordv("cached"), janet_wrap_number(cached));
+    return janet_wrap_struct(janet_struct_end(st));
+}
+
+/* Coalesce the wanted registers into bursts. With a cost of 'overhead' bytes per burst,
+    reading a gap of n registers to join two bursts pays if n <= overhead, and each gap is
+    independent of the others, so joining every such gap (that 'avoid' allows) is the cheapest
+    plan. Past REGMAP_PLAN_MAX bursts, the smallest gaps are joined whatever they cost. */
+static int32_t plan_coalesce(const uint8_t *wanted, const uint8_t *avoid, uint32_t overhead,
+                             regmap_burst_t *bursts, int32_t max) {
+    uint32_t first[REGMAP_SIZE], last[REGMAP_SIZE];
+    int32_t n = 0;
+    for (uint32_t r = 0; r < REGMAP_SIZE; r++) {
+        if (!BIT_GET(wanted, r))
+            continue;
+        if (n > 0 && last[n - 1] + 1 == r)
+            last[n - 1] = r;
+        else {
+            first[n] = last[n] = r;
+            n++;
+        }
+    }
+
+    for (;;) {
+        // the cheapest gap left to join, one the cost model takes first, then any once over 'max'
+        int32_t best = -1;
+        uint32_t best_gap = 0;
+        for (int32_t i = 0; i + 1 < n; i++) {
+            uint32_t gap = first[i + 1] - last[i] - 1;
+            BOOL allowed = TRUE;
+            for (uint32_t r = last[i] + 1; r < first[i + 1]; r++)
+                if (BIT_GET(avoid, r))
+                    allowed = FALSE;
+            if (!allowed || (gap > overhead && n <= max))
+                continue;
+            if (best < 0 || gap < best_gap) {
+                best = i;
+                best_gap = gap;
+            }
+        }
+        if (best < 0)
+            break;
+        last[best] = last[best + 1];
+        memmove(first + best + 1, first + best + 2, (n - best - 2) * sizeof(uint32_t));
+        memmove(last + best + 1, last + best + 2, (n - best - 2) * sizeof(uint32_t));
+        n--;
+    }
+    if (n > max)
+        return -1;
+
+    for (int32_t i = 0; i < n; i++) {
+        bursts[i].reg = (uint8_t)first[i];
+        bursts[i].len = (uint16_t)(last[i] - first[i] + 1);
+    }
+    return n;
+}
+
+/* Set the registers of 'fields' in 'wanted', and keep each in 'out' if given. Returns the
+    number of fields. */
+static int32_t plan_fields(JanetDictView fields, uint8_t *wanted, plan_field_t *out) {
+    int32_t count = 0;
+    for (int32_t i = 0; i < fields.cap; i++) {
+        const JanetKV *kv = fields.kvs + i;
+        if (janet_checktype(kv->key, JANET_NIL))
+            continue;
+        uint32_t reg, len = 1;
+        JanetView span;
+        if (janet_checktype(kv->value, JANET_NUMBER)) {
+            reg = regmap_reg(&kv->value, 0);
+        } else if (janet_indexed_view(kv->value, &span.items, &span.len) && span.len == 2) {
+            reg = regmap_reg(span.items, 0);
+            len = janet_getuinteger(span.items, 1);
+            regmap_span(reg, len);
+        } else {
+            janet_panicf("field %v is invalid, expected a register or [reg len]", kv->key);
+        }
+        for (uint32_t r = reg; r < reg + len; r++)
+            BIT_SET(wanted, r);
+        if (NULL != out) {
+            out[count].name = kv->key;
+            out[count].reg = reg;
+            out[count].len = len;
+        }
+        count++;
+    }
+    if (count < 1)
+        janet_panic("expected at least one field");
+    return count;
+}
+
+// The bursts of 'fields', with the optional overhead & avoid at argv[n] and argv[n + 1]
+static int32_t plan_bursts(JanetDictView fields, int32_t argc, Janet *argv, int32_t n,
+                           regmap_burst_t *bursts, plan_field_t *out, int32_t *field_count) {
+    uint32_t overhead = (uint32_t)janet_optnat(argv, argc, n, 4);
+    uint8_t avoid[REGMAP_SIZE / 8] = {0};
+    if (argc > n + 1 && !janet_checktype(argv[n + 1], JANET_NIL))
+        regmap_spec(avoid, argv[n + 1]);
+
+    uint8_t wanted[REGMAP_SIZE / 8] = {0};
+    *field_count = plan_fields(fields, wanted, out);
+    int32_t count = plan_coalesce(wanted, avoid, overhead, bursts, REGMAP_PLAN_MAX);
+    if (count < 0)
+        janet_panicf("fields need more than %d bursts", REGMAP_PLAN_MAX);
+    return count;
+}
+
+static Janet plan_burst_tuple(const regmap_burst_t *bursts, int32_t n) {
+    Janet *tuple = janet_tuple_begin(n);
+    for (int32_t i = 0; i < n; i++) {
+        Janet b[2] = {janet_wrap_integer(bursts[i].reg), janet_wrap_integer(bursts[i].len)};
+        tuple[i] = janet_wrap_tuple(janet_tuple_n(b, 2));
+    }
+    return janet_wrap_tuple(janet_tuple_end(tuple));
+}
+
+JANET_FN(cfun_regmap_bursts,
+    "(regmap/bursts fields &opt overhead avoid)",
+    "The burst reads `regmap/plan` would make of `fields`, without a map, as a tuple of `[reg len]`.") {
+    janet_arity(argc, 1, 3);
+
+    JanetDictView fields = janet_getdictionary(argv, 0);
+    regmap_burst_t bursts[REGMAP_PLAN_MAX];
+    int32_t field_count = 0;
+    int32_t n = plan_bursts(fields, argc, argv, 1, bursts, NULL, &field_count);
+    return plan_burst_tuple(bursts, n);
+}
+
+JANET_FN(cfun_regmap_plan,
+    "(regmap/plan map fields &opt overhead avoid)",
+    "Plan the reads of a scattered set of registers read together, e.g. the status, data and "
+    "interrupt registers polled each cycle. `fields` is a struct or table of names to a register, "
+    "or to `[reg len]` for `len` consecutive registers.\n\n"
+    "The registers are coalesced into as few burst reads as pays: `overhead` is what a burst costs "
+    "over the registers it reads, in bytes (default 4, about the start, address and register bytes "
+    "of an I2C read), and gaps of up to that many registers are read and dropped rather than "
+    "starting another burst. Gaps holding a register of `avoid`, given as for the volatile registers "
+    "of `i2c/regmap`, e.g. a FIFO or a register that reading clears, are never read. At most "
+    "32 bursts. `regmap/bursts` gives the bursts of `fields` without a map.\n\n"
+    "The bursts are compiled into one `<ft/transaction>` of the map's device, so reading the plan is one "
+    "USB write and one read, see `regmap/plan-read`.\n\n"
+    "Returns a `<regmap/plan>`, or `nil` on error. Sets `:err` to return status.") {
+    janet_arity(argc, 2, 4);
+
+    regmap_t *m = (regmap_t *)janet_getabstract(argv, 0, &regmap_type);
+    JanetDictView fields = janet_getdictionary(argv, 1);
+
+    plan_t *plan = (plan_t *)janet_abstract(&plan_type, sizeof(plan_t) + fields.len * sizeof(plan_field_t));
+    memset(plan, 0, sizeof(plan_t));
+    plan->map = argv[0];
+    plan->transaction = janet_wrap_nil();
+    plan->burst_count = plan_bursts(fields, argc, argv, 2, plan->bursts, plan->fields, &plan->field_count);
+
+    uint32_t offsets[REGMAP_PLAN_MAX];
+    for (int32_t i = 0; i < plan->burst_count; i++) {
+        offsets[i] = plan->size;
+        plan->size += plan->bursts[i].len;
+    }
+    for (int32_t i = 0; i < plan->field_count; i++) {
+        plan_field_t *f = &plan->fields[i];
+        int32_t b = 0;
+        while (f->reg >= (uint32_t)plan->bursts[b].reg + plan->bursts[b].len)
+            b++;
+        f->offset = offsets[b] + f->reg - plan->bursts[b].reg;
+    }
+
+    FT_STATUS status = m->compile(m, plan->bursts, plan->burst_count, plan->size, &plan->transaction);
+    if (status != FT_OK)
+        return regmap_status(m, status, janet_wrap_nil());
+    return regmap_status(m, status, janet_wrap_abstract(plan));
+}
+
+// Keep the plan's reply in the shadow, and set its fields in 'table'
+static Janet plan_scatter(plan_t *plan, const uint8_t *data, JanetTable *table) {
+    regmap_t *m = (regmap_t *)janet_unwrap_abstract(plan->map);
+    const uint8_t *d = data;
+    for (int32_t i = 0; i < plan->burst_count; i++) {
+        regmap_store(m, plan->bursts[i].reg, d, plan->bursts[i].len);
+        d += plan->bursts[i].len;
+    }
+
+    // a multi-byte field's buffer is refilled, so a table can be scattered into every cycle
+    for (int32_t i = 0; i < plan->field_count; i++) {
+        plan_field_t *f = &plan->fields[i];
+        if (f->len == 1) {
+            janet_table_put(table, f->name, janet_wrap_integer(data[f->offset]));
+            continue;
+        }
+        Janet old = janet_table_get(table, f->name);
+        JanetBuffer *b = janet_checktype(old, JANET_BUFFER) ? janet_unwrap_buffer(old) : janet_buffer(f->len);
+        b->count = 0;
+        janet_buffer_push_bytes(b, data + f->offset, f->len);
+        janet_table_put(table, f->name, janet_wrap_buffer(b));
+    }
+    return janet_wrap_table(table);
+}
+
+JANET_FN(cfun_regmap_plan_read,
+    "(regmap/plan-read plan &opt table)",
+    "Run the plan's transaction, and set each field in `table`: a single register as its byte, and "
+    "a span as a buffer of its bytes, refilled in place when `table` already has one. The registers "
+    "read are kept in the shadow, except the volatile ones.\n\n"
+    "Returns the table, or `nil` on error. Sets `:err` to return status.\n\n"
+    "Note: the transaction isn't retried, and runs without the channel's timeout.") {
+    janet_arity(argc, 1, 2);
+
+    plan_t *plan = (plan_t *)janet_getabstract(argv, 0, &plan_type);
+    regmap_t *m = (regmap_t *)janet_unwrap_abstract(plan->map);
+    JanetTable *table = (argc > 1) ? janet_gettable(argv, 1) : janet_table(plan->field_count);
+
+    uint8_t data[REGMAP_SIZE];
+    m->reads++;
+    FT_STATUS status = transaction_run((transaction_t *)janet_unwrap_abstract(plan->transaction), data);
+    if (status != FT_OK)
+        return regmap_status(m, status, janet_wrap_nil());
+    return regmap_status(m, status, plan_scatter(plan, data, table));
+}
+
+JANET_FN(cfun_regmap_plan_scatter,
+    "(regmap/plan-scatter plan bytes &opt table)",
+    "Set the fields of a reply to the plan's transaction in `table`, as `regmap/plan-read` does, "
+    "for a reply from `ft/await` or `ft/sampler`.\n\n"
+    "Returns the table.") {
+    janet_arity(argc, 2, 3);
+
+    plan_t *plan = (plan_t *)janet_getabstract(argv, 0, &plan_type);
+    JanetByteView bytes = janet_getbytes(argv, 1);
+    if ((uint32_t)bytes.len < plan->size)
+        janet_panicf("reply of %d bytes is too short, the plan reads %d", bytes.len, plan->size);
+    JanetTable *table = (argc > 2) ? janet_gettable(argv, 2) : janet_table(plan->field_count);
+    return plan_scatter(plan, bytes.bytes, table);
+}
+
+JANET_FN(cfun_regmap_plan_transaction,
+    "(regmap/plan-transaction plan)",
+    "The plan's compiled `<ft/transaction>`, to run with `ft/await` or `ft/sampler`.") {
+    janet_fixarity(argc, 1);
+
+    plan_t *plan = (plan_t *)janet_getabstract(argv, 0, &plan_type);
+    return plan->transaction;
+}
+
+JANET_FN(cfun_regmap_plan_bursts,
+    "(regmap/plan-bursts plan)",
+    "The plan's burst reads, as a tuple of `[reg len]`.") {
+    janet_fixarity(argc, 1);
+
+    plan_t *plan = (plan_t *)janet_getabstract(argv, 0, &plan_type);
+    return plan_burst_tuple(plan->bursts, plan->burst_count);
+}
+
+static JanetMethod regmap_methods[] = {
+    {"get",             cfun_regmap_get},
+    {"read",            cfun_regmap_read},
+    {"set",             cfun_regmap_set},
+    {"write",           cfun_regmap_write},
+    {"update",          cfun_regmap_update},
+    {"sync",            cfun_regmap_sync},
+    {"invalidate",      cfun_regmap_invalidate},
+    {"volatile",        cfun_regmap_volatile},
+    {"stats",           cfun_regmap_stats},
+    {"plan",            cfun_regmap_plan},
+    {NULL,              NULL}
+};
+
+static JanetMethod plan_methods[] = {
+    {"read",            cfun_regmap_plan_read},
+    {"scatter",         cfun_regmap_plan_scatter},
+    {"transaction",     cfun_regmap_plan_transaction},
+    {"bursts",          cfun_regmap_plan_bursts},
+    {NULL,              NULL}
+};
+
+static int regmap_get(void *p, Janet key, Janet *out) {
+    (void) p;
+    if (!janet_checktype(key, JANET_KEYWORD))
+        janet_panicf("expected keyword, but got %t", key);
+    return janet_getmethod(janet_unwrap_keyword(key), regmap_methods, out);
+}
+
+static int regmap_gcmark(void *p, size_t s) {
+    (void) s;
+    janet_mark(((regmap_t *)p)->owner);
+    return 0;
+}
+
+static int plan_get(void *p, Janet key, Janet *out) {
+    (void) p;
+    if (!janet_checktype(key, JANET_KEYWORD))
+        janet_panicf("expected keyword, but got %t", key);
+    return janet_getmethod(janet_unwrap_keyword(key), plan_methods, out);
+}
+
+static int plan_gcmark(void *p, size_t s) {
+    (void) s;
+    plan_t *plan = (plan_t *)p;
+    janet_mark(plan->map);
+    janet_mark(plan->transaction);
+    for (int32_t i = 0; i < plan->field_count; i++)
+        janet_mark(plan->fields[i].name);
+    return 0;
+}
+
+void regmap_register(JanetTable *env) {
+    JanetRegExt cfuns[] = {
+        JANET_REG("regmap/get",         cfun_regmap_get),
+        JANET_REG("regmap/read",        cfun_regmap_read),
+        JANET_REG("regmap/set",         cfun_regmap_set),
+        JANET_REG("regmap/write",       cfun_regmap_write),
+        JANET_REG("regmap/update",      cfun_regmap_update),
+        JANET_REG("regmap/sync",        cfun_regmap_sync),
+        JANET_REG("regmap/invalidate",  cfun_regmap_invalidate),
+        JANET_REG("regmap/volatile",    cfun_regmap_volatile),
+        JANET_REG("regmap/stats",       cfun_regmap_stats),
+        JANET_REG("regmap/bursts",      cfun_regmap_bursts),
+        JANET_REG("regmap/plan",        cfun_regmap_plan),
+        JANET_REG("regmap/plan-read",   cfun_regmap_plan_read),
+        JANET_REG("regmap/plan-scatter", cfun_regmap_plan_scatter),
+        JANET_REG("regmap/plan-transaction", cfun_regmap_plan_transaction),
+        JANET_REG("regmap/plan-bursts", cfun_regmap_plan_bursts),
+        JANET_REG_END
+    };
+    janet_cfuns_ext(env, "regmap", cfuns);
+}
@@ -1,20 +1,21 @@
 // libMPSSE-SPI functions as documented in Application Note AN_178, Version 1.2
 
-#include "module.h"
-#include "../LibMPSSE_1.0.7/release/include/libmpsse_spi.h"
+#include "spi.h"
+#include "../LibMPSSE_1.0.7/release/source/ftdi_mid.h"
 
-typedef struct {
-    uint32_t        index;          // 1-based, as user-entered
-    uint32_t        id;             // unique id per-channel set by libmpsse
-    FT_HANDLE       handle;
-    ChannelConfig   config;
-    uint32_t        read_options;   // these are use per-read/write
-    uint32_t        write_options;  //
-} channel_t;
+#define SPI_DEFER_LIMIT         4096    // default bytes queued before a deferred flush
+#define SPI_CHUNK_SIZE          65536   // default bytes per transaction of spi/transaction-chunks
+#define SPI_POLL_BATCH_MIN      4       // status reads per USB write of spi/device-poll-until
+#define SPI_POLL_BATCH_MAX      64
 
 static int  channel_get(void *p, Janet key, Janet *out);
 static int  channel_gc(void *p, size_t s);
+static void channel_marshal(void *p, JanetMarshalContext *ctx);
+static void *channel_unmarshal(JanetMarshalContext *ctx);
 static void channel_string(void *p, JanetBuffer *buffer);
+static int  device_get(void *p, Janet key, Janet *out);
+static int  device_gcmark(void *p, size_t s);
+static void device_string(void *p, JanetBuffer *buffer);
 
 static const JanetAbstractType channel_type = {
     "spi/channel",
@@ -22,8 +23,8 @@ static const JanetAbstractType channel_type = {
     NULL,                   // gcmark
     channel_get,            // get
     NULL,                   // put
-    NULL,                   // marshal
-    NULL,                   // unmarshal
+    channel_marshal,        // marshal
+    channel_unmarshal,      // unmarshal
     channel_string,         // to-string
     JANET_ATEND_TOSTRING
                             // compare
@@ -34,14 +35,72 @@ static const JanetAbstractType channel_type = {
                             // bytes 
 };
 
+const JanetAbstractType spi_device_type = {
+    "spi/device",
+    NULL,                   // gc
+    device_gcmark,          // gcmark
+    device_get,             // get
+    NULL,                   // put
+    NULL,                   // marshal
+    NULL,                   // unmarshal
+    device_string,          // to-string
+    JANET_ATEND_TOSTRING
+};
+
 /***************/
 /* C Functions */
 /***************/
 
 // Save the FT return status to dyn :spi-err, and return the value directly.
 static Janet set_status_dyn(FT_STATUS status, Janet value) {
-    janet_setdyn("ft-err", janet_ckeywordv(ft_status_string[status]));
-    return value;
+    return ft_status(ERR_MODE_DYN, status, value);
+}
+
+// Report the status as set by the channel's err-mode
+static Janet channel_status(channel_t *c, FT_STATUS status, Janet value) {
+    return ft_status(c->err_mode, status, value);
+}
+
+/* Set the driver's read & write timeouts for a call with a deadline of 'ms', or the
+    channel's deadline if 0. They are only set when they change, and stay for the next call.
+    Returns the deadline in effect. */
+static uint32_t channel_deadline(channel_t *c, uint32_t ms) {
+    if (ms == 0)
+        ms = c->timeout ? c->timeout : DEVICE_READ_TIMEOUT;
+    if (ms != c->timeout_set) {
+        c->timeout_set = 0;
+        if (Mid_SetDeviceTimeOut(c->handle, ms, ms) == FT_OK)
+            c->timeout_set = ms;
+    }
+    return ms;
+}
+
+// Initialize with the config set, keeping it for reopen. Safe to call off the Janet thread.
+static FT_STATUS channel_init(channel_t *c) {
+    FT_STATUS status = SPI_InitChannel(c->handle, &c->config);
+    c->initialized = (status == FT_OK);
+    c->timeout_set = (status == FT_OK) ? DEVICE_READ_TIMEOUT : 0; // as set by init
+    return status;
+}
+
+/* Send the commands left queued by deferred mode, if any, in one write. Calls that don't
+    go through cmd flush first, so everything reaches the device in order. */
+static FT_STATUS channel_flush(channel_t *c) {
+    if (0 == c->cmd.count)
+        return FT_OK;
+    if (NULL == c->handle) {
+        mpsse_clear(&c->cmd);
+        return FT_DEVICE_NOT_OPENED;
+    }
+    channel_deadline(c, 0);
+    return mpsse_transfer(c->handle, &c->cmd, NULL, NULL);
+}
+
+// After queuing a write: flush once the queue is past its limit
+static FT_STATUS channel_deferred(channel_t *c) {
+    if (c->cmd.count >= c->defer_limit)
+        return channel_flush(c);
+    return FT_OK;
 }
 
 JANET_FN(cfun_spi_get_err,
@@ -68,12 +127,30 @@ JANET_FN(cfun_spi_get_err,
     "* `:invalid-args`\n" // 16
     "* `:not-supported`\n"
     "* `:other-error`\n"
-    "* `:device-list-not-ready`\n\n"
+    "* `:device-list-not-ready`\n"
+    "* `:timeout`   - a call ran past its deadline, see `spi/timeout`\n\n"
     "Note: currently a wrapper for (dyn :ft-err)") {
     janet_arity(argc, 0, 1);
     return janet_dyn("ft-err");
 }
 
+JANET_FN(cfun_spi_err_mode,
+    "(spi/err-mode channel &opt mode)",
+    "Get or set how calls on `channel` report their status. `mode` is one of:\n"
+    "* `:dyn`   - set `(dyn :ft-err)` as returned by `spi/err`, and return the value (default)\n"
+    "* `:raise` - raise the status keyword on error, and return the value\n"
+    "* `:tuple` - return a tuple of `[value status]`\n\n"
+    "In `:raise` and `:tuple` modes the dynamic binding is not touched, which is cheaper in tight loops. "
+    "Functions not taking a channel (`open`, `info`...) always use `:dyn`.\n\n"
+    "Returns the channel's mode.") {
+    janet_arity(argc, 1, 2);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    if (argc > 1)
+        c->err_mode = ft_err_mode_get(argv, 1);
+    return ft_err_mode_keyword(c->err_mode);
+}
+
 JANET_FN(cfun_spi_channelcount,
     "(spi/channels)",
     "Get the number of SPI channels that are connected to the host system. "
@@ -140,6 +217,46 @@ JANET_FN(cfun_spi_get_id,
     return janet_wrap_integer(c->id);
 }
 
+// Open the channel at c->index, and save its libMPSSE id and where it is
+static FT_STATUS channel_open(channel_t *c) {
+    FT_STATUS status = SPI_OpenChannel((c->index - 1), &c->handle);
+    if (status != FT_OK) {
+        c->handle = NULL;
+        return status;
+    }
+
+    FT_DEVICE_LIST_INFO_NODE chaninfo;
+    status = SPI_GetChannelInfo((c->index - 1), &chaninfo);
+    if (status != FT_OK) { // bailout if we fail here
+        SPI_CloseChannel(c->handle); // probably will also quietly fail but better to be sure
+        c->handle = NULL;
+        janet_panicf("failed to get channel info on a newly opened channel: %s", ft_status_string[status]);
+    }
+    c->id = chaninfo.ID;
+    c->timeout_set = 0;
+    c->locid = chaninfo.LocId;
+    memcpy(c->serial, chaninfo.SerialNumber, sizeof(c->serial));
+    c->serial[sizeof(c->serial) - 1] = 0;
+    return FT_OK;
+}
+
+static channel_t *channel_new(uint32_t index) {
+    channel_t *c = (channel_t *)janet_abstract(&channel_type, sizeof(channel_t));
+    memset(&c->config, 0x0, sizeof(ChannelConfig));
+    mpsse_init(&c->cmd, 0);
+    c->index = index;
+    c->id = c->locid = 0;
+    c->serial[0] = 0;
+    c->handle = NULL;
+    c->err_mode = ERR_MODE_DYN;
+    c->initialized = FALSE;
+    c->timeout = c->timeout_set = 0;
+    c->read_options = c->write_options = 0;
+    c->deferred = FALSE;
+    c->defer_limit = SPI_DEFER_LIMIT;
+    return c;
+}
+
 JANET_FN(cfun_spi_openchannel,
     "(spi/open index)",
     "Open a channel by (1-based) `index`.\n\n"
@@ -150,23 +267,11 @@ JANET_FN(cfun_spi_openchannel,
     if (index < 1)
         return set_status_dyn(FT_INVALID_HANDLE, janet_wrap_nil());
     
-    channel_t *c = (channel_t *)janet_abstract(&channel_type, sizeof(channel_t));
-    memset(&c->config, 0x0, sizeof(ChannelConfig));
-    c->index = index;
-
-    FT_STATUS status = SPI_OpenChannel((index - 1), &c->handle);
+    channel_t *c = channel_new(index);
+    FT_STATUS status = channel_open(c);
     if (status != FT_OK)
         return set_status_dyn(status, janet_wrap_nil());
 
-    FT_DEVICE_LIST_INFO_NODE chaninfo;
-    status = SPI_GetChannelInfo((index - 1), &chaninfo);
-    if (status != FT_OK) { // bailout if we fail here
-        SPI_CloseChannel(c->handle); // probably will also quietly fail but better to be sure
-        c->handle = NULL;
-        janet_panicf("failed to get channel info on a newly opened channel: %s", ft_status_string[status]);
-    }
-    c->id = chaninfo.ID;
-
     return set_status_dyn(FT_OK, janet_wrap_abstract(c));
 }
 
@@ -322,7 +427,7 @@ JANET_FN(cfun_spi_set_write_options,
 
     channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
     c->write_options = spi_transfer_option_keywords(argc, argv);
-    return set_status_dyn(FT_OK, janet_wrap_nil());
+    return channel_status(c, FT_OK, janet_wrap_nil());
 }
 
 JANET_FN(cfun_spi_set_read_options,
@@ -334,27 +439,14 @@ JANET_FN(cfun_spi_set_read_options,
 
     channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
     c->read_options = spi_transfer_option_keywords(argc, argv);
-    return set_status_dyn(FT_OK, janet_wrap_nil());
+    return channel_status(c, FT_OK, janet_wrap_nil());
 }
 
-JANET_FN(cfun_spi_set_config_options,
-    "(spi/config channel &opt kw ...)",
-    "Set channel config options. Takes zero, or more keywords:\n\n"
-    "* `:mode0`             - captured on Rising, propagated on Falling edge\n"
-    "* `:mode1`             - captured on Falling, propagated on rising edge\n"
-    "* `:mode2`             - captured on Falling, propagated on Rising edge\n"
-    "* `:mode3`             - captured on Rising, propagated on Falling edge\n"
-    "* `:bus_`              - Use chip select bus line `:cs-bus3` to `7`\n"
-    "* `:active-low`        - Set chip select line to Active Low (default is High)\n\n"
-    "Note: Bus corresponds to lines ADBUS0 - ADBUS7 if the first MPSSE channel "
-    "is used, otherwise it corresponds to lines BDBUS0 - BDBUS7 if the second MPSSE" 
-    "channel (i.e., if available in the chip) is used.") {
-    janet_arity(argc, 1, 4);
-
-    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
-
+/* Set config option bits from Janet keywords from slot 'start' on, as taken by spi/config,
+    spi/device and spi/open-all */
+static uint32_t spi_config_option_keywords(int32_t argc, Janet *argv, int32_t start) {
     uint32_t options = 0;
-    for (int i = 1; i < argc; i++) {
+    for (int i = start; i < argc; i++) {
         if (janet_checktype(argv[i], JANET_KEYWORD)) {
             JanetKeyword opt = janet_unwrap_keyword(argv[i]);
             if (strcmp(opt, "mode0") == 0)
@@ -382,16 +474,35 @@ JANET_FN(cfun_spi_set_config_options,
         } else
             janet_panicf("invalid SPI config option type, expected keyword but got %t in slot #%d", argv[i], i+1);
     }
+    return options;
+}
+
+JANET_FN(cfun_spi_set_config_options,
+    "(spi/config channel &opt kw ...)",
+    "Set channel config options. Takes zero, or more keywords:\n\n"
+    "* `:mode0`             - captured on Rising, propagated on Falling edge\n"
+    "* `:mode1`             - captured on Falling, propagated on rising edge\n"
+    "* `:mode2`             - captured on Falling, propagated on Rising edge\n"
+    "* `:mode3`             - captured on Rising, propagated on Falling edge\n"
+    "* `:bus_`              - Use chip select bus line `:cs-bus3` to `7`\n"
+    "* `:active-low`        - Set chip select line to Active Low (default is High)\n\n"
+    "Note: Bus corresponds to lines ADBUS0 - ADBUS7 if the first MPSSE channel "
+    "is used, otherwise it corresponds to lines BDBUS0 - BDBUS7 if the second MPSSE" 
+    "channel (i.e., if available in the chip) is used.") {
+    janet_arity(argc, 1, 4);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    uint32_t options = spi_config_option_keywords(argc, argv, 1);
     c->config.configOptions = options;
 
-    return set_status_dyn(FT_OK, janet_wrap_nil());
+    return channel_status(c, FT_OK, janet_wrap_nil());
 }
 
 JANET_FN(cfun_spi_initchannel,
     "(spi/init channel clockrate &opt latency)",
     "Initialize an open `channel`, `clockrate` and optional`latency`. "
     "Returns `true` if successful, or `false` on error. Sets :err to return status.\n\n"
-    "* clockrate   - 0 to 30,000,000 Hz\n"
+    "* clockrate   - 1 to 30,000,000 Hz\n"
     "* latency     - 0 to 255 (default)\n\n"
     "Note: Recommended latency of Full-speed devices (FT2232D) is 2 to 255, "
     "and Hi-speed devices (FT232H, FT2232H, FT4232H) is 1 to 255. Default is 255.") {
@@ -399,10 +510,10 @@ JANET_FN(cfun_spi_initchannel,
 
     channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
     
-    uint32_t clock = janet_getuinteger(argv, 2);
-        if (clock > 30000000)
-            janet_panicf("clockrate %d is out of range. Expected 0 to 30,000,000 Hz");
-    
+    uint32_t clock = janet_getuinteger(argv, 1);
+    if (clock < 1 || clock > 30000000)
+        janet_panicf("clockrate %d is out of range. Expected 1 to 30,000,000 Hz", clock);
+
     c->config.ClockRate = clock;
 
     uint8_t latency = janet_optinteger(argv, argc, 2, 255);
@@ -411,10 +522,248 @@ JANET_FN(cfun_spi_initchannel,
     c->config.LatencyTimer = latency;
 
     if (NULL == c->handle)
-        return set_status_dyn(FT_DEVICE_NOT_OPENED, janet_wrap_boolean(FALSE));
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_boolean(FALSE));
 
-    FT_STATUS status = SPI_InitChannel(c->handle, &c->config);
-    return set_status_dyn(status, janet_wrap_boolean(status == FT_OK? TRUE : FALSE));
+    FT_STATUS status = channel_flush(c);
+    if (status == FT_OK)
+        status = channel_init(c);
+    return channel_status(c, status, janet_wrap_boolean(status == FT_OK? TRUE : FALSE));
+}
+
+typedef struct {
+    channel_t       *c;
+    int32_t         slot;           // index in the result array
+    FT_STATUS       status;
+} init_job_t;
+
+static int info_name_eq(const char *s, JanetByteView name) {
+    return strncmp(s, (const char *)name.bytes, name.len) == 0 && s[name.len] == 0;
+}
+
+static void init_job(void *p) {
+    init_job_t *j = (init_job_t *)p;
+    j->status = channel_init(j->c);
+}
+
+JANET_FN(cfun_spi_open_all,
+    "(spi/open-all selector clockrate &opt latency & options)",
+    "Open and initialize many channels at once. `selector` is `:all` for every channel, "
+    "or an indexed of serial number or description strings, each matching the first channel not "
+    "already taken. `clockrate` and `latency` are as `spi/init`, and `options` are `spi/config` keywords.\n\n"
+    "Channels are opened in turn, then initialized in parallel, so one slow or failing adapter doesn't "
+    "hold up the others.\n\n"
+    "Returns an array of ready `<spi/channel>`s, one per channel (or per selector entry), with `nil` "
+    "for any that failed. Sets `:err` to the first failure, or `:ok`.") {
+    janet_arity(argc, 2, -1);
+
+    JanetView names = {NULL, 0};
+    if (janet_checktype(argv[0], JANET_NIL) || janet_keyeq(argv[0], "all"))
+        names.len = -1;
+    else if (!janet_indexed_view(argv[0], &names.items, &names.len))
+        janet_panicf("expected :all or indexed of serial numbers and descriptions, got %v", argv[0]);
+    uint32_t clock = janet_getuinteger(argv, 1);
+    if (clock < 1 || clock > 30000000)
+        janet_panicf("clockrate %d is out of range. Expected 1 to 30,000,000 Hz", clock);
+    int32_t latency = janet_optinteger(argv, argc, 2, 255);
+    if (latency < 0 || latency > 255)
+        janet_panicf("latency %d out of range. expected 0 to 255", latency);
+    uint32_t options = spi_config_option_keywords(argc, argv, 3);
+
+    uint32_t chans = 0;
+    FT_STATUS status = SPI_GetNumChannels(&chans);
+    if (status != FT_OK)
+        return set_status_dyn(status, janet_wrap_nil());
+
+    // pick a channel index for each result slot, 0 for none
+    int32_t count = names.len < 0 ? (int32_t)chans : names.len;
+    uint32_t *indices = janet_smalloc(sizeof(uint32_t) * (count + 1));
+    if (names.len < 0) {
+        for (int32_t i = 0; i < count; i++)
+            indices[i] = i + 1;
+    } else {
+        for (int32_t i = 0; i < count; i++) {
+            JanetByteView name = janet_getbytes(names.items, i);
+            indices[i] = 0;
+            for (uint32_t ch = 0; ch < chans && indices[i] == 0; ch++) {
+                FT_DEVICE_LIST_INFO_NODE chaninfo;
+                if (SPI_GetChannelInfo(ch, &chaninfo) != FT_OK)
+                    continue;
+                if (!info_name_eq(chaninfo.SerialNumber, name) && !info_name_eq(chaninfo.Description, name))
+                    continue;
+                int32_t taken = 0;
+                for (int32_t k = 0; k < i; k++)
+                    taken |= (indices[k] == ch + 1);
+                if (!taken)
+                    indices[i] = ch + 1;
+            }
+        }
+    }
+
+    // libMPSSE's channel list isn't thread safe, so opens are done here, in turn
+    FT_STATUS first = FT_OK;
+    JanetArray *out = janet_array(count);
+    init_job_t *jobs = janet_smalloc(sizeof(init_job_t) * (count + 1));
+    int32_t njobs = 0;
+    for (int32_t i = 0; i < count; i++) {
+        janet_array_push(out, janet_wrap_nil());
+        if (indices[i] == 0) {
+            if (first == FT_OK)
+                first = FT_DEVICE_NOT_FOUND;
+            continue;
+        }
+        channel_t *c = channel_new(indices[i]);
+        out->data[i] = janet_wrap_abstract(c);
+        status = channel_open(c);
+        if (status != FT_OK) {
+            out->data[i] = janet_wrap_nil();
+            if (first == FT_OK)
+                first = status;
+            continue;
+        }
+        c->config.ClockRate = clock;
+        c->config.LatencyTimer = (uint8_t)latency;
+        c->config.configOptions = options;
+        jobs[njobs].c = c;
+        jobs[njobs].slot = i;
+        jobs[njobs].status = FT_OK;
+        njobs++;
+    }
+    janet_sfree(indices);
+
+    ft_parallel(init_job, jobs, sizeof(init_job_t), njobs);
+
+    for (int32_t j = 0; j < njobs; j++) {
+        if (jobs[j].status != FT_OK) {
+            SPI_CloseChannel(jobs[j].c->handle);
+            jobs[j].c->handle = NULL;
+            out->data[jobs[j].slot] = janet_wrap_nil();
+            if (first == FT_OK)
+                first = jobs[j].status;
+        }
+    }
+    janet_sfree(jobs);
+
+    return set_status_dyn(first, janet_wrap_array(out));
+}
+
+JANET_FN(cfun_spi_reopen,
+    "(spi/reopen channel &opt full)",
+    "Recover a `channel` after a USB error, or reopen a closed one, keeping the same `<spi/channel>`, "
+    "so its devices and transactions stay valid. "
+    "If the handle is still good and the MPSSE answers in sync, only its buffers are purged. "
+    "Otherwise, or if `full` is truthy, the handle is closed, the device is found again by its USB "
+    "location and serial number (or serial alone, if it moved port), reopened, and initialized with "
+    "the last `spi/init` settings. Config and transfer options are kept.\n\n"
+    "Returns `true` if successful, or `false` on error. Sets `:err` to return status.") {
+    janet_arity(argc, 1, 2);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    int full = janet_optboolean(argv, argc, 1, 0);
+    mpsse_clear(&c->cmd);
+
+    // fast path: the device kept its MPSSE state, so the clock and pins are still set
+    if (c->handle != NULL && !full) {
+        FT_STATUS status = Mid_PurgeDevice(c->handle);
+        if (status == FT_OK)
+            status = Mid_SyncMPSSE(c->handle);
+        if (status == FT_OK)
+            return channel_status(c, FT_OK, janet_wrap_boolean(TRUE));
+    }
+
+    if (c->handle != NULL) {
+        SPI_CloseChannel(c->handle); // probably fails after an unplug, but frees libMPSSE's node
+        c->handle = NULL;
+    }
+
+    uint32_t chans = 0;
+    FT_STATUS status = SPI_GetNumChannels(&chans);
+    if (status != FT_OK)
+        return channel_status(c, status, janet_wrap_boolean(FALSE));
+
+    // prefer the same port, then the same serial anywhere
+    uint32_t found = 0;
+    for (int pass = 0; pass < 2 && found == 0; pass++) {
+        for (uint32_t i = 0; i < chans && found == 0; i++) {
+            FT_DEVICE_LIST_INFO_NODE chaninfo;
+            if (SPI_GetChannelInfo(i, &chaninfo) != FT_OK)
+                continue;
+            if (strncmp(chaninfo.SerialNumber, c->serial, sizeof(c->serial)) != 0)
+                continue;
+            if (pass == 0 && chaninfo.LocId != c->locid)
+                continue;
+            if (pass == 1 && c->serial[0] == 0)
+                continue;
+            found = i + 1;
+        }
+    }
+    if (found == 0)
+        return channel_status(c, FT_DEVICE_NOT_FOUND, janet_wrap_boolean(FALSE));
+
+    c->index = found;
+    status = channel_open(c);
+    if (status != FT_OK)
+        return channel_status(c, status, janet_wrap_boolean(FALSE));
+
+    if (c->initialized)
+        status = channel_init(c);
+    return channel_status(c, status, janet_wrap_boolean(status == FT_OK? TRUE : FALSE));
+}
+
+JANET_FN(cfun_spi_timeout,
+    "(spi/timeout channel &opt ms)",
+    "Get or set the deadline of each read & write on `channel`, in ms. Calls that take a "
+    "`timeout` override it for that call. 0 restores libMPSSE's default of 5 seconds.\n\n"
+    "A read that runs out of time returns what it got so far, and sets `:timeout`. A short "
+    "read is only `:timeout` when its transfer ran for the whole deadline (less 1/16 for timer "
+    "granularity); a quicker short read sets `:io-error`.\n\n"
+    "Returns the channel's deadline. Sets `:err` to return status.") {
+    janet_arity(argc, 1, 2);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    FT_STATUS status = FT_OK;
+    if (argc > 1) {
+        c->timeout = (uint32_t)janet_getnat(argv, 1);
+        if (c->handle != NULL && channel_deadline(c, 0) != c->timeout_set)
+            status = FT_OTHER_ERROR;
+    }
+    return channel_status(c, status, janet_wrap_number(c->timeout ? c->timeout : DEVICE_READ_TIMEOUT));
+}
+
+JANET_FN(cfun_spi_defer,
+    "(spi/defer channel &opt on limit)",
+    "Turn deferred mode on `channel` on (the default) or off. While on, write-only calls "
+    "(`spi/device-write`, `spi/gpio-write`, `spi/gpio-low-write`) queue their MPSSE commands "
+    "and return as if written. The queue is sent in one USB write by `spi/flush`, or ahead of "
+    "any other call on the channel; a device read sends it in the same write as its own commands. "
+    "A write that leaves `limit` bytes queued (default 4096) flushes the queue. Turning it off flushes.\n\n"
+    "Returns `true` if successful. Sets `:err` to return status.\n\n"
+    "Note: there is no timer. Queued commands wait, however long, for `spi/flush` or the next "
+    "call on the channel; transactions run by `ft/await` or `ft/sampler` don't send them, so "
+    "flush before those. An error in a queued write is reported by the call that sends it.") {
+    janet_arity(argc, 1, 3);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    int on = janet_optboolean(argv, argc, 1, 1);
+    c->defer_limit = (uint32_t)janet_optnat(argv, argc, 2, SPI_DEFER_LIMIT);
+
+    FT_STATUS status = FT_OK;
+    if (!on)
+        status = channel_flush(c);
+    c->deferred = on ? TRUE : FALSE;
+    return channel_status(c, status, janet_wrap_boolean(status == FT_OK? TRUE : FALSE));
+}
+
+JANET_FN(cfun_spi_flush,
+    "(spi/flush channel)",
+    "Send the commands queued on `channel` in deferred mode, in one USB write.\n\n"
+    "Returns bytes sent. Sets `:err` to return status.\n\n"
+    "This is a **blocking function**.") {
+    janet_fixarity(argc, 1);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    uint32_t count = c->cmd.count;
+    FT_STATUS status = channel_flush(c);
+    return channel_status(c, status, janet_wrap_integer(status == FT_OK ? count : 0));
 }
 
 JANET_FN(cfun_spi_closechannel,
@@ -425,20 +774,22 @@ JANET_FN(cfun_spi_closechannel,
 
     channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);   
     if ((NULL == c) || (NULL == c->handle))
-        return set_status_dyn(FT_DEVICE_NOT_OPENED, janet_wrap_boolean(FALSE));
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_boolean(FALSE));
     
+    channel_flush(c);
     FT_STATUS status = SPI_CloseChannel(c->handle);
     c->handle = NULL;
 
-    return set_status_dyn(status, janet_wrap_boolean(status == FT_OK? TRUE : FALSE));
+    return channel_status(c, status, janet_wrap_boolean(status == FT_OK? TRUE : FALSE));
 }
 
 JANET_FN(cfun_spi_deviceread,
-    "(spi/read channel size buffer)",
-    "Read & append `size` n-bytes to `buffer`\n\n"
-    "Returns bytes read. Sets `:err` to return status.\n\n"
+    "(spi/read channel size buffer &opt timeout)",
+    "Read & append `size` n-bytes to `buffer`, within `timeout` ms if given, "
+    "otherwise the channel's `spi/timeout`.\n\n"
+    "Returns bytes read, which is less than `size` on `:timeout`. Sets `:err` to return status.\n\n"
     "This is a **blocking function**.") {
-    janet_fixarity(argc, 3);
+    janet_arity(argc, 3, 4);
         
     uint32_t size = janet_getuinteger(argv, 1);
     if (size < 1)
@@ -449,26 +800,34 @@ JANET_FN(cfun_spi_deviceread,
     
     channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
     if (NULL == c->handle)
-        return set_status_dyn(FT_DEVICE_NOT_OPENED, janet_wrap_integer(0));
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_integer(0));
 
+    FT_STATUS status = channel_flush(c);
+    if (status != FT_OK)
+        return channel_status(c, status, janet_wrap_integer(0));
+
+    uint32_t ms = channel_deadline(c, (uint32_t)janet_optnat(argv, argc, 3, 0));
+    int64_t start = ft_monotonic_ns();
     uint32_t readsz = 0;
-    FT_STATUS status = SPI_Read(c->handle,
+    status = SPI_Read(c->handle,
                                 (buffer->data + buffer->count), 
                                 size,
                                 &readsz, 
                                 c->read_options);
+    status = ft_deadline_status(status, start, ms);
     if (readsz > 0)
         buffer->count += readsz;
 
-    return set_status_dyn(status, janet_wrap_integer(readsz));
+    return channel_status(c, status, janet_wrap_integer(readsz));
 }
 
 JANET_FN(cfun_spi_devicewrite,
-    "(spi/write channel size buffer)",
-    "Write `size` n-bytes of `buffer`\n\n"
+    "(spi/write channel size buffer &opt timeout)",
+    "Write `size` n-bytes of `buffer`, within `timeout` ms if given, "
+    "otherwise the channel's `spi/timeout`.\n\n"
     "Returns bytes written. Sets `:err` to return status.\n\n"
     "This is a **blocking function**.") {
-    janet_fixarity(argc, 3);
+    janet_arity(argc, 3, 4);
 
     uint32_t size = janet_getinteger(argv, 1);
     if (size <= 0)
@@ -476,9 +835,12 @@ JANET_FN(cfun_spi_devicewrite,
 
     channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);    
     if (NULL == c->handle)
-        return set_status_dyn(FT_DEVICE_NOT_OPENED, janet_wrap_integer(0));
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_integer(0));
     
-    FT_STATUS status;
+    FT_STATUS status = channel_flush(c);
+    if (status != FT_OK)
+        return channel_status(c, status, janet_wrap_integer(0));
+
     uint32_t writesz = 0;
     uint8_t *buf = NULL;
     if (janet_checktype(argv[2], JANET_NUMBER)) {
@@ -492,25 +854,28 @@ JANET_FN(cfun_spi_devicewrite,
             janet_panicf("write size %d larger than buffer size %d", size, buffer->count);
         buf = buffer->data;
     }
+    uint32_t ms = channel_deadline(c, (uint32_t)janet_optnat(argv, argc, 3, 0));
+    int64_t start = ft_monotonic_ns();
     status = SPI_Write(c->handle,
                         buf, 
                         size,     
                         &writesz, 
                         c->write_options);
-    return set_status_dyn(status, janet_wrap_integer(writesz));
+    status = ft_deadline_status(status, start, ms);
+    return channel_status(c, status, janet_wrap_integer(writesz));
 }
 
 JANET_FN(cfun_spi_readwrite,
-    "(spi/readwrite channel size sendbuf recvbuf)",
-    "Simultaneously read & write `size` n-bytes to `channel`.\n\n"
+    "(spi/readwrite channel size sendbuf recvbuf &opt timeout)",
+    "Simultaneously read & write `size` n-bytes to `channel`. Takes a `timeout` in ms as `spi/read`.\n\n"
     "Returns bytes transfered. Sets `:err` to return status.\n\n"
     "Note: Uses the `write-opt` transfer option for both operations.\n\n"
     "This is a **blocking function**.") {
-    janet_fixarity(argc, 4);
+    janet_arity(argc, 4, 5);
 
     channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
     if (NULL == c->handle)
-        return set_status_dyn(FT_DEVICE_NOT_OPENED, janet_wrap_integer(0));
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_integer(0));
 
     uint32_t size = janet_getuinteger(argv, 1);
     if (size <= 0)
@@ -523,16 +888,23 @@ JANET_FN(cfun_spi_readwrite,
     JanetBuffer *recvbuf = janet_getbuffer(argv, 3);
     janet_buffer_extra(recvbuf, size);
 
+    FT_STATUS status = channel_flush(c);
+    if (status != FT_OK)
+        return channel_status(c, status, janet_wrap_integer(0));
+
+    uint32_t ms = channel_deadline(c, (uint32_t)janet_optnat(argv, argc, 4, 0));
+    int64_t start = ft_monotonic_ns();
     uint32_t transfer_sz = 0;
-    FT_STATUS status = SPI_ReadWrite(c->handle,
+    status = SPI_ReadWrite(c->handle,
                                     sendbuf->data,
                                     (recvbuf->data + recvbuf->count),
                                     size, 
                                     &transfer_sz,
                                     c->write_options);
+    status = ft_deadline_status(status, start, ms);
     if (transfer_sz > 0)
         recvbuf->count += transfer_sz;
-    return set_status_dyn(status, janet_wrap_integer(transfer_sz));
+    return channel_status(c, status, janet_wrap_integer(transfer_sz));
 }
 
 JANET_FN(cfun_spi_is_busy,
@@ -543,11 +915,13 @@ JANET_FN(cfun_spi_is_busy,
 
     channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
     if (NULL == c->handle)
-        return set_status_dyn(FT_DEVICE_NOT_OPENED, janet_wrap_integer(0));
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_integer(0));
     
     BOOL state = FALSE;
-    FT_STATUS status = SPI_IsBusy(c->handle, &state);
-    return set_status_dyn(status, janet_wrap_boolean(state));
+    FT_STATUS status = channel_flush(c);
+    if (status == FT_OK)
+        status = SPI_IsBusy(c->handle, &state);
+    return channel_status(c, status, janet_wrap_boolean(state));
 }
 
 JANET_FN(cfun_spi_gpio_write,
@@ -555,8 +929,9 @@ JANET_FN(cfun_spi_gpio_write,
     "Write to GPIO lines, where `direction` and `value` are an 8-bit value mapping each line. "
     "Direction bit 0 for in, and 1 for out. Value is 0 logic low, 1 logic high.\n\n"
     "Returns `nil`. Sets `:err` to return status.\n\n"
-    "Note: libMPSSE cannot use the lower gpio port pins 0-7, such as those exposed in "
-    "FTDI cable assemblies. Setting bit-6 corresponds to the onboard red LED in some cables.") {
+    "Note: these are the high byte pins; the free lower pins, such as those exposed in "
+    "FTDI cable assemblies, are written with `spi/gpio-low-write`. "
+    "Setting bit-6 corresponds to the onboard red LED in some cables.") {
     janet_fixarity(argc, 3);
 
     uint8_t dir = janet_getinteger(argv, 1);
@@ -564,10 +939,18 @@ JANET_FN(cfun_spi_gpio_write,
 
     channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
     if (NULL == c->handle)
-        return set_status_dyn(FT_DEVICE_NOT_OPENED, janet_wrap_nil());
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_nil());
 
-    FT_STATUS status = FT_WriteGPIO(c->handle, dir, value);
-    return set_status_dyn(status, janet_wrap_nil());
+    FT_STATUS status;
+    if (c->deferred) {
+        mpsse_set_high(&c->cmd, value, dir);
+        status = channel_deferred(c);
+    } else {
+        status = channel_flush(c);
+        if (status == FT_OK)
+            status = FT_WriteGPIO(c->handle, dir, value);
+    }
+    return channel_status(c, status, janet_wrap_nil());
 }
 
 JANET_FN(cfun_spi_gpio_read, 
@@ -579,27 +962,568 @@ JANET_FN(cfun_spi_gpio_read,
 
     channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
     if (NULL == c->handle)
-        return set_status_dyn(FT_DEVICE_NOT_OPENED, janet_wrap_nil());
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_nil());
+
+    uint8_t value = 0;
+    FT_STATUS status = channel_flush(c);
+    channel_deadline(c, 0);
+    if (status == FT_OK)
+        status = FT_ReadGPIO(c->handle, &value);
+    return channel_status(c, status, janet_wrap_integer(value));
+}
+
+JANET_FN(cfun_spi_gpio_low_write,
+    "(spi/gpio-low-write channel dir value &opt :deferred)",
+    "Write to the low byte GPIO lines ADBUS3-7, except the chip select line. Bits 0-2 (SCK/MOSI/MISO) and the chip select bit are ignored. "
+    "`dir` and `value` map each line as in `gpio-write`.\n\n"
+    "The lines keep their state across transfers, as it is merged into the protocol's own "
+    "low byte commands. With `:deferred` nothing is written now, and the lines change with "
+    "the next chip select assert or deassert, in the same USB write.\n\n"
+    "Returns `nil`. Sets `:err` to return status.\n\n"
+    "Note: the channel must be initialized.") {
+    janet_arity(argc, 3, 4);
+
+    uint8_t dir = janet_getinteger(argv, 1);
+    uint8_t value = janet_getinteger(argv, 2);
+
+    BOOL deferred = FALSE;
+    if (argc > 3) {
+        JanetKeyword opt = janet_getkeyword(argv, 3);
+        if (strcmp(opt, "deferred") != 0)
+            janet_panicf("invalid gpio option %v, expected :deferred", argv[3]);
+        deferred = TRUE;
+    }
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    if (NULL == c->handle)
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_nil());
+
+    // in deferred mode, queue the lines as merged into the pin state
+    FT_STATUS status;
+    if (c->deferred && !deferred) {
+        USHORT state = 0;
+        status = SPI_WriteGPIOLow(c->handle, dir, value, TRUE);
+        if (status == FT_OK)
+            status = SPI_GetPinState(c->handle, &state);
+        if (status == FT_OK) {
+            mpsse_set_low(&c->cmd, (uint8_t)(state >> 8), (uint8_t)(state & 0xFF));
+            status = channel_deferred(c);
+        }
+    } else {
+        status = channel_flush(c);
+        if (status == FT_OK)
+            status = SPI_WriteGPIOLow(c->handle, dir, value, deferred);
+    }
+    return channel_status(c, status, janet_wrap_nil());
+}
+
+JANET_FN(cfun_spi_gpio_low_read,
+    "(spi/gpio-low-read channel)",
+    "Read the 8 lines of the low byte of the MPSSE channel, including the SPI lines.\n\n"
+    "Returns an unsigned 8-bit integer, or `nil` on error. Sets `:err` to return status.") {
+    janet_fixarity(argc, 1);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    if (NULL == c->handle)
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_nil());
 
     uint8_t value = 0;
-    FT_STATUS status = FT_ReadGPIO(c->handle, &value);
-    return set_status_dyn(status, janet_wrap_integer(value));
+    FT_STATUS status = channel_flush(c);
+    channel_deadline(c, 0);
+    if (status == FT_OK)
+        status = FT_ReadGPIOLow(c->handle, &value);
+    return channel_status(c, status, janet_wrap_integer(value));
+}
+
+/* SPI devices share a channel, each with its own chip select line and mode. Transfers
+    are queued as raw MPSSE commands with the chip select assert and deassert around
+    the data, so switching devices needs no re-init or extra USB writes. */
+#define SPI_DEVICE_CS(options) ((uint8_t)((1 << (((options) & SPI_CONFIG_OPTION_CS_MASK) >> 2)) << 3))
+
+// Low byte value with the device's chip select and clock idle level set
+static uint8_t device_low_value(uint8_t value, uint32_t options, BOOL assert) {
+    uint8_t cs = SPI_DEVICE_CS(options);
+    if (options & SPI_CONFIG_OPTION_CS_ACTIVELOW)
+        assert = !assert;
+    value = assert ? (value | cs) : (value & ~cs);
+    if ((options & SPI_CONFIG_OPTION_MODE_MASK) > 1)
+        return value | 0x01;
+    return value & ~0x01;
+}
+
+channel_t *spi_device_channel(device_t *d) {
+    return (channel_t *)janet_unwrap_abstract(d->channel);
+}
+
+// Queue the chip select assert from pin 'state'. Returns the low byte value with it deasserted.
+static uint8_t device_select(device_t *d, channel_t *c, USHORT state) {
+    uint8_t value = (uint8_t)(state >> 8);
+    uint8_t dir = (uint8_t)(state & 0xFF);
+    uint8_t idle = device_low_value(value, d->options, FALSE);
+    uint8_t device_dir = dir | SPI_DEVICE_CS(d->options);
+    if (idle != value || device_dir != dir)
+        mpsse_set_low(&c->cmd, idle, device_dir);
+    mpsse_set_low(&c->cmd, device_low_value(value, d->options, TRUE), device_dir);
+    return idle;
+}
+
+/* Queue the chip select deassert, with the clock line back at the channel's own idle
+    level, for spi/read & spi/write. Returns the pin state the queued commands leave. */
+static USHORT device_deselect(device_t *d, channel_t *c, USHORT state, uint8_t idle) {
+    uint8_t device_dir = (uint8_t)(state & 0xFF) | SPI_DEVICE_CS(d->options);
+    mpsse_set_low(&c->cmd, idle, device_dir);
+    uint8_t restore = (c->config.configOptions & SPI_CONFIG_OPTION_MODE_MASK) > 1 ? (idle | 0x01) : (idle & ~0x01);
+    if (restore != idle)
+        mpsse_set_low(&c->cmd, restore, device_dir);
+    return ((USHORT)restore << 8) | device_dir;
+}
+
+/* Queue CS assert, the data command, and CS deassert, starting from pin 'state'.
+    Returns the pin state the queued commands leave. */
+static USHORT device_queue(device_t *d, channel_t *c, USHORT state, const uint8_t *out, BOOL read, uint32_t size) {
+    uint8_t idle = device_select(d, c, state);
+    uint32_t mode = d->options & SPI_CONFIG_OPTION_MODE_MASK;
+    if (!read)
+        mpsse_clock_out(&c->cmd, MPSSE_SPI_OUT(mode), out, size);
+    else if (NULL == out)
+        mpsse_clock_in(&c->cmd, MPSSE_SPI_IN(mode), size);
+    else
+        mpsse_clock_inout(&c->cmd, MPSSE_SPI_INOUT(mode), out, size);
+    return device_deselect(d, c, state, idle);
+}
+
+USHORT spi_device_command(device_t *d, channel_t *c, USHORT state, const uint8_t *out, uint32_t outsz, uint32_t insz) {
+    uint8_t idle = device_select(d, c, state);
+    uint32_t mode = d->options & SPI_CONFIG_OPTION_MODE_MASK;
+    if (outsz > 0)
+        mpsse_clock_out(&c->cmd, MPSSE_SPI_OUT(mode), out, outsz);
+    if (insz > 0)
+        mpsse_clock_in(&c->cmd, MPSSE_SPI_IN(mode), insz);
+    return device_deselect(d, c, state, idle);
+}
+
+FT_STATUS spi_device_begin(device_t *d, USHORT *state) {
+    channel_t *c = spi_device_channel(d);
+    if (NULL == c->handle)
+        return FT_DEVICE_NOT_OPENED;
+    FT_STATUS status = channel_flush(c);
+    if (status == FT_OK)
+        status = SPI_GetPinState(c->handle, state);
+    return status;
+}
+
+FT_STATUS spi_device_send(device_t *d, USHORT state, uint8_t *in, uint32_t ms) {
+    channel_t *c = spi_device_channel(d);
+    if (NULL == c->handle) {
+        mpsse_clear(&c->cmd);
+        return FT_DEVICE_NOT_OPENED;
+    }
+    ms = channel_deadline(c, ms);
+    int64_t start = ft_monotonic_ns();
+    FT_STATUS status = mpsse_transfer(c->handle, &c->cmd, in, NULL);
+    status = ft_deadline_status(status, start, ms);
+    if (status == FT_OK)
+        status = SPI_SetPinState(c->handle, state);
+    return status;
+}
+
+// Send a device transfer in one write (and one read), within 'ms' or the channel's deadline
+static FT_STATUS device_transfer(device_t *d, const uint8_t *out, uint8_t *in, uint32_t size,
+                                 uint32_t *transfer_sz, uint32_t ms) {
+    channel_t *c = spi_device_channel(d);
+    *transfer_sz = 0;
+    if (NULL == c->handle)
+        return FT_DEVICE_NOT_OPENED;
+    ms = channel_deadline(c, ms);
+    int64_t start = ft_monotonic_ns();
+
+    USHORT state = 0;
+    FT_STATUS status = SPI_GetPinState(c->handle, &state);
+    if (status != FT_OK)
+        return status;
+
+    // a deferred write stays queued, reads send the queue with them
+    state = device_queue(d, c, state, out, NULL != in, size);
+    if (c->deferred && NULL == in) {
+        SPI_SetPinState(c->handle, state);
+        status = channel_deferred(c);
+        if (status == FT_OK)
+            *transfer_sz = size;
+        return status;
+    }
+    status = mpsse_transfer(c->handle, &c->cmd, in, (NULL == in) ? NULL : transfer_sz);
+    status = ft_deadline_status(status, start, ms);
+    if (status == FT_OK) {
+        *transfer_sz = size;
+        status = SPI_SetPinState(c->handle, state);
+    }
+    return status;
+}
+
+JANET_FN(cfun_spi_device,
+    "(spi/device channel &opt kw ...)",
+    "Create a device on an initialized `channel`, with its own chip select line and mode. "
+    "Takes the same keywords as `spi/config`. The chip select line is set as an output, "
+    "and deasserted.\n\n"
+    "Returns an `<spi/device>`, or `nil` on error. Sets `:err` to return status.\n\n"
+    "Note: transfers on a device embed the chip select in the same USB write as the data, "
+    "and do not change the channel config. Don't drive device chip select lines with `gpio-low-write`.") {
+    janet_arity(argc, 1, -1);
+
+    channel_t *c = (channel_t *)janet_getabstract(argv, 0, &channel_type);
+    uint32_t options = spi_config_option_keywords(argc, argv, 1);
+    if (NULL == c->handle)
+        return channel_status(c, FT_DEVICE_NOT_OPENED, janet_wrap_nil());
+
+    USHORT state = 0;
+    FT_STATUS status = SPI_GetPinState(c->handle, &state);
+    if (status != FT_OK)
+        return channel_status(c, status, janet_wrap_nil());
+
+    uint8_t cs = SPI_DEVICE_CS(options);
+    uint8_t value = (uint8_t)(state >> 8);
+    uint8_t dir = (uint8_t)(state & 0xFF) | cs;
+    if (options & SPI_CONFIG_OPTION_CS_ACTIVELOW)
+        value |= cs;
+    else
+        value &= ~cs;
+
+    mpsse_set_low(&c->cmd, value, dir);
+    status = mpsse_transfer(c->handle, &c->cmd, NULL, NULL);
+    if (status == FT_OK)
+        status = SPI_SetPinState(c->handle, ((USHORT)value << 8) | dir);
+    if (status != FT_OK)
+        return channel_status(c, status, janet_wrap_nil());
+
+    device_t *d = (device_t *)janet_abstract(&spi_device_type, sizeof(device_t));
+    d->channel = argv[0];
+    d->options = options;
+    return channel_status(c, status, janet_wrap_abstract(d));
+}
+
+JANET_FN(cfun_spi_device_write,
+    "(spi/device-write device size buffer &opt timeout)",
+    "Write `size` n-bytes of `buffer` to `device`, with its chip select asserted for the transfer. "
+    "Takes a `timeout` in ms as `spi/read`.\n\n"
+    "Returns bytes written. Sets `:err` to return status.\n\n"
+    "This is a **blocking function**.") {
+    janet_arity(argc, 3, 4);
+
+    device_t *d = (device_t *)janet_getabstract(argv, 0, &spi_device_type);
+    uint32_t size = janet_getuinteger(argv, 1);
+    if (size < 1)
+        janet_panic("write size must be greater than 0");
+
+    JanetBuffer *buffer = janet_getbuffer(argv, 2);
+    if (size > (uint32_t)buffer->count)
+        janet_panicf("write size %d larger than buffer size %d", size, buffer->count);
+
+    uint32_t writesz = 0;
+    FT_STATUS status = device_transfer(d, buffer->data, NULL, size, &writesz,
+                                       (uint32_t)janet_optnat(argv, argc, 3, 0));
+    return channel_status(spi_device_channel(d), status, janet_wrap_integer(writesz));
+}
+
+JANET_FN(cfun_spi_device_read,
+    "(spi/device-read device size buffer &opt timeout)",
+    "Read & append `size` n-bytes from `device` to `buffer`, with its chip select asserted for the transfer. "
+    "Takes a `timeout` in ms as `spi/read`.\n\n"
+    "Returns bytes read. Sets `:err` to return status.\n\n"
+    "This is a **blocking function**.") {
+    janet_arity(argc, 3, 4);
+
+    device_t *d = (device_t *)janet_getabstract(argv, 0, &spi_device_type);
+    uint32_t size = janet_getuinteger(argv, 1);
+    if (size < 1)
+        janet_panic("read size must be greater than 0");
+
+    JanetBuffer *buffer = janet_getbuffer(argv, 2);
+    janet_buffer_extra(buffer, size);
+
+    uint32_t readsz = 0;
+    FT_STATUS status = device_transfer(d, NULL, (buffer->data + buffer->count), size, &readsz,
+                                       (uint32_t)janet_optnat(argv, argc, 3, 0));
+    if (readsz > 0)
+        buffer->count += readsz;
+    return channel_status(spi_device_channel(d), status, janet_wrap_integer(readsz));
+}
+
+JANET_FN(cfun_spi_device_readwrite,
+    "(spi/device-readwrite device size sendbuf recvbuf &opt timeout)",
+    "Simultaneously read & write `size` n-bytes to `device`, with its chip select asserted for the transfer. "
+    "Takes a `timeout` in ms as `spi/read`.\n\n"
+    "Returns bytes transfered. Sets `:err` to return status.\n\n"
+    "This is a **blocking function**.") {
+    janet_arity(argc, 4, 5);
+
+    device_t *d = (device_t *)janet_getabstract(argv, 0, &spi_device_type);
+    uint32_t size = janet_getuinteger(argv, 1);
+    if (size < 1)
+        janet_panic("transfer size must be greater than 0");
+
+    JanetBuffer *sendbuf = janet_getbuffer(argv, 2);
+    if (size > (uint32_t)sendbuf->count)
+        janet_panicf("write size %d larger than sendbuf size %d", size, sendbuf->count);
+
+    JanetBuffer *recvbuf = janet_getbuffer(argv, 3);
+    janet_buffer_extra(recvbuf, size);
+
+    uint32_t transfer_sz = 0;
+    FT_STATUS status = device_transfer(d, sendbuf->data, (recvbuf->data + recvbuf->count), size, &transfer_sz,
+                                       (uint32_t)janet_optnat(argv, argc, 4, 0));
+    if (transfer_sz > 0)
+        recvbuf->count += transfer_sz;
+    return channel_status(spi_device_channel(d), status, janet_wrap_integer(transfer_sz));
+}
+
+FT_STATUS spi_device_poll(device_t *d, uint8_t cmd, uint8_t mask, uint8_t value, uint32_t ms, uint8_t *status_byte) {
+    channel_t *c = spi_device_channel(d);
+    if (NULL == c->handle)
+        return FT_DEVICE_NOT_OPENED;
+    ms = channel_deadline(c, ms);
+    int64_t start = ft_monotonic_ns();
+
+    // each read clocks out the command, then clocks in the status as the second byte
+    uint8_t out[2] = {cmd, 0};
+    uint8_t in[2 * SPI_POLL_BATCH_MAX];
+    uint32_t batch = SPI_POLL_BATCH_MIN;
+    int64_t attempt = start;    // of the last batch, for a failed transfer
+    FT_STATUS status;
+    do {
+        USHORT state = 0;
+        status = SPI_GetPinState(c->handle, &state);
+        if (status != FT_OK)
+            break;
+        for (uint32_t i = 0; i < batch; i++)
+            state = device_queue(d, c, state, out, TRUE, 2);
+        uint32_t readsz = 0;
+        attempt = ft_monotonic_ns();
+        status = mpsse_transfer(c->handle, &c->cmd, in, &readsz);
+        if (status == FT_OK)
+            status = SPI_SetPinState(c->handle, state);
+        if (status != FT_OK)
+            break;
+
+        for (uint32_t i = 0; i < batch; i++) {
+            if ((in[2 * i + 1] & mask) == value) {
+                *status_byte = in[2 * i + 1];
+                return FT_OK;
+            }
+        }
+        if (batch < SPI_POLL_BATCH_MAX)
+            batch *= 2;
+    } while (ft_monotonic_ns() - start < (int64_t)ms * 1000000);
+
+    return (status == FT_OK) ? FT_TIMEOUT : ft_deadline_status(status, attempt, ms);
+}
+
+JANET_FN(cfun_spi_device_poll_until,
+    "(spi/device-poll-until device cmd mask value &opt timeout)",
+    "Read a status register of `device` with the one byte command `cmd` (e.g. 0x05, a flash RDSR) "
+    "until `(band status mask)` is `value`, within `timeout` ms if given, otherwise the channel's "
+    "`spi/timeout`. Reads go in batches of back to back reads, each batch one USB write and one read, "
+    "growing from 4 to 64 reads while the status doesn't match.\n\n"
+    "Returns the matching status byte, or `nil` on error. Sets `:err` to return status, "
+    "`:timeout` if it never matched.\n\n"
+    "This is a **blocking function**.") {
+    janet_arity(argc, 4, 5);
+
+    device_t *d = (device_t *)janet_getabstract(argv, 0, &spi_device_type);
+    uint32_t cmd = janet_getuinteger(argv, 1);
+    uint32_t mask = janet_getuinteger(argv, 2);
+    uint32_t value = janet_getuinteger(argv, 3);
+    if (cmd > 255 || mask > 255 || value > 255)
+        janet_panic("cmd, mask and value must be bytes");
+
+    uint8_t status_byte = 0;
+    FT_STATUS status = spi_device_poll(d, (uint8_t)cmd, (uint8_t)mask, (uint8_t)value,
+                                       (uint32_t)janet_optnat(argv, argc, 4, 0), &status_byte);
+    if (status != FT_OK)
+        return channel_status(spi_device_channel(d), status, janet_wrap_nil());
+    return channel_status(spi_device_channel(d), status, janet_wrap_integer(status_byte));
+}
+
+// Compiled data is the whole MPSSE command stream, chip select and all
+static FT_STATUS transaction_mpsse(transaction_t *t, uint8_t *in) {
+    return mpsse_run(*t->handle, t->data, t->count, in, t->size, NULL);
+}
+
+static FT_STATUS transaction_send(transaction_t *t, uint32_t *expect) {
+    *expect = t->size;
+    return mpsse_run(*t->handle, t->data, t->count, NULL, 0, NULL);
+}
+
+static FT_STATUS transaction_receive(transaction_t *t, uint8_t *in) {
+    return mpsse_run(*t->handle, NULL, 0, in, t->size, NULL);
+}
+
+/* Registers are read with the register address, 'read_bit' set (e.g. 0x80 on the MPU6000),
+    then the data clocked in, and written with the address then the data, one frame each */
+static FT_STATUS regmap_spi_transfer(regmap_t *m, uint8_t reg, uint8_t *data, uint32_t n, BOOL read) {
+    device_t *d = (device_t *)janet_unwrap_abstract(m->owner);
+    channel_t *c = spi_device_channel(d);
+    uint8_t frame[1 + REGMAP_SIZE];
+    uint8_t read_bit = (uint8_t)(m->address & 0xFF);
+    frame[0] = read ? (reg | read_bit) : (uint8_t)(reg & ~read_bit);
+    if (!read)
+        memcpy(frame + 1, data, n);
+
+    USHORT state = 0;
+    FT_STATUS status = spi_device_begin(d, &state);
+    if (status != FT_OK)
+        return status;
+    state = spi_device_command(d, c, state, frame, read ? 1 : 1 + n, read ? n : 0);
+    return spi_device_send(d, state, read ? data : NULL, 0);
+}
+
+static FT_STATUS regmap_spi_read(regmap_t *m, uint8_t reg, uint8_t *data, uint32_t n) {
+    return regmap_spi_transfer(m, reg, data, n, TRUE);
+}
+
+static FT_STATUS regmap_spi_write(regmap_t *m, uint8_t reg, uint8_t *data, uint32_t n) {
+    return regmap_spi_transfer(m, reg, data, n, FALSE);
+}
+
+// A plan compiles to one MPSSE command stream, a frame per burst, as spi/transaction does
+static FT_STATUS regmap_spi_compile(regmap_t *m, const regmap_burst_t *bursts, int32_t n, uint32_t size, Janet *out) {
+    device_t *d = (device_t *)janet_unwrap_abstract(m->owner);
+    channel_t *c = spi_device_channel(d);
+    USHORT state = 0;
+    FT_STATUS status = spi_device_begin(d, &state);
+    if (status != FT_OK)
+        return status;
+    uint8_t read_bit = (uint8_t)(m->address & 0xFF);
+    for (int32_t i = 0; i < n; i++) {
+        uint8_t reg = bursts[i].reg | read_bit;
+        state = spi_device_command(d, c, state, &reg, 1, bursts[i].len);
+    }
+    mpsse_byte(&c->cmd, MPSSE_SEND_IMMEDIATE);
+    *out = transaction_new(m->owner, &c->handle, transaction_mpsse, transaction_send, transaction_receive,
+                           size, c->cmd.data, c->cmd.count);
+    mpsse_clear(&c->cmd);
+    return FT_OK;
+}
+
+JANET_FN(cfun_spi_regmap,
+    "(spi/regmap device &opt volatile read-bit)",
+    "A register map of `device`, with a shadow of its 8-bit registers, see `regmap/get`. "
+    "`volatile` is as `i2c/regmap`. Register addresses are sent with `read-bit` (default 0x80) "
+    "set for a read and clear for a write, then the data, in one frame.\n\n"
+    "Returns a `<regmap/map>`.") {
+    janet_arity(argc, 1, 3);
+
+    device_t *d = (device_t *)janet_getabstract(argv, 0, &spi_device_type);
+    uint32_t read_bit = (uint32_t)janet_optnat(argv, argc, 2, 0x80);
+    if (read_bit > 255)
+        janet_panicf("read-bit 0x%X is out of range. Expected a byte", read_bit);
+    return regmap_new(argv[0], &spi_device_channel(d)->err_mode, regmap_spi_read, regmap_spi_write,
+                      regmap_spi_compile, read_bit, argc, argv, 1);
 }
 
 static JanetMethod channel_methods[] = {
     {"err",             cfun_spi_get_err},
+    {"err-mode",        cfun_spi_err_mode},
     {"info",            cfun_spi_getchannelinfo},
     {"id",              cfun_spi_get_id},
     {"is-open",         cfun_spi_is_open},
     {"is-busy",         cfun_spi_is_busy},
     {"close",           cfun_spi_closechannel},
+    {"reopen",          cfun_spi_reopen},
+    {"timeout",         cfun_spi_timeout},
+    {"defer",           cfun_spi_defer},
+    {"flush",           cfun_spi_flush},
     {"init",            cfun_spi_initchannel},
     {"read",            cfun_spi_deviceread},
     {"write",           cfun_spi_devicewrite},
     {"readwrite",       cfun_spi_readwrite},
     {"read-opt",        cfun_spi_set_read_options},
     {"write-opt",       cfun_spi_set_write_options},
-    {"config",          cfun_spi_set_config_options}
+    {"config",          cfun_spi_set_config_options},
+    {"gpio-low-write",  cfun_spi_gpio_low_write},
+    {"gpio-low-read",   cfun_spi_gpio_low_read},
+    {"device",          cfun_spi_device},
+    {NULL,              NULL}
+};
+
+// One device read or readwrite of 'size' bytes as a transaction, from the pin 'state'
+static Janet transaction_compile(Janet device, device_t *d, USHORT state, const uint8_t *out, uint32_t size) {
+    channel_t *c = spi_device_channel(d);
+    device_queue(d, c, state, out, TRUE, size);
+    mpsse_byte(&c->cmd, MPSSE_SEND_IMMEDIATE);
+    Janet t = transaction_new(device, &c->handle, transaction_mpsse, transaction_send, transaction_receive,
+                              size, c->cmd.data, c->cmd.count);
+    mpsse_clear(&c->cmd);
+    return t;
+}
+
+JANET_FN(cfun_spi_transaction,
+    "(spi/transaction device size &opt sendbuf)",
+    "Compile an `spi/device-read` of `size` bytes, or an `spi/device-readwrite` if given `sendbuf`, "
+    "to be run by `ft/sampler` or `ft/await`. The command stream is built once, with the low byte GPIO lines "
+    "as they are now.\n\n"
+    "Returns an `<ft/transaction>`, or `nil` on error. Sets `:err` to return status.") {
+    janet_arity(argc, 2, 3);
+
+    device_t *d = (device_t *)janet_getabstract(argv, 0, &spi_device_type);
+    uint32_t size = janet_getuinteger(argv, 1);
+    if (size < 1)
+        janet_panic("read size must be greater than 0");
+
+    const uint8_t *out = NULL;
+    if (argc > 2) {
+        JanetBuffer *sendbuf = janet_getbuffer(argv, 2);
+        if (size > (uint32_t)sendbuf->count)
+            janet_panicf("write size %d larger than sendbuf size %d", size, sendbuf->count);
+        out = sendbuf->data;
+    }
+
+    channel_t *c = spi_device_channel(d);
+    USHORT state = 0;
+    FT_STATUS status = spi_device_begin(d, &state);
+    if (status != FT_OK)
+        return channel_status(c, status, janet_wrap_nil());
+    return channel_status(c, status, transaction_compile(argv[0], d, state, out, size));
+}
+
+JANET_FN(cfun_spi_transaction_chunks,
+    "(spi/transaction-chunks device size &opt chunk)",
+    "Compile an `spi/device-read` of `size` bytes as a list of transactions of at most `chunk` "
+    "bytes each (default 65536), for `ft/await` to run at `:bulk` priority with higher priority "
+    "transactions let in between. Each chunk is its own chip select frame.\n\n"
+    "Returns an array of `<ft/transaction>`, or `nil` on error. Sets `:err` to return status.") {
+    janet_arity(argc, 2, 3);
+
+    device_t *d = (device_t *)janet_getabstract(argv, 0, &spi_device_type);
+    uint32_t size = janet_getuinteger(argv, 1);
+    if (size < 1)
+        janet_panic("read size must be greater than 0");
+    uint32_t chunk = (uint32_t)janet_optnat(argv, argc, 2, SPI_CHUNK_SIZE);
+    if (chunk < 1)
+        janet_panic("chunk size must be greater than 0");
+
+    channel_t *c = spi_device_channel(d);
+    USHORT state = 0;
+    FT_STATUS status = spi_device_begin(d, &state);
+    if (status != FT_OK)
+        return channel_status(c, status, janet_wrap_nil());
+
+    JanetArray *chunks = janet_array((int32_t)((size - 1) / chunk + 1));
+    for (uint32_t done = 0; done < size; done += chunk) {
+        uint32_t n = (size - done < chunk) ? size - done : chunk;
+        janet_array_push(chunks, transaction_compile(argv[0], d, state, NULL, n));
+    }
+    return channel_status(c, status, janet_wrap_array(chunks));
+}
+
+static JanetMethod device_methods[] = {
+    {"write",           cfun_spi_device_write},
+    {"read",            cfun_spi_device_read},
+    {"readwrite",       cfun_spi_device_readwrite},
+    {"transaction",     cfun_spi_transaction},
+    {"transaction-chunks", cfun_spi_transaction_chunks},
+    {"poll-until",      cfun_spi_device_poll_until},
+    {"regmap",          cfun_spi_regmap},
+    {NULL,              NULL}
 };
 
 static int channel_get(void *p, Janet key, Janet *out) {
@@ -614,23 +1538,95 @@ static int channel_gc(void *p, size_t s) {
     channel_t *c = (channel_t *)p;
     FT_STATUS status = FT_DEVICE_NOT_OPENED;
     if (c != NULL) {
+        // a closed channel, or one moved to another thread, has no handle
+        ft_sampler_release(&c->handle);
         if (c->handle != NULL) {
             status = SPI_CloseChannel(c->handle);
             c->handle = NULL;
         }
+        mpsse_deinit(&c->cmd);
     }
     set_status_dyn(status, janet_wrap_nil());
     return 0;
 }
 
+/* Channels move between threads (ev/thread, threaded channels): the handle is passed
+    as a pointer, which marshal only allows between threads of the same process, and the
+    sender's copy is left without one, as if closed. */
+static void channel_marshal(void *p, JanetMarshalContext *ctx) {
+    channel_t *c = (channel_t *)p;
+    if (c->cmd.count > 0)
+        janet_panic("cannot move an spi channel with deferred writes queued, flush it first");
+    janet_marshal_abstract(ctx, p);
+    janet_marshal_int(ctx, (int32_t)c->index);
+    janet_marshal_int(ctx, (int32_t)c->id);
+    janet_marshal_int(ctx, (int32_t)c->locid);
+    janet_marshal_bytes(ctx, (const uint8_t *)c->serial, sizeof(c->serial));
+    janet_marshal_ptr(ctx, c->handle);
+    janet_marshal_int(ctx, (int32_t)c->err_mode);
+    janet_marshal_bytes(ctx, (const uint8_t *)&c->config, sizeof(ChannelConfig));
+    janet_marshal_int(ctx, (int32_t)c->initialized);
+    janet_marshal_int(ctx, (int32_t)c->read_options);
+    janet_marshal_int(ctx, (int32_t)c->write_options);
+    janet_marshal_int(ctx, (int32_t)c->timeout);
+    janet_marshal_int(ctx, (int32_t)c->timeout_set);
+    janet_marshal_int(ctx, (int32_t)c->deferred);
+    janet_marshal_int(ctx, (int32_t)c->defer_limit);
+    c->handle = NULL;
+    mpsse_clear(&c->cmd);
+}
+
+static void *channel_unmarshal(JanetMarshalContext *ctx) {
+    channel_t *c = (channel_t *)janet_unmarshal_abstract(ctx, sizeof(channel_t));
+    c->index = (uint32_t)janet_unmarshal_int(ctx);
+    c->id = (uint32_t)janet_unmarshal_int(ctx);
+    c->locid = (uint32_t)janet_unmarshal_int(ctx);
+    janet_unmarshal_bytes(ctx, (uint8_t *)c->serial, sizeof(c->serial));
+    c->handle = (FT_HANDLE)janet_unmarshal_ptr(ctx);
+    c->err_mode = (err_mode_t)janet_unmarshal_int(ctx);
+    janet_unmarshal_bytes(ctx, (uint8_t *)&c->config, sizeof(ChannelConfig));
+    c->initialized = (BOOL)janet_unmarshal_int(ctx);
+    c->read_options = (uint32_t)janet_unmarshal_int(ctx);
+    c->write_options = (uint32_t)janet_unmarshal_int(ctx);
+    c->timeout = (uint32_t)janet_unmarshal_int(ctx);
+    c->timeout_set = (uint32_t)janet_unmarshal_int(ctx);
+    c->deferred = (BOOL)janet_unmarshal_int(ctx);
+    c->defer_limit = (uint32_t)janet_unmarshal_int(ctx);
+    mpsse_init(&c->cmd, 0);
+    return c;
+}
+
 static void channel_string(void *p, JanetBuffer *buffer) {
     channel_t *c = (channel_t *)p;
     janet_formatb(buffer, "#%d 0x%X", c->index, c);
 }
 
+static int device_get(void *p, Janet key, Janet *out) {
+    (void) p;
+    if (!janet_checktype(key, JANET_KEYWORD))
+        janet_panicf("expected keyword, but got %t", key);
+    return janet_getmethod(janet_unwrap_keyword(key), device_methods, out);
+}
+
+static int device_gcmark(void *p, size_t s) {
+    (void) s;
+    device_t *d = (device_t *)p;
+    janet_mark(d->channel);
+    return 0;
+}
+
+static void device_string(void *p, JanetBuffer *buffer) {
+    device_t *d = (device_t *)p;
+    janet_formatb(buffer, "#%d cs%d mode%d",
+                  spi_device_channel(d)->index,
+                  3 + ((d->options & SPI_CONFIG_OPTION_CS_MASK) >> 2),
+                  d->options & SPI_CONFIG_OPTION_MODE_MASK);
+}
+
 void spi_register(JanetTable *env) {
     JanetRegExt cfuns[] = {
         JANET_REG("spi/err",            cfun_spi_get_err),
+        JANET_REG("spi/err-mode",       cfun_spi_err_mode),
         JANET_REG("spi/channels",       cfun_spi_channelcount),
         JANET_REG("spi/info",           cfun_spi_getchannelinfo),
         JANET_REG("spi/find-by",        cfun_spi_find),
@@ -639,16 +1635,32 @@ void spi_register(JanetTable *env) {
         JANET_REG("spi/write-opt",      cfun_spi_set_write_options),
         JANET_REG("spi/config",         cfun_spi_set_config_options),
         JANET_REG("spi/open",           cfun_spi_openchannel),
+        JANET_REG("spi/open-all",       cfun_spi_open_all),
         JANET_REG("spi/is-open",        cfun_spi_is_open),
         JANET_REG("spi/is-busy",        cfun_spi_is_busy),
         JANET_REG("spi/init",           cfun_spi_initchannel),
         JANET_REG("spi/close",          cfun_spi_closechannel),
+        JANET_REG("spi/reopen",         cfun_spi_reopen),
+        JANET_REG("spi/timeout",        cfun_spi_timeout),
+        JANET_REG("spi/defer",          cfun_spi_defer),
+        JANET_REG("spi/flush",          cfun_spi_flush),
         JANET_REG("spi/read",           cfun_spi_deviceread),
         JANET_REG("spi/write",          cfun_spi_devicewrite),
         JANET_REG("spi/readwrite",      cfun_spi_readwrite),
         JANET_REG("spi/gpio-read",      cfun_spi_gpio_read),
         JANET_REG("spi/gpio-write",     cfun_spi_gpio_write),
+        JANET_REG("spi/gpio-low-read",  cfun_spi_gpio_low_read),
+        JANET_REG("spi/gpio-low-write", cfun_spi_gpio_low_write),
+        JANET_REG("spi/device",         cfun_spi_device),
+        JANET_REG("spi/device-write",   cfun_spi_device_write),
+        JANET_REG("spi/device-read",    cfun_spi_device_read),
+        JANET_REG("spi/device-readwrite", cfun_spi_device_readwrite),
+        JANET_REG("spi/transaction",    cfun_spi_transaction),
+        JANET_REG("spi/transaction-chunks", cfun_spi_transaction_chunks),
+        JANET_REG("spi/device-poll-until", cfun_spi_device_poll_until),
+        JANET_REG("spi/regmap",         cfun_spi_regmap),
         JANET_REG_END
     };
     janet_cfuns_ext(env, "spi", cfuns);
+    janet_register_abstract_type(&channel_type);
 }
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef _SPI_H_
+#define _SPI_H_
+#include "module.h"
+#include "mpsse.h"
+#include "../LibMPSSE_1.0.7/release/include/libmpsse_spi.h"
+
+/* SPI channels and devices, shared with the modules built on them (flash). */
+
+typedef struct {
+    uint32_t        index;          // 1-based, as user-entered
+    uint32_t        id;             // unique id per-channel set by libmpsse
+    uint32_t        locid;          // USB location and serial, to find the device again on reopen
+    char            serial[16];
+    FT_HANDLE       handle;
+    err_mode_t      err_mode;       // how calls on the channel report their status
+    ChannelConfig   config;
+    BOOL            initialized;    // config was applied by init, and is reapplied on reopen
+    uint32_t        read_options;   // these are use per-read/write
+    uint32_t        write_options;  //
+    uint32_t        timeout;        // ms deadline of each call, 0 for libMPSSE's default
+    uint32_t        timeout_set;    // as set in the driver now, 0 if unknown
+    mpsse_cmd_t     cmd;            // command stream for transfers not done by libMPSSE
+    BOOL            deferred;       // write-only transfers are left queued in cmd, see spi/defer
+    uint32_t        defer_limit;    // bytes queued that flush the queue
+} channel_t;
+
+typedef struct {
+    Janet           channel;        // <spi/channel> the device is on
+    uint32_t        options;        // SPI_CONFIG_OPTION_ mode, chip select line & polarity
+} device_t;
+
+extern const JanetAbstractType spi_device_type;
+extern channel_t *spi_device_channel(device_t *d);
+
+/* Queue a device frame: CS assert, 'outsz' bytes of 'out' clocked out, then 'insz' bytes
+    clocked in, and CS deassert, starting from pin 'state'. Send it with mpsse_transfer.
+    Returns the pin state the queued commands leave, for SPI_SetPinState. */
+extern USHORT spi_device_command(device_t *d, channel_t *c, USHORT state, const uint8_t *out,
+                                 uint32_t outsz, uint32_t insz);
+
+/* Flush what deferred mode left queued on the device's channel, and get the pin state
+    to queue device frames from. */
+extern FT_STATUS spi_device_begin(device_t *d, USHORT *state);
+
+/* Send the queued frames in one write, and read what they return into 'in' with one read,
+    within 'ms' or the channel's deadline. Then set 'state', as returned by the last frame. */
+extern FT_STATUS spi_device_send(device_t *d, USHORT state, uint8_t *in, uint32_t ms);
+
+/* Read a status register with 'cmd' until (status & mask) == value, within 'ms' or the
+    channel's deadline, and set 'status_byte' to the one that matched. */
+extern FT_STATUS spi_device_poll(device_t *d, uint8_t cmd, uint8_t mask, uint8_t value, uint32_t ms,
+                                 uint8_t *status_byte);
+#endif